@@ -72,6 +72,16 @@ typedef struct {
     GList *allowed_filenames;
     GList *forbidden_filenames;
 
+    /* Results of exec conditions, by expanded command line, for the
+     * selection below.  Checks still running are cancelled through
+     * exec_cancellable when the selection changes. */
+    GHashTable *exec_results;
+    GCancellable *exec_cancellable;
+    GList *exec_selection;
+    NemoFile *exec_parent;
+    gboolean exec_for_places;
+    GtkWindow *exec_window;
+
     gboolean constructing;
 } NemoActionPrivate;
 
@@ -200,6 +210,7 @@ nemo_action_init (NemoAction *action)
     priv->dbus_recalc_timeout_id = 0;
     priv->gsettings_satisfied = TRUE;
     priv->gsettings_recalc_timeout_id = 0;
+    priv->exec_results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
     priv->constructing = TRUE;
 }
 
@@ -1035,6 +1046,14 @@ nemo_action_finalize (GObject *object)
     g_clear_handle_id (&priv->dbus_recalc_timeout_id, g_source_remove);
     g_clear_handle_id (&priv->gsettings_recalc_timeout_id, g_source_remove);
 
+    g_hash_table_destroy (priv->exec_results);
+    g_clear_object (&priv->exec_cancellable);
+    nemo_file_list_free (priv->exec_selection);
+    nemo_file_unref (priv->exec_parent);
+    if (priv->exec_window != NULL) {
+        g_object_remove_weak_pointer (G_OBJECT (priv->exec_window), (gpointer *) &priv->exec_window);
+    }
+
     G_OBJECT_CLASS (nemo_action_parent_class)->finalize (object);
 }
 
@@ -1585,7 +1604,183 @@ finalize_strings (NemoAction *action,
     g_free (tt);
 }
 
+/* Exec conditions run in the background, and a command that takes longer
+ * than this is killed.  Until it has answered, its condition is unmet. */
+#define EXEC_CONDITION_TIMEOUT_SECONDS 2
+
+typedef enum {
+    EXEC_CONDITION_UNKNOWN = 0,
+    EXEC_CONDITION_PENDING,
+    EXEC_CONDITION_PASSED,
+    EXEC_CONDITION_FAILED
+} ExecConditionState;
+
+typedef struct {
+    NemoAction *action;
+    gchar *command;
+    GSubprocess *process;
+    GCancellable *cancellable;
+    guint timeout_id;
+} ExecConditionCheck;
+
+static void
+exec_condition_check_free (ExecConditionCheck *check)
+{
+    g_clear_handle_id (&check->timeout_id, g_source_remove);
+    g_object_unref (check->action);
+    g_free (check->command);
+    g_object_unref (check->process);
+    g_object_unref (check->cancellable);
+    g_free (check);
+}
+
 static gboolean
+exec_condition_timeout_cb (gpointer user_data)
+{
+    ExecConditionCheck *check = user_data;
+
+    DEBUG ("Exec condition '%s' timed out", check->command);
+
+    check->timeout_id = 0;
+    g_subprocess_force_exit (check->process);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+exec_condition_wait_cb (GObject      *source,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+    ExecConditionCheck *check = user_data;
+    NemoAction *action = check->action;
+    NemoActionPrivate *priv = nemo_action_get_instance_private (action);
+    GError *error = NULL;
+    gboolean passed;
+
+    if (!g_subprocess_wait_finish (check->process, result, &error)) {
+        /* The selection moved on, nobody wants this answer anymore */
+        g_subprocess_force_exit (check->process);
+        g_error_free (error);
+        exec_condition_check_free (check);
+        return;
+    }
+
+    passed = g_subprocess_get_if_exited (check->process) &&
+             g_subprocess_get_exit_status (check->process) == 0;
+
+    DEBUG ("Action checking exec condition '%s' returned: %s",
+           check->command, passed ? "TRUE" : "FALSE");
+
+    g_hash_table_insert (priv->exec_results,
+                         g_strdup (check->command),
+                         GINT_TO_POINTER (passed ? EXEC_CONDITION_PASSED : EXEC_CONDITION_FAILED));
+
+    /* The action was hidden while the check ran, only a pass changes that */
+    if (passed) {
+        nemo_action_update_display_state (action,
+                                          priv->exec_selection,
+                                          priv->exec_parent,
+                                          priv->exec_for_places,
+                                          priv->exec_window);
+    }
+
+    exec_condition_check_free (check);
+}
+
+static void
+start_exec_condition_check (NemoAction  *action,
+                            const gchar *command)
+{
+    NemoActionPrivate *priv = nemo_action_get_instance_private (action);
+    ExecConditionCheck *check;
+    GSubprocess *process;
+    GError *error;
+    gchar **argv;
+
+    error = NULL;
+    argv = NULL;
+
+    if (!g_shell_parse_argv (command, NULL, &argv, &error) ||
+        (process = g_subprocess_newv ((const gchar * const *) argv,
+                                      G_SUBPROCESS_FLAGS_NONE,
+                                      &error)) == NULL) {
+        DEBUG ("Error spawning exec condition: %s\n",
+               error->message);
+        g_error_free (error);
+        g_strfreev (argv);
+
+        g_hash_table_insert (priv->exec_results,
+                             g_strdup (command),
+                             GINT_TO_POINTER (EXEC_CONDITION_FAILED));
+        return;
+    }
+
+    g_strfreev (argv);
+
+    check = g_new0 (ExecConditionCheck, 1);
+    check->action = g_object_ref (action);
+    check->command = g_strdup (command);
+    check->process = process;
+    check->cancellable = g_object_ref (priv->exec_cancellable);
+    check->timeout_id = g_timeout_add_seconds (EXEC_CONDITION_TIMEOUT_SECONDS,
+                                               exec_condition_timeout_cb,
+                                               check);
+
+    g_hash_table_insert (priv->exec_results,
+                         g_strdup (command),
+                         GINT_TO_POINTER (EXEC_CONDITION_PENDING));
+
+    g_subprocess_wait_async (process, check->cancellable, exec_condition_wait_cb, check);
+}
+
+/* Exec results only hold for the selection they were worked out for */
+static void
+update_exec_condition_selection (NemoAction *action,
+                                 GList      *selection,
+                                 NemoFile   *parent,
+                                 gboolean    for_places,
+                                 GtkWindow  *window)
+{
+    NemoActionPrivate *priv = nemo_action_get_instance_private (action);
+    GList *l, *ll;
+
+    for (l = selection, ll = priv->exec_selection;
+         l != NULL && ll != NULL && l->data == ll->data;
+         l = l->next, ll = ll->next);
+
+    if (priv->exec_cancellable == NULL ||
+        l != NULL || ll != NULL ||
+        parent != priv->exec_parent ||
+        for_places != priv->exec_for_places ||
+        window != priv->exec_window) {
+        if (priv->exec_cancellable != NULL) {
+            g_cancellable_cancel (priv->exec_cancellable);
+            g_object_unref (priv->exec_cancellable);
+        }
+        priv->exec_cancellable = g_cancellable_new ();
+
+        g_hash_table_remove_all (priv->exec_results);
+
+        nemo_file_list_free (priv->exec_selection);
+        priv->exec_selection = nemo_file_list_copy (selection);
+
+        nemo_file_unref (priv->exec_parent);
+        priv->exec_parent = nemo_file_ref (parent);
+
+        priv->exec_for_places = for_places;
+
+        if (priv->exec_window != NULL) {
+            g_object_remove_weak_pointer (G_OBJECT (priv->exec_window), (gpointer *) &priv->exec_window);
+        }
+        priv->exec_window = window;
+        if (priv->exec_window != NULL) {
+            g_object_add_weak_pointer (G_OBJECT (priv->exec_window), (gpointer *) &priv->exec_window);
+        }
+    }
+}
+
+static ExecConditionState
 check_exec_condition (NemoAction  *action,
                       const gchar *condition,
                       GList       *selection,
@@ -1593,9 +1788,8 @@ check_exec_condition (NemoAction  *action,
                       GtkWindow   *window)
 {
     NemoActionPrivate *priv = nemo_action_get_instance_private (action);
+    ExecConditionState state;
     GString *exec;
-    GError *error;
-    gint return_code;
     gchar *exec_str;
     gchar **split;
     gboolean use_parent_dir;
@@ -1604,12 +1798,12 @@ check_exec_condition (NemoAction  *action,
 
     if (g_strv_length (split) != 2) {
         g_strfreev (split);
-        return FALSE;
+        return EXEC_CONDITION_FAILED;
     }
 
     if (g_strcmp0 (split[0], "exec") != 0) {
         g_strfreev (split);
-        return FALSE;
+        return EXEC_CONDITION_FAILED;
     }
 
     strip_custom_modifier (split[1], &use_parent_dir, &exec_str);
@@ -1620,8 +1814,6 @@ check_exec_condition (NemoAction  *action,
 
     g_free (exec_str);
 
-    error = NULL;
-
     priv->escape_underscores = FALSE;
 
     exec = expand_action_string (action, selection, parent, exec, window);
@@ -1631,23 +1823,18 @@ check_exec_condition (NemoAction  *action,
         exec = g_string_prepend (exec, action->parent_dir);
     }
 
-    DEBUG ("Checking exec condition: %s", exec->str);
+    state = GPOINTER_TO_INT (g_hash_table_lookup (priv->exec_results, exec->str));
 
-    if (!g_spawn_command_line_sync (exec->str,
-                                    NULL,
-                                    NULL,
-                                    &return_code,
-                                    &error)) {
-            DEBUG ("Error spawning exec condition: %s\n",
-                   error->message);
-            g_error_free (error);
-        }
+    if (state == EXEC_CONDITION_UNKNOWN) {
+        DEBUG ("Checking exec condition: %s", exec->str);
 
-    DEBUG ("Action checking exec condition '%s' returned: %d", exec->str, return_code);
+        start_exec_condition_check (action, exec->str);
+        state = GPOINTER_TO_INT (g_hash_table_lookup (priv->exec_results, exec->str));
+    }
 
     g_string_free (exec, TRUE);
 
-    return (return_code == 0);
+    return state;
 }
 
 static gboolean
@@ -1926,6 +2113,7 @@ get_visibility (NemoAction *action,
 
     // Check conditions
     gboolean condition_type_show = TRUE;
+    gboolean exec_pending = FALSE;
     gchar **conditions = priv->conditions;
     guint condition_count = conditions != NULL ? g_strv_length (conditions) : 0;
 
@@ -1981,11 +2169,21 @@ get_visibility (NemoAction *action,
                 }
                 condition_type_show = is_removable;
             } else if (g_str_has_prefix (condition, "exec")) {
-                condition_type_show = check_exec_condition (action,
-                                                            condition,
-                                                            selection,
-                                                            parent,
-                                                            window);
+                ExecConditionState state;
+
+                update_exec_condition_selection (action, selection, parent, for_places, window);
+                state = check_exec_condition (action,
+                                              condition,
+                                              selection,
+                                              parent,
+                                              window);
+
+                // Keep going so the other checks start running alongside
+                if (state == EXEC_CONDITION_PENDING) {
+                    exec_pending = TRUE;
+                } else {
+                    condition_type_show = state == EXEC_CONDITION_PASSED;
+                }
             }
 
             if (!condition_type_show)
@@ -1993,7 +2191,7 @@ get_visibility (NemoAction *action,
         }
     }
 
-    if (!condition_type_show) {
+    if (!condition_type_show || exec_pending) {
         return FALSE;
     }
 
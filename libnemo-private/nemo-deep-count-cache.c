@@ -0,0 +1,542 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-deep-count-cache.c - on-disk cache of what deep counts found in
+   each directory.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-deep-count-cache.h"
+
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The file is a header, the records sorted by (device, inode) and then
+ * the subdirectory names they point into.  It is mapped as is, so it is
+ * in host byte order; the magic changes whenever the layout does.
+ */
+#define CACHE_MAGIC "NEMODCC2"
+
+/* Directories that went away are never removed one by one; once there
+ * are this many records, the ones used longest ago make room for new
+ * ones. */
+#define MAX_RECORDS 1000000
+
+/* A record that is stored again unchanged, or looked up, keeps its old
+ * time unless it is at least this old (in seconds), so counting the same
+ * tree again doesn't rewrite the file. */
+#define STORED_REFRESH_INTERVAL (24 * 60 * 60)
+
+typedef struct {
+	char magic[8];
+	guint32 n_records;
+	guint32 reserved;
+	guint64 names_length;
+} CacheHeader;
+
+typedef struct {
+	guint64 device;
+	guint64 inode;
+	guint64 mtime;
+	guint64 size;
+	guint64 names_offset;
+	guint64 stored; /* seconds, when the directory was last counted or looked up */
+	guint32 mtime_usec;
+	guint32 directory_count;
+	guint32 file_count;
+	guint32 hidden_directory_count;
+	guint32 hidden_file_count;
+	guint32 names_length;
+} CacheRecord;
+
+struct NemoDeepCountCache {
+	gint ref_count;
+	GMappedFile *mapped;
+	const CacheRecord *records;
+	guint n_records;
+	const char *names;
+	guint64 names_length;
+};
+
+/* cache_lock only guards current_cache; store_lock is held for a whole
+ * merge and write, so lookups never wait for the disk. */
+static GMutex cache_lock;
+static GMutex store_lock;
+static NemoDeepCountCache *current_cache;
+
+static char *
+get_cache_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "nemo", "deep-counts", NULL);
+}
+
+static NemoDeepCountCache *
+cache_load (void)
+{
+	NemoDeepCountCache *cache;
+	const CacheHeader *header;
+	const char *contents;
+	char *path;
+	gsize length;
+
+	cache = g_new0 (NemoDeepCountCache, 1);
+	cache->ref_count = 1;
+
+	path = get_cache_path ();
+	cache->mapped = g_mapped_file_new (path, FALSE, NULL);
+	g_free (path);
+
+	if (cache->mapped == NULL) {
+		return cache;
+	}
+
+	contents = g_mapped_file_get_contents (cache->mapped);
+	length = g_mapped_file_get_length (cache->mapped);
+	header = (const CacheHeader *) contents;
+
+	if (contents == NULL ||
+	    length < sizeof (CacheHeader) ||
+	    memcmp (header->magic, CACHE_MAGIC, sizeof (header->magic)) != 0 ||
+	    length - sizeof (CacheHeader) != (guint64) header->n_records * sizeof (CacheRecord) + header->names_length) {
+		g_mapped_file_unref (cache->mapped);
+		cache->mapped = NULL;
+		return cache;
+	}
+
+	cache->records = (const CacheRecord *) (contents + sizeof (CacheHeader));
+	cache->n_records = header->n_records;
+	cache->names = (const char *) (cache->records + cache->n_records);
+	cache->names_length = header->names_length;
+
+	return cache;
+}
+
+static NemoDeepCountCache *
+cache_ref (NemoDeepCountCache *cache)
+{
+	g_atomic_int_inc (&cache->ref_count);
+
+	return cache;
+}
+
+NemoDeepCountCache *
+nemo_deep_count_cache_get (void)
+{
+	NemoDeepCountCache *cache;
+
+	g_mutex_lock (&cache_lock);
+
+	if (current_cache == NULL) {
+		current_cache = cache_load ();
+	}
+	cache = cache_ref (current_cache);
+
+	g_mutex_unlock (&cache_lock);
+
+	return cache;
+}
+
+void
+nemo_deep_count_cache_unref (NemoDeepCountCache *cache)
+{
+	if (!g_atomic_int_dec_and_test (&cache->ref_count)) {
+		return;
+	}
+
+	if (cache->mapped != NULL) {
+		g_mapped_file_unref (cache->mapped);
+	}
+	g_free (cache);
+}
+
+static int
+compare_keys (guint64 device_a, guint64 inode_a,
+	      guint64 device_b, guint64 inode_b)
+{
+	if (device_a != device_b) {
+		return device_a < device_b ? -1 : 1;
+	}
+	if (inode_a != inode_b) {
+		return inode_a < inode_b ? -1 : 1;
+	}
+	return 0;
+}
+
+/* The file could have been truncated or scribbled on while mapped */
+static gboolean
+record_names_are_valid (NemoDeepCountCache *cache,
+			const CacheRecord  *record)
+{
+	if (record->names_offset > cache->names_length ||
+	    record->names_length > cache->names_length - record->names_offset) {
+		return FALSE;
+	}
+
+	return record->names_length == 0 ||
+	       cache->names[record->names_offset + record->names_length - 1] == '\0';
+}
+
+static const CacheRecord *
+find_record (NemoDeepCountCache *cache,
+	     guint64             device,
+	     guint64             inode)
+{
+	const CacheRecord *record;
+	guint low, high, middle;
+	int result;
+
+	low = 0;
+	high = cache->n_records;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		record = &cache->records[middle];
+
+		result = compare_keys (device, inode, record->device, record->inode);
+
+		if (result == 0) {
+			return record;
+		} else if (result < 0) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+
+	return NULL;
+}
+
+gboolean
+nemo_deep_count_cache_lookup (NemoDeepCountCache      *cache,
+			      NemoDeepCountCacheEntry *entry)
+{
+	const CacheRecord *record;
+
+	record = find_record (cache, entry->device, entry->inode);
+
+	if (record == NULL ||
+	    record->mtime != entry->mtime ||
+	    record->mtime_usec != entry->mtime_usec ||
+	    !record_names_are_valid (cache, record)) {
+		return FALSE;
+	}
+
+	entry->directory_count = record->directory_count;
+	entry->file_count = record->file_count;
+	entry->hidden_directory_count = record->hidden_directory_count;
+	entry->hidden_file_count = record->hidden_file_count;
+	entry->size = record->size;
+	entry->subdirectories = cache->names + record->names_offset;
+	entry->subdirectories_length = record->names_length;
+
+	return TRUE;
+}
+
+static int
+compare_entries (gconstpointer a,
+		 gconstpointer b)
+{
+	const NemoDeepCountCacheEntry *entry_a = a;
+	const NemoDeepCountCacheEntry *entry_b = b;
+
+	return compare_keys (entry_a->device, entry_a->inode,
+			     entry_b->device, entry_b->inode);
+}
+
+static gboolean
+record_equals_entry (NemoDeepCountCache            *cache,
+		     const CacheRecord             *record,
+		     const NemoDeepCountCacheEntry *entry)
+{
+	return record->mtime == entry->mtime &&
+	       record->mtime_usec == entry->mtime_usec &&
+	       record->directory_count == entry->directory_count &&
+	       record->file_count == entry->file_count &&
+	       record->hidden_directory_count == entry->hidden_directory_count &&
+	       record->hidden_file_count == entry->hidden_file_count &&
+	       record->size == entry->size &&
+	       record->names_length == entry->subdirectories_length &&
+	       record_names_are_valid (cache, record) &&
+	       memcmp (cache->names + record->names_offset, entry->subdirectories, record->names_length) == 0;
+}
+
+static void
+append_record (GArray      *records,
+	       GString     *names,
+	       const CacheRecord *record,
+	       const char  *record_names)
+{
+	CacheRecord copy;
+
+	copy = *record;
+	copy.names_offset = names->len;
+	g_string_append_len (names, record_names, record->names_length);
+	g_array_append_val (records, copy);
+}
+
+static void
+append_entry (GArray                        *records,
+	      GString                       *names,
+	      const NemoDeepCountCacheEntry *entry,
+	      guint64                        stored)
+{
+	CacheRecord record = { 0 };
+
+	record.stored = stored;
+	record.device = entry->device;
+	record.inode = entry->inode;
+	record.mtime = entry->mtime;
+	record.mtime_usec = entry->mtime_usec;
+	record.directory_count = entry->directory_count;
+	record.file_count = entry->file_count;
+	record.hidden_directory_count = entry->hidden_directory_count;
+	record.hidden_file_count = entry->hidden_file_count;
+	record.size = entry->size;
+	record.names_length = entry->subdirectories_length;
+
+	append_record (records, names, &record, entry->subdirectories);
+}
+
+static int
+compare_stored_newest_first (gconstpointer a,
+			     gconstpointer b)
+{
+	guint64 stored_a = *(const guint64 *) a;
+	guint64 stored_b = *(const guint64 *) b;
+
+	if (stored_a != stored_b) {
+		return stored_a > stored_b ? -1 : 1;
+	}
+	return 0;
+}
+
+/* When each old record was last used: its stored time, or now for the
+ * ones in @hits that are due to be refreshed.
+ */
+static guint64 *
+get_last_used (NemoDeepCountCache *cache,
+	       GArray             *hits,
+	       guint64             now)
+{
+	const NemoDeepCountCacheEntry *hit;
+	const CacheRecord *record;
+	guint64 *last_used;
+	guint i;
+
+	last_used = g_new (guint64, MAX (cache->n_records, 1));
+	for (i = 0; i < cache->n_records; i++) {
+		last_used[i] = cache->records[i].stored;
+	}
+
+	for (i = 0; i < hits->len; i++) {
+		hit = &g_array_index (hits, NemoDeepCountCacheEntry, i);
+		record = find_record (cache, hit->device, hit->inode);
+
+		if (record != NULL &&
+		    record->mtime == hit->mtime &&
+		    record->mtime_usec == hit->mtime_usec &&
+		    record->stored + STORED_REFRESH_INTERVAL <= now) {
+			last_used[record - cache->records] = now;
+		}
+	}
+
+	return last_used;
+}
+
+/* Finds which of the old records the @n_keep used last are: those used
+ * after the returned time, and the first *@n_at_cutoff used at it.
+ */
+static guint64
+find_eviction_cutoff (const guint64 *last_used,
+		      guint          n_records,
+		      guint          n_keep,
+		      guint         *n_at_cutoff)
+{
+	guint64 *stored, cutoff;
+	guint i;
+
+	if (n_records <= n_keep) {
+		*n_at_cutoff = n_records;
+		return 0;
+	}
+
+	if (n_keep == 0) {
+		*n_at_cutoff = 0;
+		return G_MAXUINT64;
+	}
+
+	stored = g_new (guint64, n_records);
+	memcpy (stored, last_used, n_records * sizeof (guint64));
+	qsort (stored, n_records, sizeof (guint64), compare_stored_newest_first);
+
+	cutoff = stored[n_keep - 1];
+	*n_at_cutoff = 0;
+	for (i = n_keep; i > 0 && stored[i - 1] == cutoff; i--) {
+		(*n_at_cutoff)++;
+	}
+
+	g_free (stored);
+
+	return cutoff;
+}
+
+static gboolean
+write_cache (GArray  *records,
+	     GString *names)
+{
+	CacheHeader header = { { 0 } };
+	GString *contents;
+	char *path, *dir;
+	gboolean written;
+
+	memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+	header.n_records = records->len;
+	header.names_length = names->len;
+
+	contents = g_string_sized_new (sizeof (CacheHeader) + records->len * sizeof (CacheRecord) + names->len);
+	g_string_append_len (contents, (const char *) &header, sizeof (CacheHeader));
+	g_string_append_len (contents, records->data, records->len * sizeof (CacheRecord));
+	g_string_append_len (contents, names->str, names->len);
+
+	path = get_cache_path ();
+	dir = g_path_get_dirname (path);
+	g_mkdir_with_parents (dir, 0700);
+
+	/* Replaces the file, so mappings of the old one stay intact */
+	written = g_file_set_contents (path, contents->str, contents->len, NULL);
+
+	g_free (dir);
+	g_free (path);
+	g_string_free (contents, TRUE);
+
+	return written;
+}
+
+void
+nemo_deep_count_cache_store (GArray *entries,
+			     GArray *hits)
+{
+	NemoDeepCountCache *cache, *new_cache, *old_cache;
+	const NemoDeepCountCacheEntry *entry;
+	const CacheRecord *record;
+	CacheRecord kept;
+	GArray *records;
+	GString *names;
+	guint64 *last_used;
+	guint64 now, cutoff;
+	guint i, j, n_old, n_at_cutoff;
+	gboolean changed;
+	int result;
+
+	if (entries->len == 0 && hits->len == 0) {
+		return;
+	}
+
+	g_array_sort (entries, compare_entries);
+
+	/* Only stores replace current_cache, so this stays the current one */
+	g_mutex_lock (&store_lock);
+	cache = nemo_deep_count_cache_get ();
+
+	records = g_array_sized_new (FALSE, FALSE, sizeof (CacheRecord),
+				     MIN (cache->n_records + entries->len, MAX_RECORDS));
+	names = g_string_new (NULL);
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	last_used = get_last_used (cache, hits, now);
+
+	/* Make room for the new entries by dropping the records used
+	 * longest ago */
+	n_old = MAX_RECORDS - MIN (entries->len, MAX_RECORDS);
+	cutoff = find_eviction_cutoff (last_used, cache->n_records, n_old, &n_at_cutoff);
+	changed = FALSE;
+
+	for (i = 0, j = 0; i < cache->n_records || j < entries->len;) {
+		record = i < cache->n_records ? &cache->records[i] : NULL;
+		entry = j < entries->len ? &g_array_index (entries, NemoDeepCountCacheEntry, j) : NULL;
+
+		if (record == NULL) {
+			result = 1;
+		} else if (entry == NULL) {
+			result = -1;
+		} else {
+			result = compare_keys (record->device, record->inode,
+					       entry->device, entry->inode);
+		}
+
+		if (result < 0) {
+			if (n_old > 0 &&
+			    (last_used[i] > cutoff || (last_used[i] == cutoff && n_at_cutoff > 0)) &&
+			    record_names_are_valid (cache, record)) {
+				kept = *record;
+				kept.stored = last_used[i];
+				changed |= kept.stored != record->stored;
+
+				append_record (records, names, &kept, cache->names + record->names_offset);
+				if (last_used[i] == cutoff) {
+					n_at_cutoff--;
+				}
+				n_old--;
+			} else {
+				changed = TRUE;
+			}
+			i++;
+		} else {
+			if (result == 0 &&
+			    last_used[i] + STORED_REFRESH_INTERVAL > now &&
+			    record_equals_entry (cache, record, entry)) {
+				kept = *record;
+				kept.stored = last_used[i];
+				changed |= kept.stored != record->stored;
+
+				append_record (records, names, &kept, cache->names + record->names_offset);
+			} else {
+				if (records->len < MAX_RECORDS) {
+					append_entry (records, names, entry, now);
+				}
+				changed = TRUE;
+			}
+			/* A new entry replaces the old record, and any duplicates */
+			do {
+				j++;
+			} while (j < entries->len &&
+				 compare_entries (entry, &g_array_index (entries, NemoDeepCountCacheEntry, j)) == 0);
+			if (result == 0) {
+				i++;
+			}
+		}
+	}
+
+	if (changed && write_cache (records, names)) {
+		new_cache = cache_load ();
+
+		g_mutex_lock (&cache_lock);
+		old_cache = current_cache;
+		current_cache = new_cache;
+		g_mutex_unlock (&cache_lock);
+
+		nemo_deep_count_cache_unref (old_cache);
+	}
+
+	nemo_deep_count_cache_unref (cache);
+	g_free (last_used);
+	g_array_free (records, TRUE);
+	g_string_free (names, TRUE);
+
+	g_mutex_unlock (&store_lock);
+}
@@ -0,0 +1,71 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-deep-count-cache.h - on-disk cache of what deep counts found in
+   each directory.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_DEEP_COUNT_CACHE_H
+#define NEMO_DEEP_COUNT_CACHE_H
+
+#include <glib.h>
+
+/* The cache remembers the direct contents of a directory, not its whole
+ * subtree: a change deep down doesn't touch the mtime of the directories
+ * above it, so those are still walked, just not enumerated.
+ */
+typedef struct NemoDeepCountCache NemoDeepCountCache;
+
+typedef struct {
+	guint64 device;
+	guint64 inode;
+	guint64 mtime;
+	guint32 mtime_usec;
+
+	/* Hidden ones are included in the directory and file counts */
+	guint32 directory_count;
+	guint32 file_count;
+	guint32 hidden_directory_count;
+	guint32 hidden_file_count;
+	guint64 size;
+
+	/* Subdirectories on the same filesystem, each name NUL-terminated */
+	const char *subdirectories;
+	guint32 subdirectories_length;
+} NemoDeepCountCacheEntry;
+
+/* A read-only snapshot of the cache, safe to use from any thread */
+NemoDeepCountCache *nemo_deep_count_cache_get    (void);
+void                nemo_deep_count_cache_unref  (NemoDeepCountCache      *cache);
+
+/* Fills in @entry if the cache has the directory with the device, inode
+ * and mtime in @entry.  The subdirectory names stay valid as long as
+ * @cache.
+ */
+gboolean            nemo_deep_count_cache_lookup (NemoDeepCountCache      *cache,
+						  NemoDeepCountCacheEntry *entry);
+
+/* Merges @entries (NemoDeepCountCacheEntry) into the cache file, and
+ * rewrites it if that changed anything.  @hits are the entries
+ * nemo_deep_count_cache_lookup() found, so they are kept longer.  Blocks
+ * on disk I/O, so call it from a thread; nemo_deep_count_cache_get()
+ * doesn't wait for it.
+ */
+void                nemo_deep_count_cache_store  (GArray                  *entries,
+						  GArray                  *hits);
+
+#endif /* NEMO_DEEP_COUNT_CACHE_H */
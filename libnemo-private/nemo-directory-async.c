@@ -28,7 +28,9 @@
 #include "nemo-directory-private.h"
 #include "nemo-file-attributes.h"
 #include "nemo-file-private.h"
+#include "nemo-deep-count-cache.h"
 #include "nemo-file-utilities.h"
+#include "nemo-inode-set.h"
 #include "nemo-signaller.h"
 #include "nemo-global-preferences.h"
 #include "nemo-link.h"
@@ -36,6 +38,7 @@
 #include <gtk/gtk.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <libxapp/xapp-favorites.h>
 
 /* turn this on to see messages about each load_directory call: */
@@ -58,6 +61,43 @@
 /* Keep async. jobs down to this number for all directories. */
 #define MAX_ASYNC_JOBS 10
 
+/* Shallow counts and MIME lists that one directory may have running at
+ * once, and how far down its work queue to look for files to start them
+ * for. */
+#define MAX_DIRECTORY_COUNTS_PER_DIRECTORY 4
+#define MAX_MIME_LISTS_PER_DIRECTORY 4
+#define SUBFOLDER_LOOKAHEAD 64
+
+/* Threads walking the tree of one deep count, and how often the totals
+ * they found so far are handed to the file. */
+#define DEEP_COUNT_MAX_WORKERS 8
+#define DEEP_COUNT_PROGRESS_INTERVAL 100
+
+#define DEEP_COUNT_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+	G_FILE_ATTRIBUTE_UNIX_DEVICE "," \
+	G_FILE_ATTRIBUTE_UNIX_INODE "," \
+	G_FILE_ATTRIBUTE_UNIX_NLINK "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+/* What a directory is found in the deep count cache by */
+#define DEEP_COUNT_CACHE_KEY_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+	G_FILE_ATTRIBUTE_UNIX_DEVICE "," \
+	G_FILE_ATTRIBUTE_UNIX_INODE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+/* Directories changed more recently than this (in seconds) aren't cached,
+ * they could change again without their mtime moving. */
+#define DEEP_COUNT_CACHE_MIN_AGE 2
+
 struct LinkInfoReadState {
 	NemoDirectory *directory;
 	GCancellable *cancellable;
@@ -121,15 +161,51 @@ struct DirectoryCountState {
 };
 
 struct DeepCountState {
-	NemoDirectory *directory;
+	NemoDirectory *directory; /* NULL once cancelled */
 	GCancellable *cancellable;
-	GFileEnumerator *enumerator;
-	GFile *deep_count_location;
-	GList *deep_count_subdirectories;
-	GArray *seen_deep_count_inodes;
 	char *fs_id;
+	gboolean show_hidden_files;
+	guint progress_timeout_id;
+	int n_running; /* atomic, workers that haven't exited yet */
+	NemoDeepCountCache *cache; /* NULL when not caching */
+
+	/* Shared with the workers, protected by lock */
+	GMutex lock;
+	GCond cond;
+	GQueue pending; /* DeepCountDirectory, directories nobody has enumerated yet */
+	int n_busy; /* workers enumerating a directory */
+	guint directory_count;
+	guint file_count;
+	guint unreadable_count;
+	guint hidden_count;
+	goffset size;
+	GArray *cache_entries; /* NemoDeepCountCacheEntry, to be stored */
+	GStringChunk *cache_names;
+	GArray *cache_hits; /* NemoDeepCountCacheEntry, found in the cache */
+
+	GMutex inode_lock;
+	NemoInodeSet *seen_deep_count_inodes;
 };
 
+typedef struct {
+	GFile *location;
+	GFileInfo *info; /* NULL when only the name is known */
+} DeepCountDirectory;
+
+/* What a worker found since it last added to the shared totals.  Hidden
+ * ones are included in the directory and file counts.
+ */
+typedef struct {
+	guint directory_count;
+	guint file_count;
+	guint hidden_directory_count;
+	guint hidden_file_count;
+	guint unreadable_count;
+	goffset size;
+	GList *subdirectories; /* DeepCountDirectory */
+	gboolean has_hard_links;
+} DeepCountTotals;
+
 struct FavoriteCheckState {
     NemoDirectory *directory;
 };
@@ -168,14 +244,16 @@ typedef gboolean (* FileCheck) (NemoFile *);
 
 /* Current number of async. jobs. */
 static int async_job_count;
+/* Number of directories with at least one of them. */
+static int busy_directory_count;
 static GHashTable *waiting_directories;
+/* Directories async_job_wake_up () is currently working through */
+static GHashTable *waking_directories;
 #ifdef DEBUG_ASYNC_JOBS
 static GHashTable *async_jobs;
 #endif
 
 /* Forward declarations for functions that need them. */
-static void     deep_count_load                               (DeepCountState         *state,
-							       GFile                  *location);
 static gboolean request_is_satisfied                          (NemoDirectory      *directory,
 							       NemoFile           *file,
 							       Request                 request);
@@ -328,6 +406,29 @@ nemo_directory_verify_request_counts (NemoDirectory *directory)
 }
 #endif
 
+/* A directory may always run one job, but beyond that it only gets its
+ * share of MAX_ASYNC_JOBS while other directories are busy or waiting.
+ */
+static gboolean
+async_job_over_fair_share (NemoDirectory *directory)
+{
+	int n_directories;
+
+	if (directory->details->async_job_count == 0) {
+		return FALSE;
+	}
+
+	n_directories = busy_directory_count;
+	if (waiting_directories != NULL) {
+		n_directories += g_hash_table_size (waiting_directories);
+		if (g_hash_table_contains (waiting_directories, directory)) {
+			n_directories -= 1;
+		}
+	}
+
+	return directory->details->async_job_count >= MAX (1, MAX_ASYNC_JOBS / MAX (n_directories, 1));
+}
+
 /* Start a job. This is really just a way of limiting the number of
  * async. requests that we issue at any given time. Without this, the
  * number of requests is unbounded.
@@ -347,7 +448,8 @@ async_job_start (NemoDirectory *directory,
 	g_assert (async_job_count >= 0);
 	g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
-	if (async_job_count >= MAX_ASYNC_JOBS) {
+	if (async_job_count >= MAX_ASYNC_JOBS ||
+	    async_job_over_fair_share (directory)) {
 		if (waiting_directories == NULL) {
 			waiting_directories = g_hash_table_new (NULL, NULL);
 		}
@@ -377,6 +479,9 @@ async_job_start (NemoDirectory *directory,
 #endif	
 
 	async_job_count += 1;
+	if (directory->details->async_job_count++ == 0) {
+		busy_directory_count += 1;
+	}
 	return TRUE;
 }
 
@@ -415,6 +520,10 @@ async_job_end (NemoDirectory *directory,
 #endif
 
 	async_job_count -= 1;
+	g_assert (directory->details->async_job_count > 0);
+	if (--directory->details->async_job_count == 0) {
+		busy_directory_count -= 1;
+	}
 }
 
 /* Helper to get one value from a hash table. */
@@ -457,37 +566,73 @@ async_job_wake_up (void)
 	}
 	
 	already_waking_up = TRUE;
+
+	/* Work from a snapshot: a directory that is still over its fair
+	 * share goes straight back into waiting_directories, and must not
+	 * be picked again in this round. */
+	waking_directories = waiting_directories;
+	waiting_directories = NULL;
+
 	while (async_job_count < MAX_ASYNC_JOBS) {
-		value = get_one_value (waiting_directories);
+		value = get_one_value (waking_directories);
 		if (value == NULL) {
 			break;
 		}
-		g_hash_table_remove (waiting_directories, value);
+		g_hash_table_remove (waking_directories, value);
 		nemo_directory_async_state_changed
 			(NEMO_DIRECTORY (value));
 	}
+
+	/* Whoever didn't get a turn keeps waiting. */
+	while ((value = get_one_value (waking_directories)) != NULL) {
+		g_hash_table_remove (waking_directories, value);
+		if (waiting_directories == NULL) {
+			waiting_directories = g_hash_table_new (NULL, NULL);
+		}
+		g_hash_table_insert (waiting_directories, value, value);
+	}
+	g_clear_pointer (&waking_directories, g_hash_table_destroy);
+
 	already_waking_up = FALSE;
 }
 
 static void
 directory_count_cancel (NemoDirectory *directory)
 {
-	if (directory->details->count_in_progress != NULL) {
-		g_cancellable_cancel (directory->details->count_in_progress->cancellable);
+	GList *node;
+	DirectoryCountState *state;
+
+	for (node = directory->details->count_in_progress; node != NULL; node = node->next) {
+		state = node->data;
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
 static void
 deep_count_cancel (NemoDirectory *directory)
 {
-	if (directory->details->deep_count_in_progress != NULL) {
+	DeepCountState *state;
+
+	state = directory->details->deep_count_in_progress;
+
+	if (state != NULL) {
 		g_assert (NEMO_IS_FILE (directory->details->deep_count_file));
 		
-		g_cancellable_cancel (directory->details->deep_count_in_progress->cancellable);
+		g_cancellable_cancel (state->cancellable);
+
+		/* Wake up workers waiting for more directories */
+		g_mutex_lock (&state->lock);
+		g_cond_broadcast (&state->cond);
+		g_mutex_unlock (&state->lock);
+
+		if (state->progress_timeout_id != 0) {
+			g_source_remove (state->progress_timeout_id);
+			state->progress_timeout_id = 0;
+		}
 
 		directory->details->deep_count_file->details->deep_counts_status = NEMO_REQUEST_NOT_STARTED;
 
-		directory->details->deep_count_in_progress->directory = NULL;
+		state->directory = NULL;
 		directory->details->deep_count_in_progress = NULL;
 		directory->details->deep_count_file = NULL;
 
@@ -498,8 +643,12 @@ deep_count_cancel (NemoDirectory *directory)
 static void
 mime_list_cancel (NemoDirectory *directory)
 {
-	if (directory->details->mime_list_in_progress != NULL) {
-		g_cancellable_cancel (directory->details->mime_list_in_progress->cancellable);
+	GList *node;
+	MimeListState *state;
+
+	for (node = directory->details->mime_list_in_progress; node != NULL; node = node->next) {
+		state = node->data;
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
@@ -1569,19 +1718,25 @@ nemo_async_destroying_file (NemoFile *file)
 	/* Check if it's a file that's currently being worked on.
 	 * If so, make that NULL so it gets canceled right away.
 	 */
-	if (directory->details->count_in_progress != NULL &&
-	    directory->details->count_in_progress->count_file == file) {
-		directory->details->count_in_progress->count_file = NULL;
-		changed = TRUE;
+	for (node = directory->details->count_in_progress; node != NULL; node = node->next) {
+		DirectoryCountState *count_state = node->data;
+
+		if (count_state->count_file == file) {
+			count_state->count_file = NULL;
+			changed = TRUE;
+		}
 	}
 	if (directory->details->deep_count_file == file) {
 		directory->details->deep_count_file = NULL;
 		changed = TRUE;
 	}
-	if (directory->details->mime_list_in_progress != NULL &&
-	    directory->details->mime_list_in_progress->mime_list_file == file) {
-		directory->details->mime_list_in_progress->mime_list_file = NULL;
-		changed = TRUE;
+	for (node = directory->details->mime_list_in_progress; node != NULL; node = node->next) {
+		MimeListState *mime_list_state = node->data;
+
+		if (mime_list_state->mime_list_file == file) {
+			mime_list_state->mime_list_file = NULL;
+			changed = TRUE;
+		}
 	}
 	if (directory->details->get_info_file == file) {
 		directory->details->get_info_file = NULL;
@@ -2283,23 +2438,63 @@ is_needy (NemoFile *file,
 static void
 directory_count_stop (NemoDirectory *directory)
 {
+	GList *node;
+	DirectoryCountState *state;
 	NemoFile *file;
 
-	if (directory->details->count_in_progress != NULL) {
-		file = directory->details->count_in_progress->count_file;
+	for (node = directory->details->count_in_progress; node != NULL; node = node->next) {
+		state = node->data;
+		file = state->count_file;
 		if (file != NULL) {
 			g_assert (NEMO_IS_FILE (file));
 			g_assert (file->details->directory == directory);
 			if (is_needy (file,
 				      should_get_directory_count_now,
 				      REQUEST_DIRECTORY_COUNT)) {
-				return;
+				continue;
 			}
 		}
 
 		/* The count is not wanted, so stop it. */
-		directory_count_cancel (directory);
+		g_cancellable_cancel (state->cancellable);
+	}
+}
+
+static DirectoryCountState *
+directory_count_find (NemoDirectory *directory,
+		      NemoFile *file)
+{
+	GList *node;
+	DirectoryCountState *state;
+
+	for (node = directory->details->count_in_progress; node != NULL; node = node->next) {
+		state = node->data;
+		if (state->count_file == file) {
+			return state;
+		}
 	}
+
+	return NULL;
+}
+
+static void
+directory_count_add (NemoDirectory *directory,
+		     DirectoryCountState *state)
+{
+	directory->details->count_in_progress =
+		g_list_prepend (directory->details->count_in_progress, state);
+	directory->details->count_in_progress_length += 1;
+}
+
+static void
+directory_count_remove (NemoDirectory *directory,
+			DirectoryCountState *state)
+{
+	g_assert (directory->details->count_in_progress_length > 0);
+
+	directory->details->count_in_progress =
+		g_list_remove (directory->details->count_in_progress, state);
+	directory->details->count_in_progress_length -= 1;
 }
 
 static guint
@@ -2320,11 +2515,16 @@ count_non_skipped_files (GList *list)
 }
 
 static void
-count_children_done (NemoDirectory *directory,
-		     NemoFile *count_file,
+count_children_done (DirectoryCountState *state,
 		     gboolean succeeded,
 		     int count)
 {
+	NemoDirectory *directory;
+	NemoFile *count_file;
+
+	directory = state->directory;
+	count_file = state->count_file;
+
 	g_assert (NEMO_IS_FILE (count_file));
 
 	count_file->details->directory_count_is_up_to_date = TRUE;
@@ -2339,7 +2539,7 @@ count_children_done (NemoDirectory *directory,
 		count_file->details->got_directory_count = TRUE;
 		count_file->details->directory_count = count;
 	}
-	directory->details->count_in_progress = NULL;
+	directory_count_remove (directory, state);
 
 	/* Send file-changed even if count failed, so interested parties can
 	 * distinguish between unknowable and not-yet-known cases.
@@ -2381,7 +2581,7 @@ count_more_files_callback (GObject *source_object,
 	
 	if (g_cancellable_is_cancelled (state->cancellable)) {
 		/* Operation was cancelled. Bail out */
-		directory->details->count_in_progress = NULL;
+		directory_count_remove (directory, state);
 
 		async_job_end (directory, "directory count");
 		nemo_directory_async_state_changed (directory);
@@ -2391,8 +2591,7 @@ count_more_files_callback (GObject *source_object,
 		return;
 	}
 
-	g_assert (directory->details->count_in_progress != NULL);
-	g_assert (directory->details->count_in_progress == state);
+	g_assert (g_list_find (directory->details->count_in_progress, state) != NULL);
 
 	error = NULL;
 	files = g_file_enumerator_next_files_finish (state->enumerator,
@@ -2401,8 +2600,7 @@ count_more_files_callback (GObject *source_object,
 	state->file_count += count_non_skipped_files (files);
 	
 	if (files == NULL) {
-		count_children_done (directory, state->count_file,
-				     TRUE, state->file_count);
+		count_children_done (state, TRUE, state->file_count);
 		directory_count_state_free (state);
 	} else {
 		g_file_enumerator_next_files_async (state->enumerator,
@@ -2435,7 +2633,7 @@ count_children_callback (GObject *source_object,
 	if (g_cancellable_is_cancelled (state->cancellable)) {
 		/* Operation was cancelled. Bail out */
 		directory = state->directory;
-		directory->details->count_in_progress = NULL;
+		directory_count_remove (directory, state);
 
 		async_job_end (directory, "directory count");
 		nemo_directory_async_state_changed (directory);
@@ -2450,9 +2648,7 @@ count_children_callback (GObject *source_object,
 							res, &error);
 
 	if (enumerator == NULL) {
-		count_children_done (state->directory,
-				     state->count_file,
-				     FALSE, 0);
+		count_children_done (state, FALSE, 0);
 		g_error_free (error);
 		directory_count_state_free (state);
 		return;
@@ -2468,45 +2664,18 @@ count_children_callback (GObject *source_object,
 }
 
 static void
-directory_count_start (NemoDirectory *directory,
-		       NemoFile *file,
-		       gboolean *doing_io)
+directory_count_load (NemoDirectory *directory,
+		      NemoFile *file)
 {
 	DirectoryCountState *state;
 	GFile *location;
 
-	if (directory->details->count_in_progress != NULL) {
-		*doing_io = TRUE;
-		return;
-	}
-
-	if (!is_needy (file, 
-		       should_get_directory_count_now,
-		       REQUEST_DIRECTORY_COUNT)) {
-		return;
-	}
-	*doing_io = TRUE;
-
-	if (!nemo_file_is_directory (file)) {
-		file->details->directory_count_is_up_to_date = TRUE;
-		file->details->directory_count_failed = FALSE;
-		file->details->got_directory_count = FALSE;
-		
-		nemo_directory_async_state_changed (directory);
-		return;
-	}
-
-	if (!async_job_start (directory, "directory count")) {
-		return;
-	}
-
-	/* Start counting. */
 	state = g_new0 (DirectoryCountState, 1);
 	state->count_file = file;
 	state->directory = nemo_directory_ref (directory);
 	state->cancellable = g_cancellable_new ();
 	
-	directory->details->count_in_progress = state;
+	directory_count_add (directory, state);
 	
 	location = nemo_file_get_location (file);
 #ifdef DEBUG_LOAD_DIRECTORY		
@@ -2530,206 +2699,476 @@ directory_count_start (NemoDirectory *directory,
 	g_object_unref (location);
 }
 
-static inline gboolean
-seen_inode (DeepCountState *state,
-	    GFileInfo *info)
+static void
+directory_count_start (NemoDirectory *directory,
+		       NemoFile *file,
+		       gboolean *doing_io)
 {
-	guint64 inode, inode2;
-	guint i;
+	if (directory_count_find (directory, file) != NULL) {
+		*doing_io = TRUE;
+		return;
+	}
 
-	inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+	if (!is_needy (file, 
+		       should_get_directory_count_now,
+		       REQUEST_DIRECTORY_COUNT)) {
+		return;
+	}
+	*doing_io = TRUE;
 
-	if (inode != 0) {
-		for (i = 0; i < state->seen_deep_count_inodes->len; i++) {
-			inode2 = g_array_index (state->seen_deep_count_inodes, guint64, i);
-			if (inode == inode2) {
-				return TRUE;
-			}
-		}
+	if (!nemo_file_is_directory (file)) {
+		file->details->directory_count_is_up_to_date = TRUE;
+		file->details->directory_count_failed = FALSE;
+		file->details->got_directory_count = FALSE;
+		
+		nemo_directory_async_state_changed (directory);
+		return;
 	}
 
-	return FALSE;
+	if (directory->details->count_in_progress_length >= MAX_DIRECTORY_COUNTS_PER_DIRECTORY) {
+		return;
+	}
+
+	if (!async_job_start (directory, "directory count")) {
+		return;
+	}
+
+	directory_count_load (directory, file);
 }
 
-static inline void
-mark_inode_as_seen (DeepCountState *state,
-		    GFileInfo *info)
+/* Only files with more than one link can turn up again later in the walk,
+ * so those are the only ones worth remembering.  Directories can't be
+ * hard linked.  Without a link count (non-native backends) every inode is
+ * remembered, as before.
+ */
+static gboolean
+seen_inode (DeepCountState *state,
+	    GFileInfo *info)
 {
 	guint64 inode;
+	guint32 device;
+	gboolean added;
+
+	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+		return FALSE;
+	}
+
+	if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_NLINK) &&
+	    g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK) <= 1) {
+		return FALSE;
+	}
 
 	inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
-	if (inode != 0) {
-		g_array_append_val (state->seen_deep_count_inodes, inode);
+	device = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+
+	if (inode == 0) {
+		return FALSE;
 	}
+
+	/* Adding fails when the pair was already there */
+	g_mutex_lock (&state->inode_lock);
+	added = nemo_inode_set_add (state->seen_deep_count_inodes, device, inode);
+	g_mutex_unlock (&state->inode_lock);
+
+	return !added;
+}
+
+static DeepCountDirectory *
+deep_count_directory_new (GFile *location,
+			  GFileInfo *info)
+{
+	DeepCountDirectory *dir;
+
+	dir = g_slice_new (DeepCountDirectory);
+	dir->location = location;
+	dir->info = info;
+
+	return dir;
+}
+
+static void
+deep_count_directory_free (DeepCountDirectory *dir)
+{
+	g_object_unref (dir->location);
+	g_clear_object (&dir->info);
+	g_slice_free (DeepCountDirectory, dir);
 }
 
+/* Called from the worker threads */
 static void
 deep_count_one (DeepCountState *state,
-		GFileInfo *info)
+		GFile *location,
+		GFileInfo *info,
+		DeepCountTotals *totals)
 {
-	NemoFile *file;
 	GFile *subdir;
 	gboolean is_seen_inode;
 	const char *id;
-    gboolean hidden;
-	is_seen_inode = seen_inode (state, info);
-	if (!is_seen_inode) {
-		mark_inode_as_seen (state, info);
-	}
+	gboolean hidden;
 
-	file = state->directory->details->deep_count_file;
+	is_seen_inode = seen_inode (state, info);
 
-    hidden = should_skip_file (NULL, info);
+	hidden = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN) ||
+		 g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP);
 
 	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
 		/* Count the directory. */
-        if (hidden) {
-            file->details->deep_hidden_count += 1;
-        } else {
-            file->details->deep_directory_count += 1;
-        }
+		totals->directory_count += 1;
+		if (hidden) {
+			totals->hidden_directory_count += 1;
+		}
 		/* Record the fact that we have to descend into this directory. */
 		id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
 		if (g_strcmp0 (id, state->fs_id) == 0) {
 			/* only if it is on the same filesystem */
-			subdir = g_file_get_child (state->deep_count_location, g_file_info_get_name (info));
-			state->deep_count_subdirectories = g_list_prepend
-				(state->deep_count_subdirectories, subdir);
+			subdir = g_file_get_child (location, g_file_info_get_name (info));
+			totals->subdirectories = g_list_prepend (totals->subdirectories,
+								 deep_count_directory_new (subdir, g_object_ref (info)));
 		}
 	} else {
 		/* Even non-regular files count as files. */
-        if (hidden) {
-            file->details->deep_hidden_count += 1;
-        } else {
-            file->details->deep_file_count += 1;
-        }
+		totals->file_count += 1;
+		if (hidden) {
+			totals->hidden_file_count += 1;
+		}
+
+		if (g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK) != 1) {
+			totals->has_hard_links = TRUE;
+		}
 	}
 
 	/* Count the size, hidden or not */
 	if (!is_seen_inode && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE)) {
-		file->details->deep_size += g_file_info_get_size (info);
+		totals->size += g_file_info_get_size (info);
 	}
 }
 
+/* Adds what a worker found to the shared totals and hands the directories
+ * it found to whoever is idle.  @finished means the worker is done with
+ * its directory.
+ */
 static void
-deep_count_state_free (DeepCountState *state)
+deep_count_add_totals (DeepCountState *state,
+		       DeepCountTotals *totals,
+		       gboolean finished)
 {
-	if (state->enumerator) {
-		if (!g_file_enumerator_is_closed (state->enumerator)) {
-			g_file_enumerator_close_async (state->enumerator,
-						       0, NULL, NULL, NULL);
-		}
-		g_object_unref (state->enumerator);
+	GList *l;
+	gboolean wake_up;
+
+	g_mutex_lock (&state->lock);
+
+	if (state->show_hidden_files) {
+		state->directory_count += totals->directory_count;
+		state->file_count += totals->file_count;
+	} else {
+		state->directory_count += totals->directory_count - totals->hidden_directory_count;
+		state->file_count += totals->file_count - totals->hidden_file_count;
+		state->hidden_count += totals->hidden_directory_count + totals->hidden_file_count;
 	}
-	g_object_unref (state->cancellable);
-	if (state->deep_count_location) {
-		g_object_unref (state->deep_count_location);
+	state->unreadable_count += totals->unreadable_count;
+	state->size += totals->size;
+
+	wake_up = totals->subdirectories != NULL;
+
+	/* Depth first, like the walk always was, to keep the queue short */
+	for (l = totals->subdirectories; l != NULL; l = l->next) {
+		g_queue_push_head (&state->pending, l->data);
 	}
-	g_list_free_full (state->deep_count_subdirectories, g_object_unref);
-	g_array_free (state->seen_deep_count_inodes, TRUE);
-	g_free (state->fs_id);
-	g_free (state);
+
+	if (finished) {
+		state->n_busy--;
+		wake_up |= state->n_busy == 0;
+	}
+
+	if (wake_up) {
+		g_cond_broadcast (&state->cond);
+	}
+
+	g_mutex_unlock (&state->lock);
+
+	g_list_free (totals->subdirectories);
+	memset (totals, 0, sizeof (DeepCountTotals));
 }
 
-static void
-deep_count_next_dir (DeepCountState *state)
+static gboolean
+deep_count_get_cache_key (GFileInfo *info,
+			  NemoDeepCountCacheEntry *entry)
 {
-	GFile *location;
-	NemoFile *file;
-	NemoDirectory *directory;
-	gboolean done;
+	memset (entry, 0, sizeof (NemoDeepCountCacheEntry));
 
-	directory = state->directory;
-	
-	g_object_unref (state->deep_count_location);
-	state->deep_count_location = NULL;
+	if (info == NULL ||
+	    !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE) ||
+	    !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		return FALSE;
+	}
 
-	done = FALSE;
-	file = directory->details->deep_count_file;
-	
-	if (state->deep_count_subdirectories != NULL) {
-		/* Work on a new directory. */
-		location = state->deep_count_subdirectories->data;
-		state->deep_count_subdirectories = g_list_remove
-			(state->deep_count_subdirectories, location);
-		deep_count_load (state, location);
-		g_object_unref (location);
-	} else {
-		file->details->deep_counts_status = NEMO_REQUEST_DONE;
-		directory->details->deep_count_file = NULL;
-		directory->details->deep_count_in_progress = NULL;
-		deep_count_state_free (state);
-		done = TRUE;
+	entry->device = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+	entry->inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+	entry->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	entry->mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+	return TRUE;
+}
+
+static gboolean
+deep_count_load_from_cache (DeepCountState *state,
+			    DeepCountDirectory *dir,
+			    NemoDeepCountCacheEntry *entry)
+{
+	DeepCountTotals totals = { 0 };
+	const char *name, *end;
+
+	if (!nemo_deep_count_cache_lookup (state->cache, entry)) {
+		return FALSE;
 	}
-	
-	nemo_file_updated_deep_count_in_progress (file);
 
-	if (done) {
-		nemo_file_changed (file);
-		async_job_end (directory, "deep count");
-		nemo_directory_async_state_changed (directory);
+	g_mutex_lock (&state->lock);
+	g_array_append_val (state->cache_hits, *entry);
+	g_mutex_unlock (&state->lock);
+
+	totals.directory_count = entry->directory_count;
+	totals.file_count = entry->file_count;
+	totals.hidden_directory_count = entry->hidden_directory_count;
+	totals.hidden_file_count = entry->hidden_file_count;
+	totals.size = entry->size;
+
+	end = entry->subdirectories + entry->subdirectories_length;
+
+	for (name = entry->subdirectories; name < end; name += strlen (name) + 1) {
+		totals.subdirectories = g_list_prepend (totals.subdirectories,
+							deep_count_directory_new (g_file_get_child (dir->location, name), NULL));
 	}
+
+	deep_count_add_totals (state, &totals, TRUE);
+
+	return TRUE;
 }
 
+/* Adds one batch of what was found in a directory to its cache entry */
 static void
-deep_count_more_files_callback (GObject *source_object,
-				GAsyncResult *res,
-				gpointer user_data)
+deep_count_add_to_cache_entry (NemoDeepCountCacheEntry *entry,
+			       GString *names,
+			       DeepCountTotals *totals)
 {
-	DeepCountState *state;
-	NemoDirectory *directory;
-	GList *files, *l;
-	GFileInfo *info;
+	DeepCountDirectory *subdir;
+	GList *l;
 
-	state = user_data;
+	entry->directory_count += totals->directory_count;
+	entry->file_count += totals->file_count;
+	entry->hidden_directory_count += totals->hidden_directory_count;
+	entry->hidden_file_count += totals->hidden_file_count;
+	entry->size += totals->size;
 
-	if (state->directory == NULL) {
-		/* Operation was cancelled. Bail out */
-		deep_count_state_free (state);
-		return;
+	for (l = totals->subdirectories; l != NULL; l = l->next) {
+		subdir = l->data;
+		g_string_append (names, g_file_info_get_name (subdir->info));
+		g_string_append_c (names, '\0');
 	}
+}
 
-	directory = nemo_directory_ref (state->directory);
-	
-	g_assert (directory->details->deep_count_in_progress != NULL);
-	g_assert (directory->details->deep_count_in_progress == state);
+static void
+deep_count_remember (DeepCountState *state,
+		     NemoDeepCountCacheEntry *entry,
+		     GString *names)
+{
+	g_mutex_lock (&state->lock);
 
-	files = g_file_enumerator_next_files_finish (state->enumerator,
-						     res, NULL);
+	entry->subdirectories = g_string_chunk_insert_len (state->cache_names, names->str, names->len);
+	entry->subdirectories_length = names->len;
+	g_array_append_val (state->cache_entries, *entry);
 
-	for (l = files; l != NULL; l = l->next)	{
-		info = l->data;
-		deep_count_one (state, info);
-		g_object_unref (info);
+	g_mutex_unlock (&state->lock);
+}
+
+static void
+deep_count_directory (DeepCountState *state,
+		      DeepCountDirectory *dir)
+{
+	DeepCountTotals totals = { 0 };
+	NemoDeepCountCacheEntry entry = { 0 };
+	GFileEnumerator *enumerator;
+	GList *files, *l;
+	GString *names;
+	GError *error = NULL;
+	const char *id;
+	gboolean cacheable;
+
+	cacheable = FALSE;
+
+	if (state->cache != NULL) {
+		/* Directories only known by name from a cached parent */
+		if (dir->info == NULL) {
+			dir->info = g_file_query_info (dir->location,
+						       DEEP_COUNT_CACHE_KEY_ATTRIBUTES,
+						       G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+						       state->cancellable,
+						       NULL);
+
+			/* Something could have been mounted on it since it
+			 * was cached; it was counted, but isn't descended
+			 * into, same as in deep_count_one() */
+			if (dir->info != NULL) {
+				id = g_file_info_get_attribute_string (dir->info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+				if (g_strcmp0 (id, state->fs_id) != 0) {
+					deep_count_add_totals (state, &totals, TRUE);
+					return;
+				}
+			}
+		}
+
+		if (deep_count_get_cache_key (dir->info, &entry)) {
+			if (deep_count_load_from_cache (state, dir, &entry)) {
+				return;
+			}
+
+			cacheable = entry.mtime + DEEP_COUNT_CACHE_MIN_AGE < (guint64) (g_get_real_time () / G_USEC_PER_SEC);
+		}
 	}
-	
-	if (files == NULL) {
-		g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-		g_object_unref (state->enumerator);
-		state->enumerator = NULL;
-		
-		deep_count_next_dir (state);
-	} else {
-		g_file_enumerator_next_files_async (state->enumerator,
-						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-						    G_PRIORITY_LOW,
-						    state->cancellable,
-						    deep_count_more_files_callback,
-						    state);
+
+#ifdef DEBUG_LOAD_DIRECTORY		
+	g_message ("load_directory called to get deep file count for %p", dir->location);
+#endif	
+	enumerator = g_file_enumerate_children (dir->location,
+						DEEP_COUNT_ATTRIBUTES,
+						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+						state->cancellable,
+						NULL);
+
+	if (enumerator == NULL) {
+		totals.unreadable_count = 1;
+		deep_count_add_totals (state, &totals, TRUE);
+		return;
 	}
 
-	g_list_free (files);
+	names = g_string_new (NULL);
 
-	nemo_directory_unref (directory);
+	while ((files = g_file_enumerator_next_files (enumerator,
+						      DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+						      state->cancellable,
+						      &error)) != NULL) {
+		for (l = files; l != NULL; l = l->next) {
+			deep_count_one (state, dir->location, l->data, &totals);
+		}
+		g_list_free_full (files, g_object_unref);
+
+		if (cacheable) {
+			cacheable = !totals.has_hard_links;
+			deep_count_add_to_cache_entry (&entry, names, &totals);
+		}
+
+		/* Let idle workers start on subdirectories of big directories early */
+		deep_count_add_totals (state, &totals, FALSE);
+	}
+
+	/* A directory that was only partly read is no use to the cache */
+	if (error != NULL) {
+		cacheable = FALSE;
+		g_error_free (error);
+	}
+
+	g_file_enumerator_close (enumerator, NULL, NULL);
+	g_object_unref (enumerator);
+
+	if (cacheable) {
+		deep_count_remember (state, &entry, names);
+	}
+	g_string_free (names, TRUE);
+
+	deep_count_add_totals (state, &totals, TRUE);
+}
+
+/* Returns NULL when the walk is over: nothing is queued and no worker is
+ * still enumerating a directory that could add more, or it was cancelled.
+ */
+static DeepCountDirectory *
+deep_count_next_directory (DeepCountState *state)
+{
+	DeepCountDirectory *dir = NULL;
+
+	g_mutex_lock (&state->lock);
+
+	while (g_queue_is_empty (&state->pending) &&
+	       state->n_busy > 0 &&
+	       !g_cancellable_is_cancelled (state->cancellable)) {
+		g_cond_wait (&state->cond, &state->lock);
+	}
+
+	if (!g_cancellable_is_cancelled (state->cancellable)) {
+		dir = g_queue_pop_head (&state->pending);
+	}
+
+	if (dir != NULL) {
+		state->n_busy++;
+	}
+
+	g_mutex_unlock (&state->lock);
+
+	return dir;
 }
 
 static void
-deep_count_callback (GObject *source_object,
-		     GAsyncResult *res,
-		     gpointer user_data)
+deep_count_state_free (DeepCountState *state)
+{
+	DeepCountDirectory *dir;
+
+	while ((dir = g_queue_pop_head (&state->pending)) != NULL) {
+		deep_count_directory_free (dir);
+	}
+
+	if (state->cache != NULL) {
+		nemo_deep_count_cache_unref (state->cache);
+	}
+	g_array_free (state->cache_entries, TRUE);
+	g_string_chunk_free (state->cache_names);
+	g_array_free (state->cache_hits, TRUE);
+
+	g_object_unref (state->cancellable);
+	g_mutex_clear (&state->lock);
+	g_cond_clear (&state->cond);
+	g_mutex_clear (&state->inode_lock);
+	nemo_inode_set_free (state->seen_deep_count_inodes);
+	g_free (state->fs_id);
+	g_free (state);
+}
+
+static void
+deep_count_update_file (DeepCountState *state,
+			NemoFile *file)
+{
+	g_mutex_lock (&state->lock);
+
+	file->details->deep_directory_count = state->directory_count;
+	file->details->deep_file_count = state->file_count;
+	file->details->deep_unreadable_count = state->unreadable_count;
+	file->details->deep_hidden_count = state->hidden_count;
+	file->details->deep_size = state->size;
+
+	g_mutex_unlock (&state->lock);
+}
+
+static gboolean
+deep_count_progress_callback (gpointer user_data)
 {
 	DeepCountState *state;
-	GFileEnumerator *enumerator;
+	NemoFile *file;
+
+	state = user_data;
+	file = state->directory->details->deep_count_file;
+
+	if (file != NULL) {
+		deep_count_update_file (state, file);
+		nemo_file_updated_deep_count_in_progress (file);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Runs in the main loop once the last worker has exited */
+static gboolean
+deep_count_done (gpointer user_data)
+{
+	DeepCountState *state;
+	NemoDirectory *directory;
 	NemoFile *file;
 
 	state = user_data;
@@ -2737,50 +3176,59 @@ deep_count_callback (GObject *source_object,
 	if (state->directory == NULL) {
 		/* Operation was cancelled. Bail out */
 		deep_count_state_free (state);
-		return;
+		return G_SOURCE_REMOVE;
 	}
 
-	file = state->directory->details->deep_count_file;
+	directory = nemo_directory_ref (state->directory);
+	file = directory->details->deep_count_file;
 
-	enumerator = g_file_enumerate_children_finish  (G_FILE (source_object),	res, NULL);
-	
-	if (enumerator == NULL) {
-		file->details->deep_unreadable_count += 1;
-		
-		deep_count_next_dir (state);
-	} else {
-		state->enumerator = enumerator;
-		g_file_enumerator_next_files_async (state->enumerator,
-						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-						    G_PRIORITY_LOW,
-						    state->cancellable,
-						    deep_count_more_files_callback,
-						    state);
+	g_assert (directory->details->deep_count_in_progress == state);
+
+	if (state->progress_timeout_id != 0) {
+		g_source_remove (state->progress_timeout_id);
 	}
-}
 
+	directory->details->deep_count_file = NULL;
+	directory->details->deep_count_in_progress = NULL;
 
-static void
-deep_count_load (DeepCountState *state, GFile *location)
+	if (file != NULL) {
+		deep_count_update_file (state, file);
+		file->details->deep_counts_status = NEMO_REQUEST_DONE;
+		nemo_file_updated_deep_count_in_progress (file);
+		nemo_file_changed (file);
+	}
+
+	deep_count_state_free (state);
+
+	async_job_end (directory, "deep count");
+	nemo_directory_async_state_changed (directory);
+
+	nemo_directory_unref (directory);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+deep_count_worker_func (gpointer user_data)
 {
-	state->deep_count_location = g_object_ref (location);
+	DeepCountState *state;
+	DeepCountDirectory *dir;
 
-#ifdef DEBUG_LOAD_DIRECTORY		
-	g_message ("load_directory called to get deep file count for %p", location);
-#endif	
-	g_file_enumerate_children_async (state->deep_count_location,
-					 G_FILE_ATTRIBUTE_STANDARD_NAME ","
-					 G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-					 G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-					 G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
-					 G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP ","
-					 G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
-					 G_FILE_ATTRIBUTE_UNIX_INODE,
-					 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
-					 G_PRIORITY_LOW, /* prio */
-					 state->cancellable,
-					 deep_count_callback,
-					 state);
+	state = user_data;
+
+	while ((dir = deep_count_next_directory (state)) != NULL) {
+		deep_count_directory (state, dir);
+		deep_count_directory_free (dir);
+	}
+
+	if (g_atomic_int_dec_and_test (&state->n_running)) {
+		/* Everything counted so far is right, even when cancelled */
+		nemo_deep_count_cache_store (state->cache_entries, state->cache_hits);
+
+		g_idle_add (deep_count_done, state);
+	}
+
+	return NULL;
 }
 
 static void
@@ -2814,6 +3262,8 @@ deep_count_got_info (GObject *source_object,
 	const char *id;
 	GFile *file = (GFile *)source_object;
 	DeepCountState *state = (DeepCountState *)user_data;
+	GThread *thread;
+	int n_workers, i;
 
 	info = g_file_query_info_finish (file,
 					 res,
@@ -2821,9 +3271,36 @@ deep_count_got_info (GObject *source_object,
 	if (info) {
 		id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
 		state->fs_id = g_strdup (id);
-		g_object_unref (info);
 	}
-	deep_count_load (state, file);
+
+	if (state->directory == NULL) {
+		/* Operation was cancelled. Bail out */
+		g_clear_object (&info);
+		deep_count_state_free (state);
+		return;
+	}
+
+	/* Remote locations get one worker, they don't get any faster by
+	 * asking the server more things at once. */
+	if (g_file_is_native (file)) {
+		n_workers = CLAMP (g_get_num_processors (), 2, DEEP_COUNT_MAX_WORKERS);
+		state->cache = nemo_deep_count_cache_get ();
+	} else {
+		n_workers = 1;
+	}
+
+	g_queue_push_head (&state->pending,
+			   deep_count_directory_new (g_object_ref (file), info));
+	state->n_running = n_workers;
+
+	for (i = 0; i < n_workers; i++) {
+		thread = g_thread_new ("nemo-deep-count", deep_count_worker_func, state);
+		g_thread_unref (thread);
+	}
+
+	state->progress_timeout_id = g_timeout_add (DEEP_COUNT_PROGRESS_INTERVAL,
+						    deep_count_progress_callback,
+						    state);
 }
 
 static void
@@ -2869,14 +3346,24 @@ deep_count_start (NemoDirectory *directory,
 	state = g_new0 (DeepCountState, 1);
 	state->directory = directory;
 	state->cancellable = g_cancellable_new ();
-	state->seen_deep_count_inodes = g_array_new (FALSE, TRUE, sizeof (guint64));
+	state->show_hidden_files = g_settings_get_boolean (nemo_preferences,
+							   NEMO_PREFERENCES_SHOW_HIDDEN_FILES);
+	g_mutex_init (&state->lock);
+	g_cond_init (&state->cond);
+	g_queue_init (&state->pending);
+	state->cache_entries = g_array_new (FALSE, FALSE, sizeof (NemoDeepCountCacheEntry));
+	state->cache_names = g_string_chunk_new (4096);
+	state->cache_hits = g_array_new (FALSE, FALSE, sizeof (NemoDeepCountCacheEntry));
+	g_mutex_init (&state->inode_lock);
+	state->seen_deep_count_inodes = nemo_inode_set_new ();
 
 	directory->details->deep_count_in_progress = state;
 	
 	location = nemo_file_get_location (file);
 	state->fs_id = NULL;
 	g_file_query_info_async (location,
-				 G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+				 G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
+				 DEEP_COUNT_CACHE_KEY_ATTRIBUTES,
 				 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 				 G_PRIORITY_DEFAULT,
 				 NULL,
@@ -2888,23 +3375,63 @@ deep_count_start (NemoDirectory *directory,
 static void
 mime_list_stop (NemoDirectory *directory)
 {
+	GList *node;
+	MimeListState *state;
 	NemoFile *file;
 
-	if (directory->details->mime_list_in_progress != NULL) {
-		file = directory->details->mime_list_in_progress->mime_list_file;
+	for (node = directory->details->mime_list_in_progress; node != NULL; node = node->next) {
+		state = node->data;
+		file = state->mime_list_file;
 		if (file != NULL) {
 			g_assert (NEMO_IS_FILE (file));
 			g_assert (file->details->directory == directory);
 			if (is_needy (file,
 				      should_get_mime_list,
 				      REQUEST_MIME_LIST)) {
-				return;
+				continue;
 			}
 		}
 		
 		/* The count is not wanted, so stop it. */
-		mime_list_cancel (directory);
+		g_cancellable_cancel (state->cancellable);
+	}
+}
+
+static MimeListState *
+mime_list_find (NemoDirectory *directory,
+		NemoFile *file)
+{
+	GList *node;
+	MimeListState *state;
+
+	for (node = directory->details->mime_list_in_progress; node != NULL; node = node->next) {
+		state = node->data;
+		if (state->mime_list_file == file) {
+			return state;
+		}
 	}
+
+	return NULL;
+}
+
+static void
+mime_list_add (NemoDirectory *directory,
+	       MimeListState *state)
+{
+	directory->details->mime_list_in_progress =
+		g_list_prepend (directory->details->mime_list_in_progress, state);
+	directory->details->mime_list_in_progress_length += 1;
+}
+
+static void
+mime_list_remove (NemoDirectory *directory,
+		  MimeListState *state)
+{
+	g_assert (directory->details->mime_list_in_progress_length > 0);
+
+	directory->details->mime_list_in_progress =
+		g_list_remove (directory->details->mime_list_in_progress, state);
+	directory->details->mime_list_in_progress_length -= 1;
 }
 
 static void
@@ -2944,7 +3471,7 @@ mime_list_done (MimeListState *state, gboolean success)
 		file->details->got_mime_list = TRUE;
 		file->details->mime_list = istr_set_get_as_list	(state->mime_list_hash);
 	}
-	directory->details->mime_list_in_progress = NULL;
+	mime_list_remove (directory, state);
 
 	/* Send file-changed even if getting the item type list
 	 * failed, so interested parties can distinguish between
@@ -2995,7 +3522,7 @@ mime_list_callback (GObject *source_object,
 
 	if (g_cancellable_is_cancelled (state->cancellable)) {
 		/* Operation was cancelled. Bail out */
-		directory->details->mime_list_in_progress = NULL;
+		mime_list_remove (directory, state);
 
 		async_job_end (directory, "MIME list");
 		nemo_directory_async_state_changed (directory);
@@ -3005,8 +3532,7 @@ mime_list_callback (GObject *source_object,
 		return;
 	}
 
-	g_assert (directory->details->mime_list_in_progress != NULL);
-	g_assert (directory->details->mime_list_in_progress == state);
+	g_assert (g_list_find (directory->details->mime_list_in_progress, state) != NULL);
 
 	error = NULL;
 	files = g_file_enumerator_next_files_finish (state->enumerator,
@@ -3052,7 +3578,7 @@ list_mime_enum_callback (GObject *source_object,
 	if (g_cancellable_is_cancelled (state->cancellable)) {
 		/* Operation was cancelled. Bail out */
 		directory = state->directory;
-		directory->details->mime_list_in_progress = NULL;
+		mime_list_remove (directory, state);
 
 		async_job_end (directory, "MIME list");
 		nemo_directory_async_state_changed (directory);
@@ -3083,16 +3609,48 @@ list_mime_enum_callback (GObject *source_object,
 }
 
 static void
-mime_list_start (NemoDirectory *directory,
-		 NemoFile *file,
-		 gboolean *doing_io)
+mime_list_load (NemoDirectory *directory,
+		NemoFile *file)
 {
 	MimeListState *state;
 	GFile *location;
 
+	state = g_new0 (MimeListState, 1);
+	state->mime_list_file = file;
+	state->directory = nemo_directory_ref (directory);
+	state->cancellable = g_cancellable_new ();
+	state->mime_list_hash = istr_set_new ();
+
+	mime_list_add (directory, state);
+
+	location = nemo_file_get_location (file);
+#ifdef DEBUG_LOAD_DIRECTORY		
+	{
+		char *uri;
+		uri = g_file_get_uri (location);
+		g_message ("load_directory called to get MIME list of %s", uri);
+		g_free (uri);
+	}
+#endif	
+	
+	g_file_enumerate_children_async (location,
+					 G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
+					 0, /* flags */
+					 G_PRIORITY_LOW, /* prio */
+					 state->cancellable,
+					 list_mime_enum_callback,
+					 state);
+	g_object_unref (location);
+}
+
+static void
+mime_list_start (NemoDirectory *directory,
+		 NemoFile *file,
+		 gboolean *doing_io)
+{
 	mime_list_stop (directory);
 
-	if (directory->details->mime_list_in_progress != NULL) {
+	if (mime_list_find (directory, file) != NULL) {
 		*doing_io = TRUE;
 		return;
 	}
@@ -3115,37 +3673,68 @@ mime_list_start (NemoDirectory *directory,
 		return;
 	}
 
+	if (directory->details->mime_list_in_progress_length >= MAX_MIME_LISTS_PER_DIRECTORY) {
+		return;
+	}
+
 	if (!async_job_start (directory, "MIME list")) {
 		return;
 	}
 
+	mime_list_load (directory, file);
+}
 
-	state = g_new0 (MimeListState, 1);
-	state->mime_list_file = file;
-	state->directory = nemo_directory_ref (directory);
-	state->cancellable = g_cancellable_new ();
-	state->mime_list_hash = istr_set_new ();
+/* The work queue is serviced one file at a time, so while the file at the
+ * head waits for something, start counts and MIME lists for the folders
+ * behind it too.  Both enumerate a folder, which is where the time goes.
+ * Results still reach callers through the usual ready callbacks.
+ */
+static void
+subfolder_prefetch (NemoDirectory *directory)
+{
+	GList *node;
+	NemoFile *file;
+	gboolean counts_full, mime_lists_full;
+	int looked_at;
 
-	directory->details->mime_list_in_progress = state;
+	counts_full = directory->details->count_in_progress_length >= MAX_DIRECTORY_COUNTS_PER_DIRECTORY;
+	mime_lists_full = directory->details->mime_list_in_progress_length >= MAX_MIME_LISTS_PER_DIRECTORY;
 
-	location = nemo_file_get_location (file);
-#ifdef DEBUG_LOAD_DIRECTORY		
-	{
-		char *uri;
-		uri = g_file_get_uri (location);
-		g_message ("load_directory called to get MIME list of %s", uri);
-		g_free (uri);
+	for (node = nemo_file_queue_peek_head_link (directory->details->low_priority_queue), looked_at = 0;
+	     node != NULL && looked_at < SUBFOLDER_LOOKAHEAD && !(counts_full && mime_lists_full);
+	     node = node->next, looked_at++) {
+		file = NEMO_FILE (node->data);
+
+		if (!nemo_file_is_directory (file)) {
+			continue;
+		}
+
+		if (!counts_full &&
+		    directory_count_find (directory, file) == NULL &&
+		    is_needy (file,
+			      should_get_directory_count_now,
+			      REQUEST_DIRECTORY_COUNT)) {
+			if (!async_job_start (directory, "directory count")) {
+				return;
+			}
+
+			directory_count_load (directory, file);
+			counts_full = directory->details->count_in_progress_length >= MAX_DIRECTORY_COUNTS_PER_DIRECTORY;
+		}
+
+		if (!mime_lists_full &&
+		    mime_list_find (directory, file) == NULL &&
+		    is_needy (file,
+			      should_get_mime_list,
+			      REQUEST_MIME_LIST)) {
+			if (!async_job_start (directory, "MIME list")) {
+				return;
+			}
+
+			mime_list_load (directory, file);
+			mime_lists_full = directory->details->mime_list_in_progress_length >= MAX_MIME_LISTS_PER_DIRECTORY;
+		}
 	}
-#endif	
-	
-	g_file_enumerate_children_async (location,
-					 G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
-					 0, /* flags */
-					 G_PRIORITY_LOW, /* prio */
-					 state->cancellable,
-					 list_mime_enum_callback,
-					 state);
-	g_object_unref (location);
 }
 
 static void
@@ -4421,6 +5010,7 @@ start_or_stop_io (NemoDirectory *directory)
 		link_info_start (directory, file, &doing_io);
 
 		if (doing_io) {
+			subfolder_prefetch (directory);
 			return;
 		}
 
@@ -4441,6 +5031,7 @@ start_or_stop_io (NemoDirectory *directory)
         favorite_check_start (directory, file, &doing_io);
 
 		if (doing_io) {
+			subfolder_prefetch (directory);
 			return;
 		}
 
@@ -4516,6 +5107,9 @@ nemo_directory_cancel (NemoDirectory *directory)
 	if (waiting_directories != NULL) {
 		g_hash_table_remove (waiting_directories, directory);
 	}
+	if (waking_directories != NULL) {
+		g_hash_table_remove (waking_directories, directory);
+	}
 
 	/* Check if any directories should wake up. */
 	async_job_wake_up ();
@@ -4525,9 +5119,11 @@ static void
 cancel_directory_count_for_file (NemoDirectory *directory,
 				 NemoFile      *file)
 {
-	if (directory->details->count_in_progress != NULL &&
-	    directory->details->count_in_progress->count_file == file) {
-		directory_count_cancel (directory);
+	DirectoryCountState *state;
+
+	state = directory_count_find (directory, file);
+	if (state != NULL) {
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
@@ -4544,9 +5140,11 @@ static void
 cancel_mime_list_for_file (NemoDirectory *directory,
 			   NemoFile      *file)
 {
-	if (directory->details->mime_list_in_progress != NULL &&
-	    directory->details->mime_list_in_progress->mime_list_file == file) {
-		mime_list_cancel (directory);
+	MimeListState *state;
+
+	state = mime_list_find (directory, file);
+	if (state != NULL) {
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
@@ -4730,6 +5328,22 @@ nemo_directory_remove_file_from_work_queue (NemoDirectory *directory,
 				    file);
 }
 
+/* Have the file's pending attributes fetched before those of files that
+ * were queued earlier.
+ */
+void
+nemo_directory_prioritize_file (NemoDirectory *directory,
+				NemoFile *file)
+{
+	g_return_if_fail (file->details->directory == directory);
+
+	nemo_file_queue_move_to_head (directory->details->high_priority_queue,
+				      file);
+	nemo_file_queue_move_to_head (directory->details->low_priority_queue,
+				      file);
+	nemo_file_queue_move_to_head (directory->details->extension_queue,
+				      file);
+}
 
 static void
 move_file_to_low_priority_queue (NemoDirectory *directory,
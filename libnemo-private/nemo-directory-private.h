@@ -69,6 +69,8 @@ struct NemoDirectoryDetails
 {
 	/* The location. */
 	GFile *location;
+	/* Collation key of its parse name, built lazily */
+	char *location_collation_key;
 
 	/* The file objects. */
 	NemoFile *as_file;
@@ -111,12 +113,14 @@ struct NemoDirectoryDetails
 	 * list is finished. See Bug 703179 for a case when this happens. */
 	GList *new_files_in_progress_changes;
 
-	DirectoryCountState *count_in_progress;
+	GList *count_in_progress; /* list of DirectoryCountState * */
+	guint count_in_progress_length;
 
 	NemoFile *deep_count_file;
 	DeepCountState *deep_count_in_progress;
 
-	MimeListState *mime_list_in_progress;
+	GList *mime_list_in_progress; /* list of MimeListState * */
+	guint mime_list_in_progress_length;
 
 	NemoFile *get_info_file;
 	GetInfoState *get_info_in_progress;
@@ -143,6 +147,9 @@ struct NemoDirectoryDetails
 
     gint max_deferred_file_count;
     gint early_load_file_count;
+
+	/* Async. jobs this directory has running, see async_job_start () */
+	int async_job_count;
 };
 
 NemoDirectory *nemo_directory_get_existing                    (GFile                     *location);
@@ -239,6 +246,9 @@ void               nemo_directory_add_file_to_work_queue          (NemoDirectory
 								       NemoFile *file);
 void               nemo_directory_remove_file_from_work_queue     (NemoDirectory *directory,
 								       NemoFile *file);
+void               nemo_directory_prioritize_file                 (NemoDirectory *directory,
+								       NemoFile *file);
+const char *       nemo_directory_peek_location_collation_key     (NemoDirectory *directory);
 
 
 /* debugging functions */
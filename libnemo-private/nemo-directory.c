@@ -177,6 +177,7 @@ nemo_directory_finalize (GObject *object)
 	if (directory->details->location) {
 		g_object_unref (directory->details->location);
 	}
+	g_free (directory->details->location_collation_key);
 
 	g_assert (directory->details->file_list == NULL);
 	g_hash_table_destroy (directory->details->file_hash);
@@ -485,6 +486,21 @@ nemo_directory_get_location (NemoDirectory  *directory)
 	return g_object_ref (directory->details->location);
 }
 
+/* For sorting files by the folder they are in, see compare_by_directory_name */
+const char *
+nemo_directory_peek_location_collation_key (NemoDirectory *directory)
+{
+	char *parse_name;
+
+	if (directory->details->location_collation_key == NULL) {
+		parse_name = g_file_get_parse_name (directory->details->location);
+		directory->details->location_collation_key = g_utf8_collate_key (parse_name, -1);
+		g_free (parse_name);
+	}
+
+	return directory->details->location_collation_key;
+}
+
 static NemoDirectory *
 nemo_directory_new (GFile *location)
 {
@@ -1181,7 +1197,7 @@ set_directory_location (NemoDirectory *directory,
 		g_object_unref (directory->details->location);
 	}
 	directory->details->location = g_object_ref (location);
-	
+	g_clear_pointer (&directory->details->location_collation_key, g_free);
 }
 
 static void
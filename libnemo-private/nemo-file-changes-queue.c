@@ -128,6 +128,32 @@ nemo_file_changes_queue_file_removed (GFile *location)
 	nemo_file_changes_queue_add_common (queue, new_item);
 }
 
+/* Queues all of @locations at once, so they reach the directories as
+ * one batch */
+void
+nemo_file_changes_queue_files_removed (GList *locations)
+{
+	NemoFileChange *new_item;
+	NemoFileChangesQueue *queue;
+	GList *l;
+
+	queue = nemo_file_changes_queue_get();
+
+	g_mutex_lock (&queue->mutex);
+
+	for (l = locations; l != NULL; l = l->next) {
+		new_item = g_new0 (NemoFileChange, 1);
+		new_item->kind = CHANGE_FILE_REMOVED;
+		new_item->from = g_object_ref (l->data);
+
+		queue->head = g_list_prepend (queue->head, new_item);
+		if (queue->tail == NULL)
+			queue->tail = queue->head;
+	}
+
+	g_mutex_unlock (&queue->mutex);
+}
+
 void
 nemo_file_changes_queue_file_moved (GFile *from,
 					GFile *to)
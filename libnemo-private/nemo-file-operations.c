@@ -36,6 +36,9 @@
 #include <sys/types.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "nemo-file-operations.h"
 
@@ -70,6 +73,7 @@
 #include "nemo-file-undo-operations.h"
 #include "nemo-file-undo-manager.h"
 #include "nemo-job-queue.h"
+#include "nemo-local-copy.h"
 
 /* TODO: TESTING!!! */
 
@@ -105,6 +109,9 @@ typedef struct {
 	gboolean delete_all;
 } CommonJob;
 
+typedef struct ParallelCopy ParallelCopy;
+typedef struct CopyScan CopyScan;
+
 typedef struct {
 	CommonJob common;
 	gboolean is_move;
@@ -118,6 +125,8 @@ typedef struct {
 	gchar *target_name;
 	NemoCopyCallback  done_callback;
 	gpointer done_callback_data;
+	ParallelCopy *parallel;
+	CopyScan *scan;
 } CopyMoveJob;
 
 typedef struct {
@@ -1739,6 +1748,333 @@ report_delete_progress (CommonJob *job,
 	}
 }
 
+static gboolean
+uri_is_at_or_below (const char *uri,
+		    const char *root)
+{
+	gsize root_len;
+
+	root_len = strlen (root);
+
+	return strncmp (uri, root, root_len) == 0 &&
+		(uri[root_len] == '\0' || uri[root_len] == '/');
+}
+
+/* Forgets the favorites at or below any of @uris whose files are gone */
+static void
+remove_deleted_favorites (GList *uris)
+{
+	XAppFavorites *favorites;
+	GList *to_remove, *infos, *iter, *l;
+	GFile *file;
+
+	favorites = xapp_favorites_get_default ();
+	infos = xapp_favorites_get_favorites (favorites, NULL);
+	to_remove = NULL;
+
+	for (iter = infos; iter != NULL; iter = iter->next) {
+		XAppFavoriteInfo *info = (XAppFavoriteInfo *) iter->data;
+
+		if (info->uri == NULL) {
+			continue;
+		}
+
+		for (l = uris; l != NULL; l = l->next) {
+			if (uri_is_at_or_below (info->uri, l->data)) {
+				break;
+			}
+		}
+
+		if (l == NULL) {
+			continue;
+		}
+
+		file = g_file_new_for_uri (info->uri);
+		if (!g_file_query_exists (file, NULL)) {
+			to_remove = g_list_prepend (to_remove, g_strdup (info->uri));
+		}
+		g_object_unref (file);
+	}
+
+	g_list_free_full (infos, (GDestroyNotify) xapp_favorite_info_free);
+
+	for (iter = to_remove; iter != NULL; iter = iter->next) {
+		xapp_favorites_remove (favorites, (const gchar *) iter->data);
+	}
+
+	g_list_free_full (to_remove, g_free);
+}
+
+/* Deleting a local folder first clears out as much of it as possible on
+ * a pool of workers, with unlinkat() relative to the folder fds and no
+ * GIO in between.  Subfolders go to an idle worker if there is one and
+ * are handled in place otherwise.  A folder is removed once everything
+ * in it is gone.  Whatever the workers can't delete is left for
+ * delete_dir() to go through afterwards, so errors and skips get the
+ * usual dialogs.  The workers only count; progress is reported from the
+ * job thread.
+ */
+#define PARALLEL_DELETE_WORKERS 4
+/* Deleted files a worker collects before adding them to the count */
+#define PARALLEL_DELETE_BATCH 64
+
+typedef struct ParallelDelete ParallelDelete;
+typedef struct ParallelDeleteDir ParallelDeleteDir;
+
+struct ParallelDelete {
+	GThreadPool *pool;
+	GCancellable *cancellable;
+
+	GMutex lock;
+	GCond cond;
+	int num_files;		/* deleted since the job thread last looked */
+	gboolean done;
+	gboolean root_deleted;
+};
+
+struct ParallelDeleteDir {
+	ParallelDelete *parallel;
+	ParallelDeleteDir *parent;
+	char *path;
+	gint pending;		/* its own listing, and the subfolders not done yet */
+	gint failed;		/* something was left in it */
+};
+
+static void parallel_delete_dir_run (ParallelDeleteDir *dir);
+
+static void
+parallel_delete_add (ParallelDelete *parallel,
+		     int num_files)
+{
+	if (num_files == 0) {
+		return;
+	}
+
+	g_mutex_lock (&parallel->lock);
+	parallel->num_files += num_files;
+	g_mutex_unlock (&parallel->lock);
+}
+
+static ParallelDeleteDir *
+parallel_delete_dir_new (ParallelDelete *parallel,
+			 ParallelDeleteDir *parent,
+			 char *path)
+{
+	ParallelDeleteDir *dir;
+
+	dir = g_new0 (ParallelDeleteDir, 1);
+	dir->parallel = parallel;
+	dir->parent = parent;
+	dir->path = path;
+	dir->pending = 1;
+
+	if (parent != NULL) {
+		g_atomic_int_inc (&parent->pending);
+	}
+
+	return dir;
+}
+
+/* Removes the folders that have nothing left in them, from @dir up */
+static void
+parallel_delete_dir_release (ParallelDeleteDir *dir)
+{
+	ParallelDelete *parallel;
+	ParallelDeleteDir *parent;
+	gboolean deleted;
+
+	parallel = dir->parallel;
+
+	while (dir != NULL && g_atomic_int_dec_and_test (&dir->pending)) {
+		parent = dir->parent;
+
+		deleted = !g_atomic_int_get (&dir->failed) &&
+			!g_cancellable_is_cancelled (parallel->cancellable) &&
+			rmdir (dir->path) == 0;
+
+		if (deleted) {
+			parallel_delete_add (parallel, 1);
+		} else if (parent != NULL) {
+			g_atomic_int_set (&parent->failed, TRUE);
+		}
+
+		if (parent == NULL) {
+			g_mutex_lock (&parallel->lock);
+			parallel->root_deleted = deleted;
+			parallel->done = TRUE;
+			g_cond_signal (&parallel->cond);
+			g_mutex_unlock (&parallel->lock);
+		}
+
+		g_free (dir->path);
+		g_free (dir);
+
+		dir = parent;
+	}
+}
+
+static void
+parallel_delete_dir_contents (ParallelDeleteDir *dir)
+{
+	ParallelDelete *parallel;
+	ParallelDeleteDir *child;
+	struct dirent *entry;
+	struct stat statbuf;
+	DIR *stream;
+	gboolean is_dir;
+	int fd, num_files;
+
+	parallel = dir->parallel;
+
+	fd = open (dir->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		g_atomic_int_set (&dir->failed, TRUE);
+		return;
+	}
+
+	stream = fdopendir (fd);
+	if (stream == NULL) {
+		close (fd);
+		g_atomic_int_set (&dir->failed, TRUE);
+		return;
+	}
+
+	num_files = 0;
+
+	while (!g_cancellable_is_cancelled (parallel->cancellable)) {
+		errno = 0;
+		entry = readdir (stream);
+		if (entry == NULL) {
+			if (errno != 0) {
+				g_atomic_int_set (&dir->failed, TRUE);
+			}
+			break;
+		}
+
+		if (strcmp (entry->d_name, ".") == 0 ||
+		    strcmp (entry->d_name, "..") == 0) {
+			continue;
+		}
+
+		if (entry->d_type == DT_UNKNOWN) {
+			is_dir = fstatat (fd, entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0 &&
+				S_ISDIR (statbuf.st_mode);
+		} else {
+			is_dir = entry->d_type == DT_DIR;
+		}
+
+		if (is_dir) {
+			child = parallel_delete_dir_new (parallel, dir,
+							 g_build_filename (dir->path, entry->d_name, NULL));
+
+			/* Only hand it out if a worker is free to take it */
+			if (g_thread_pool_unprocessed (parallel->pool) == 0) {
+				g_thread_pool_push (parallel->pool, child, NULL);
+			} else {
+				parallel_delete_dir_run (child);
+			}
+		} else if (unlinkat (fd, entry->d_name, 0) == 0) {
+			if (++num_files == PARALLEL_DELETE_BATCH) {
+				parallel_delete_add (parallel, num_files);
+				num_files = 0;
+			}
+		} else {
+			g_atomic_int_set (&dir->failed, TRUE);
+		}
+	}
+
+	closedir (stream);
+
+	parallel_delete_add (parallel, num_files);
+}
+
+static void
+parallel_delete_dir_run (ParallelDeleteDir *dir)
+{
+	parallel_delete_dir_contents (dir);
+	parallel_delete_dir_release (dir);
+}
+
+static void
+parallel_delete_worker_func (gpointer data,
+			     gpointer user_data)
+{
+	parallel_delete_dir_run (data);
+}
+
+/* Returns TRUE if @dir is gone, with everything in it */
+static gboolean
+parallel_delete (CommonJob *job,
+		 GFile *dir,
+		 SourceInfo *source_info,
+		 TransferInfo *transfer_info)
+{
+	ParallelDelete *parallel;
+	ParallelDeleteDir *root;
+	gboolean root_deleted;
+	gint64 end_time;
+	int num_files;
+
+	parallel = g_new0 (ParallelDelete, 1);
+	parallel->cancellable = job->cancellable;
+	g_mutex_init (&parallel->lock);
+	g_cond_init (&parallel->cond);
+
+	parallel->pool = g_thread_pool_new (parallel_delete_worker_func, parallel,
+					    PARALLEL_DELETE_WORKERS, FALSE, NULL);
+
+	root = parallel_delete_dir_new (parallel, NULL, g_file_get_path (dir));
+	g_thread_pool_push (parallel->pool, root, NULL);
+
+	g_mutex_lock (&parallel->lock);
+	do {
+		end_time = g_get_monotonic_time () + PROGRESS_UPDATE_THRESHOLD * US_PER_MS;
+		g_cond_wait_until (&parallel->cond, &parallel->lock, end_time);
+
+		num_files = parallel->num_files;
+		parallel->num_files = 0;
+		g_mutex_unlock (&parallel->lock);
+
+		transfer_info->num_files += num_files;
+		report_delete_progress (job, source_info, transfer_info);
+
+		g_mutex_lock (&parallel->lock);
+	} while (!parallel->done);
+
+	transfer_info->num_files += parallel->num_files;
+	root_deleted = parallel->root_deleted;
+	g_mutex_unlock (&parallel->lock);
+
+	g_thread_pool_free (parallel->pool, FALSE, TRUE);
+	g_mutex_clear (&parallel->lock);
+	g_cond_clear (&parallel->cond);
+	g_free (parallel);
+
+	return root_deleted;
+}
+
+/* Only local folders, and only when nothing in the job was skipped
+ * while scanning, since the workers don't look at the skip lists. */
+static gboolean
+can_delete_in_parallel (CommonJob *job,
+			GFile *dir)
+{
+	gboolean res;
+	gchar *uri;
+
+	if (!g_file_is_native (dir) ||
+	    job->skip_files != NULL ||
+	    job->skip_readdir_error != NULL) {
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (dir);
+	res = !eel_uri_is_favorite (uri);
+	g_free (uri);
+
+	return res;
+}
+
 static void delete_file (CommonJob *job, GFile *file,
 			 gboolean *skipped_file,
 			 SourceInfo *source_info,
@@ -1763,6 +2099,27 @@ delete_dir (CommonJob *job, GFile *dir,
 
 	local_skipped_file = FALSE;
 
+	if (toplevel && can_delete_in_parallel (job, dir)) {
+		gboolean deleted;
+		GList *uris;
+
+		deleted = parallel_delete (job, dir, source_info, transfer_info);
+
+		uris = g_list_prepend (NULL, g_file_get_uri (dir));
+		remove_deleted_favorites (uris);
+		g_list_free_full (uris, g_free);
+
+		if (deleted) {
+			nemo_file_changes_queue_file_removed (dir);
+			report_delete_progress (job, source_info, transfer_info);
+			return;
+		}
+
+		if (job_aborted (job)) {
+			return;
+		}
+	}
+
 	skip_error = should_skip_readdir_error (job, dir);
  retry:
 	error = NULL;
@@ -2049,13 +2406,336 @@ report_trash_progress (CommonJob *job,
 	}
 }
 
+/* Local files on the filesystem of the home trash are trashed as one
+ * batch.  A pool of workers writes their trash info files, with names
+ * handed out without asking the trash about the ones this batch took
+ * already, and renames the files into the trash.  The deletion date,
+ * the undo record, the change notification and the favorites are then
+ * handled once for all of them.  Other files, and the ones a worker
+ * couldn't trash, go through g_file_trash() one at a time as before, so
+ * failures still offer to delete instead.
+ */
+#define BULK_TRASH_WORKERS 4
+/* Below this, the batch is not worth the threads */
+#define BULK_TRASH_MIN_FILES 16
+
+typedef struct {
+	char *trash_dir;
+	char *files_dir;
+	char *info_dir;
+	dev_t device;
+	char *deletion_date;
+	gint64 trash_time;
+	GCancellable *cancellable;
+
+	GMutex lock;
+	GCond cond;
+	GHashTable *next_ids;	/* basename -> next number to try in the trash */
+	int n_pending;		/* pushed, and not done yet */
+	int num_trashed;	/* since the job thread last looked */
+} BulkTrash;
+
+typedef struct {
+	GFile *file;
+	char *path;
+	gboolean pushed;
+	gboolean trashed;
+} BulkTrashItem;
+
+/* Same as the names GLib gives files in the trash */
+static char *
+get_trash_name (const char *basename,
+		int id)
+{
+	const char *dot;
+
+	if (id == 1) {
+		return g_strdup (basename);
+	}
+
+	dot = strchr (basename, '.');
+	if (dot != NULL) {
+		return g_strdup_printf ("%.*s.%d%s", (int) (dot - basename), basename, id, dot);
+	}
+
+	return g_strdup_printf ("%s.%d", basename, id);
+}
+
+static int
+bulk_trash_next_id (BulkTrash *bulk,
+		    const char *basename)
+{
+	int id;
+
+	g_mutex_lock (&bulk->lock);
+	id = MAX (1, GPOINTER_TO_INT (g_hash_table_lookup (bulk->next_ids, basename)));
+	g_hash_table_insert (bulk->next_ids, g_strdup (basename), GINT_TO_POINTER (id + 1));
+	g_mutex_unlock (&bulk->lock);
+
+	return id;
+}
+
+static gboolean
+bulk_trash_item (BulkTrash *bulk,
+		 BulkTrashItem *item)
+{
+	char *basename, *name, *info_path, *trashed_path, *escaped, *data;
+	gsize len, written;
+	gssize n;
+	gboolean res;
+	int fd;
+
+	basename = g_path_get_basename (item->path);
+
+	/* Creating the info file is what claims the name */
+	for (;;) {
+		name = get_trash_name (basename, bulk_trash_next_id (bulk, basename));
+		info_path = g_strconcat (bulk->info_dir, "/", name, ".trashinfo", NULL);
+
+		fd = open (info_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if (fd >= 0 || errno != EEXIST) {
+			break;
+		}
+
+		g_free (name);
+		g_free (info_path);
+	}
+
+	g_free (basename);
+
+	if (fd < 0) {
+		g_free (name);
+		g_free (info_path);
+		return FALSE;
+	}
+
+	escaped = g_uri_escape_string (item->path, "/", FALSE);
+	data = g_strdup_printf ("[Trash Info]\nPath=%s\nDeletionDate=%s\n",
+				escaped, bulk->deletion_date);
+	len = strlen (data);
+	res = TRUE;
+
+	for (written = 0; written < len; written += n) {
+		n = write (fd, data + written, len - written);
+		if (n < 0) {
+			if (errno == EINTR) {
+				n = 0;
+				continue;
+			}
+			res = FALSE;
+			break;
+		}
+	}
+
+	if (close (fd) != 0) {
+		res = FALSE;
+	}
+
+	if (res) {
+		trashed_path = g_build_filename (bulk->files_dir, name, NULL);
+		res = rename (item->path, trashed_path) == 0;
+		g_free (trashed_path);
+	}
+
+	if (!res) {
+		g_unlink (info_path);
+	}
+
+	g_free (escaped);
+	g_free (data);
+	g_free (name);
+	g_free (info_path);
+
+	return res;
+}
+
+static void
+bulk_trash_worker_func (gpointer data,
+			gpointer user_data)
+{
+	BulkTrashItem *item;
+	BulkTrash *bulk;
+
+	item = data;
+	bulk = user_data;
+
+	if (!g_cancellable_is_cancelled (bulk->cancellable)) {
+		item->trashed = bulk_trash_item (bulk, item);
+	}
+
+	g_mutex_lock (&bulk->lock);
+	bulk->n_pending--;
+	if (item->trashed) {
+		bulk->num_trashed++;
+	}
+	g_cond_signal (&bulk->cond);
+	g_mutex_unlock (&bulk->lock);
+}
+
+static gboolean
+bulk_trash_init (BulkTrash *bulk,
+		 GCancellable *cancellable)
+{
+	struct stat statbuf;
+	GDateTime *now;
+
+	bulk->trash_dir = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+	bulk->files_dir = g_build_filename (bulk->trash_dir, "files", NULL);
+	bulk->info_dir = g_build_filename (bulk->trash_dir, "info", NULL);
+
+	if (g_mkdir_with_parents (bulk->files_dir, 0700) != 0 ||
+	    g_mkdir_with_parents (bulk->info_dir, 0700) != 0 ||
+	    stat (bulk->files_dir, &statbuf) != 0) {
+		return FALSE;
+	}
+
+	bulk->device = statbuf.st_dev;
+	bulk->cancellable = cancellable;
+
+	now = g_date_time_new_now_local ();
+	bulk->deletion_date = g_date_time_format (now, "%Y-%m-%dT%H:%M:%S");
+	bulk->trash_time = g_date_time_to_unix (now);
+	g_date_time_unref (now);
+
+	g_mutex_init (&bulk->lock);
+	g_cond_init (&bulk->cond);
+	bulk->next_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	return TRUE;
+}
+
+static void
+bulk_trash_clear (BulkTrash *bulk)
+{
+	if (bulk->next_ids != NULL) {
+		g_hash_table_destroy (bulk->next_ids);
+		g_mutex_clear (&bulk->lock);
+		g_cond_clear (&bulk->cond);
+	}
+
+	g_free (bulk->trash_dir);
+	g_free (bulk->files_dir);
+	g_free (bulk->info_dir);
+	g_free (bulk->deletion_date);
+}
+
+/* Returns the files left for g_file_trash(), in their original order */
+static GList *
+bulk_trash_files (CommonJob *job,
+		  GList *files,
+		  int *files_trashed,
+		  int total_files)
+{
+	BulkTrash bulk = { NULL };
+	BulkTrashItem *item;
+	GThreadPool *pool;
+	GList *items, *left, *trashed, *uris, *l;
+	struct stat statbuf;
+	gint64 end_time;
+	int num_trashed;
+
+	if (g_list_length (files) < BULK_TRASH_MIN_FILES ||
+	    !bulk_trash_init (&bulk, job->cancellable)) {
+		bulk_trash_clear (&bulk);
+		return g_list_copy (files);
+	}
+
+	pool = g_thread_pool_new (bulk_trash_worker_func, &bulk,
+				  BULK_TRASH_WORKERS, FALSE, NULL);
+
+	items = NULL;
+	for (l = files; l != NULL; l = l->next) {
+		item = g_new0 (BulkTrashItem, 1);
+		item->file = l->data;
+		items = g_list_prepend (items, item);
+
+		if (!g_file_is_native (item->file)) {
+			continue;
+		}
+
+		item->path = g_file_get_path (item->file);
+
+		if (item->path == NULL ||
+		    lstat (item->path, &statbuf) != 0 ||
+		    statbuf.st_dev != bulk.device ||
+		    uri_is_at_or_below (item->path, bulk.trash_dir)) {
+			continue;
+		}
+
+		g_mutex_lock (&bulk.lock);
+		bulk.n_pending++;
+		g_mutex_unlock (&bulk.lock);
+
+		item->pushed = TRUE;
+		g_thread_pool_push (pool, item, NULL);
+	}
+	items = g_list_reverse (items);
+
+	g_mutex_lock (&bulk.lock);
+	while (bulk.n_pending > 0) {
+		end_time = g_get_monotonic_time () + PROGRESS_UPDATE_THRESHOLD * US_PER_MS;
+		g_cond_wait_until (&bulk.cond, &bulk.lock, end_time);
+
+		num_trashed = bulk.num_trashed;
+		bulk.num_trashed = 0;
+		g_mutex_unlock (&bulk.lock);
+
+		*files_trashed += num_trashed;
+		report_trash_progress (job, *files_trashed, total_files);
+
+		g_mutex_lock (&bulk.lock);
+	}
+	*files_trashed += bulk.num_trashed;
+	g_mutex_unlock (&bulk.lock);
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	left = NULL;
+	trashed = NULL;
+	uris = NULL;
+	for (l = items; l != NULL; l = l->next) {
+		item = l->data;
+
+		if (item->trashed) {
+			trashed = g_list_prepend (trashed, item->file);
+			uris = g_list_prepend (uris, g_file_get_uri (item->file));
+		} else {
+			left = g_list_prepend (left, item->file);
+		}
+
+		g_free (item->path);
+		g_free (item);
+	}
+	g_list_free (items);
+
+	if (trashed != NULL) {
+		trashed = g_list_reverse (trashed);
+
+		nemo_file_changes_queue_files_removed (trashed);
+
+		if (job->undo_info != NULL) {
+			nemo_file_undo_info_trash_add_files (NEMO_FILE_UNDO_INFO_TRASH (job->undo_info),
+							     trashed, bulk.trash_time);
+		}
+
+		remove_deleted_favorites (uris);
+
+		report_trash_progress (job, *files_trashed, total_files);
+	}
+
+	g_list_free (trashed);
+	g_list_free_full (uris, g_free);
+	bulk_trash_clear (&bulk);
+
+	return g_list_reverse (left);
+}
 
 static void
 trash_files (CommonJob *job, GList *files, guint *files_skipped)
 {
 	GList *l;
 	GFile *file;
-	GList *to_delete;
+	GList *to_delete, *left;
 	GError *error;
 	int total_files, files_trashed;
 	char *primary, *secondary, *details;
@@ -2070,8 +2750,10 @@ trash_files (CommonJob *job, GList *files, guint *files_skipped)
 
 	report_trash_progress (job, files_trashed, total_files);
 
+	left = bulk_trash_files (job, files, &files_trashed, total_files);
+
 	to_delete = NULL;
-	for (l = files;
+	for (l = left;
 	     l != NULL && !job_aborted (job);
 	     l = l->next) {
 		file = l->data;
@@ -2125,35 +2807,14 @@ trash_files (CommonJob *job, GList *files, guint *files_skipped)
 		} else {
             gchar *uri = g_file_get_uri (file);
             if (!eel_uri_is_favorite (uri)) {
-                XAppFavorites *favorites = xapp_favorites_get_default ();
-                xapp_favorites_remove (favorites, uri);
-
                 // move-to-trash doesn't recurse, it just trashes the toplevel, and
                 // the recent backend (gvfs) takes care of the rest. If we trash a folder
                 // that was a favorite, which also had favorites that descended from it,
                 // we need to explicitly remove them, or we'll have dangling entries in the
                 // favorites list.
-
-                GList *to_remove, *infos, *iter;
-
-                infos = xapp_favorites_get_favorites (favorites, NULL);
-                to_remove = NULL;
-
-                for (iter = infos; iter != NULL; iter = iter->next) {
-                    XAppFavoriteInfo *info = (XAppFavoriteInfo *) iter->data;
-
-                    if (info->uri && g_str_has_prefix (info->uri, uri)) {
-                        to_remove = g_list_prepend (to_remove, g_strdup (info->uri));
-                    }
-                }
-
-                g_list_free_full (infos, (GDestroyNotify) xapp_favorite_info_free);
-
-                for (iter = to_remove; iter != NULL; iter = iter->next) {
-                    xapp_favorites_remove (favorites, (const gchar *) iter->data);
-                }
-
-                g_list_free_full (to_remove, g_free);
+                GList *uris = g_list_prepend (NULL, uri);
+                remove_deleted_favorites (uris);
+                g_list_free (uris);
             }
             g_free (uri);
 
@@ -2168,6 +2829,8 @@ trash_files (CommonJob *job, GList *files, guint *files_skipped)
 		}
 	}
 
+	g_list_free (left);
+
 	if (to_delete) {
 		to_delete = g_list_reverse (to_delete);
 		delete_files (job, to_delete, files_skipped);
@@ -3078,6 +3741,180 @@ scan_sources (GList *files,
 	report_count_progress (job, source_info);
 }
 
+/* Counts the sources on a thread of its own while they are being copied,
+ * so the copy doesn't have to wait for scan_sources(). Errors are left
+ * for the copy itself to report. */
+struct CopyScan {
+	GThread *thread;
+	GCancellable *cancellable;
+	GList *files;
+
+	GMutex lock;
+	int num_files;
+	goffset num_bytes;
+	gboolean done;
+};
+
+#define COPY_SCAN_BATCH 100
+
+static void
+copy_scan_add (CopyScan *scan,
+	       int num_files,
+	       goffset num_bytes)
+{
+	g_mutex_lock (&scan->lock);
+	scan->num_files += num_files;
+	scan->num_bytes += num_bytes;
+	g_mutex_unlock (&scan->lock);
+}
+
+static void
+copy_scan_dir (CopyScan *scan,
+	       GFile *dir,
+	       GQueue *dirs)
+{
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+	int num_files;
+	goffset num_bytes;
+
+	enumerator = g_file_enumerate_children (dir,
+						G_FILE_ATTRIBUTE_STANDARD_NAME","
+						G_FILE_ATTRIBUTE_STANDARD_TYPE","
+						G_FILE_ATTRIBUTE_STANDARD_SIZE,
+						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+						scan->cancellable,
+						NULL);
+	if (enumerator == NULL) {
+		return;
+	}
+
+	num_files = 0;
+	num_bytes = 0;
+
+	while ((info = g_file_enumerator_next_file (enumerator, scan->cancellable, NULL)) != NULL) {
+		num_files++;
+		num_bytes += g_file_info_get_size (info);
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			/* Push to head, since we want depth-first */
+			g_queue_push_head (dirs, g_file_get_child (dir, g_file_info_get_name (info)));
+		}
+
+		g_object_unref (info);
+
+		if (num_files == COPY_SCAN_BATCH) {
+			copy_scan_add (scan, num_files, num_bytes);
+			num_files = 0;
+			num_bytes = 0;
+		}
+	}
+
+	g_file_enumerator_close (enumerator, scan->cancellable, NULL);
+	g_object_unref (enumerator);
+
+	copy_scan_add (scan, num_files, num_bytes);
+}
+
+static gpointer
+copy_scan_thread (gpointer user_data)
+{
+	CopyScan *scan;
+	GFileInfo *info;
+	GQueue *dirs;
+	GFile *dir;
+	GList *l;
+
+	scan = user_data;
+	dirs = g_queue_new ();
+
+	for (l = scan->files;
+	     l != NULL && !g_cancellable_is_cancelled (scan->cancellable);
+	     l = l->next) {
+		info = g_file_query_info (l->data,
+					  G_FILE_ATTRIBUTE_STANDARD_TYPE","
+					  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					  scan->cancellable,
+					  NULL);
+		if (info == NULL) {
+			continue;
+		}
+
+		copy_scan_add (scan, 1, g_file_info_get_size (info));
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			g_queue_push_head (dirs, g_object_ref (l->data));
+		}
+
+		g_object_unref (info);
+
+		while (!g_cancellable_is_cancelled (scan->cancellable) &&
+		       (dir = g_queue_pop_head (dirs)) != NULL) {
+			copy_scan_dir (scan, dir, dirs);
+			g_object_unref (dir);
+		}
+	}
+
+	/* Free all from queue if we exited early */
+	g_queue_free_full (dirs, g_object_unref);
+
+	g_mutex_lock (&scan->lock);
+	scan->done = !g_cancellable_is_cancelled (scan->cancellable);
+	g_mutex_unlock (&scan->lock);
+
+	return NULL;
+}
+
+static CopyScan *
+copy_scan_new (GList *files)
+{
+	CopyScan *scan;
+
+	scan = g_new0 (CopyScan, 1);
+	scan->cancellable = g_cancellable_new ();
+	scan->files = eel_g_object_list_copy (files);
+	g_mutex_init (&scan->lock);
+
+	scan->thread = g_thread_new ("nemo-copy-scan", copy_scan_thread, scan);
+
+	return scan;
+}
+
+/* Stops the scan if it is still running */
+static void
+copy_scan_free (CopyScan *scan)
+{
+	g_cancellable_cancel (scan->cancellable);
+	g_thread_join (scan->thread);
+
+	g_list_free_full (scan->files, g_object_unref);
+	g_object_unref (scan->cancellable);
+	g_mutex_clear (&scan->lock);
+	g_free (scan);
+}
+
+static void
+copy_scan_update_source_info (CopyScan *scan,
+			      SourceInfo *source_info,
+			      TransferInfo *transfer_info)
+{
+	gboolean done;
+
+	g_mutex_lock (&scan->lock);
+	source_info->num_files = scan->num_files;
+	source_info->num_bytes = scan->num_bytes;
+	done = scan->done;
+	g_mutex_unlock (&scan->lock);
+
+	/* Until the count is complete, there is always another file
+	 * to come after the current one. */
+	if (!done) {
+		source_info->num_files = MAX (source_info->num_files,
+					      transfer_info->num_files + 2);
+	}
+}
+
 static void
 verify_destination (CommonJob *job,
 		    GFile *dest,
@@ -3262,6 +4099,10 @@ report_copy_progress (CopyMoveJob *copy_job,
 	}
 	transfer_info->last_report_time = now;
 
+	if (copy_job->scan != NULL) {
+		copy_scan_update_source_info (copy_job->scan, source_info, transfer_info);
+	}
+
 	files_left = source_info->num_files - transfer_info->num_files;
 
 	/* Races and whatnot could cause this to be negative... */
@@ -3705,6 +4546,18 @@ static void copy_move_file (CopyMoveJob *job,
 			    gboolean *skipped_file,
 			    gboolean readonly_source_fs);
 
+static void parallel_copy_push (ParallelCopy *parallel,
+				GFile *src,
+				GFile *dest_dir,
+				gboolean same_fs,
+				const char *dest_fs_type,
+				SourceInfo *source_info,
+				TransferInfo *transfer_info);
+static void parallel_copy_defer_attributes (ParallelCopy *parallel,
+					    GFile *src,
+					    GFile *dest,
+					    GFileCopyFlags flags);
+
 typedef enum {
 	CREATE_DEST_DIR_RETRY,
 	CREATE_DEST_DIR_FAILED,
@@ -3866,7 +4719,8 @@ copy_move_directory (CopyMoveJob *copy_job,
  retry:
 	error = NULL;
 	enumerator = g_file_enumerate_children (src,
-						G_FILE_ATTRIBUTE_STANDARD_NAME,
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_STANDARD_TYPE,
 						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 						job->cancellable,
 						&error);
@@ -3877,9 +4731,21 @@ copy_move_directory (CopyMoveJob *copy_job,
 		       (info = g_file_enumerator_next_file (enumerator, job->cancellable, skip_error?NULL:&error)) != NULL) {
 			src_file = g_file_get_child (src,
 						     g_file_info_get_name (info));
-			copy_move_file (copy_job, src_file, *dest, same_fs, FALSE, &dest_fs_type,
-					source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
-					readonly_source_fs);
+
+			/* Plain files go to the workers, anything that needs
+			 * recursion or special handling stays here */
+			if (copy_job->parallel != NULL &&
+			    g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+			    !should_skip_file (job, src_file) &&
+			    (copy_job->desktop_location == NULL ||
+			     !g_file_equal (copy_job->desktop_location, *dest))) {
+				parallel_copy_push (copy_job->parallel, src_file, *dest, same_fs,
+						    dest_fs_type, source_info, transfer_info);
+			} else {
+				copy_move_file (copy_job, src_file, *dest, same_fs, FALSE, &dest_fs_type,
+						source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
+						readonly_source_fs);
+			}
 			g_object_unref (src_file);
 			g_object_unref (info);
 		}
@@ -3974,10 +4840,16 @@ copy_move_directory (CopyMoveJob *copy_job,
 	if (create_dest) {
 		flags = (readonly_source_fs) ? G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_TARGET_DEFAULT_PERMS
 					     : G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_ALL_METADATA;
-		/* Ignore errors here. Failure to copy metadata is not a hard error */
-		g_file_copy_attributes (src, *dest,
-					flags,
-					job->cancellable, NULL);
+
+		if (copy_job->parallel != NULL) {
+			/* The workers may still be writing into it */
+			parallel_copy_defer_attributes (copy_job->parallel, src, *dest, flags);
+		} else {
+			/* Ignore errors here. Failure to copy metadata is not a hard error */
+			g_file_copy_attributes (src, *dest,
+						flags,
+						job->cancellable, NULL);
+		}
 	}
 
 	if (!job_aborted (job) && copy_job->is_move &&
@@ -4375,6 +5247,47 @@ get_target_file_for_display_name (GFile *dir,
 	return dest;
 }
 
+static void
+run_copy_file_error (CopyMoveJob *copy_job,
+		     GFile *src,
+		     GFile *dest_dir,
+		     GError *error,
+		     SourceInfo *source_info,
+		     TransferInfo *transfer_info)
+{
+	CommonJob *job;
+	char *primary, *secondary, *details;
+	int response;
+
+	job = (CommonJob *)copy_job;
+
+	if (job->skip_all_error) {
+		return;
+	}
+
+	primary = f (_("Error while copying \"%B\"."), src);
+	secondary = f (_("There was an error copying the file into %F."), dest_dir);
+	details = error->message;
+
+	response = run_warning (job,
+				primary,
+				secondary,
+				details,
+				(source_info->num_files - transfer_info->num_files) > 1,
+				GTK_STOCK_CANCEL, SKIP_ALL, SKIP,
+				NULL);
+
+	if (response == 0 || response == GTK_RESPONSE_DELETE_EVENT) {
+		abort_job (job);
+	} else if (response == 1) { /* skip all */
+		job->skip_all_error = TRUE;
+	} else if (response == 2) { /* skip */
+		/* do nothing */
+	} else {
+		g_assert_not_reached ();
+	}
+}
+
 /* Debuting files is non-NULL only for toplevel items */
 static void
 copy_move_file (CopyMoveJob *copy_job,
@@ -4533,12 +5446,12 @@ copy_move_file (CopyMoveJob *copy_job,
 				   &pdata,
 				   &error);
 	} else {
-		res = g_file_copy (src, dest,
-				   flags,
-				   job->cancellable,
-				   copy_file_progress_callback,
-				   &pdata,
-				   &error);
+		res = nemo_local_copy_file (src, dest,
+					    flags,
+					    job->cancellable,
+					    copy_file_progress_callback,
+					    &pdata,
+					    &error);
 	}
 
 	if (res) {
@@ -4788,37 +5701,353 @@ copy_move_file (CopyMoveJob *copy_job,
 
 	/* Other error */
 	else {
-		if (job->skip_all_error) {
-			g_error_free (error);
-			goto out;
-		}
-		primary = f (_("Error while copying \"%B\"."), src);
-		secondary = f (_("There was an error copying the file into %F."), dest_dir);
-		details = error->message;
+		run_copy_file_error (copy_job, src, dest_dir, error,
+				     source_info, transfer_info);
+		g_error_free (error);
+	}
+ out:
+	*skipped_file = TRUE; /* Or aborted, but same-same */
+	g_object_unref (dest);
+}
 
-		response = run_warning (job,
-					primary,
-					secondary,
-					details,
-					(source_info->num_files - transfer_info->num_files) > 1,
-					GTK_STOCK_CANCEL, SKIP_ALL, SKIP,
-					NULL);
+/* Parallel copying, for local copies of many small files.
+ *
+ * The job thread still walks the sources, creates the directories in
+ * order and copies everything but regular files itself.  Regular files
+ * inside the copied folders are handed to a pool of workers, which only
+ * do the I/O.  Everything else happens back on the job thread: progress,
+ * change notification and undo for the copied files, and any file a
+ * worker couldn't copy is copied again by copy_move_file(), so conflicts
+ * and errors get the usual dialogs, one at a time.
+ */
+#define PARALLEL_COPY_WORKERS 4
+/* Files handed out and not processed yet, bounds the memory used */
+#define PARALLEL_COPY_MAX_PENDING 256
 
-		g_error_free (error);
+struct ParallelCopy {
+	CopyMoveJob *copy_job;
+	GThreadPool *pool;
+	GFileCopyFlags flags;
+	gboolean readonly_source_fs;
 
-		if (response == 0 || response == GTK_RESPONSE_DELETE_EVENT) {
-			abort_job (job);
-		} else if (response == 1) { /* skip all */
-			job->skip_all_error = TRUE;
-		} else if (response == 2) { /* skip */
-			/* do nothing */
+	GMutex lock;
+	GCond cond;
+	guint n_pending;	/* pushed, and not in finished yet */
+	GQueue finished;	/* ParallelCopyItems for the job thread */
+	goffset num_bytes;	/* copied since the job thread last looked */
+
+	/* Attributes of the created folders, copied once their files are done */
+	GList *directories;
+};
+
+typedef struct {
+	ParallelCopy *parallel;
+	GFile *src;
+	GFile *dest;
+	GFile *dest_dir;
+	gboolean same_fs;
+	char *dest_fs_type;
+	goffset last_size;
+	gboolean copied;
+	GError *error;
+} ParallelCopyItem;
+
+typedef struct {
+	GFile *src;
+	GFile *dest;
+	GFileCopyFlags flags;
+} ParallelCopyDirectory;
+
+static void
+parallel_copy_item_free (ParallelCopyItem *item)
+{
+	g_object_unref (item->src);
+	g_object_unref (item->dest);
+	g_object_unref (item->dest_dir);
+	g_free (item->dest_fs_type);
+	g_clear_error (&item->error);
+	g_free (item);
+}
+
+static void
+parallel_copy_progress_callback (goffset current_num_bytes,
+				 goffset total_num_bytes,
+				 gpointer user_data)
+{
+	ParallelCopyItem *item;
+	goffset new_size;
+
+	item = user_data;
+
+	new_size = current_num_bytes - item->last_size;
+
+	if (new_size > 0) {
+		item->last_size = current_num_bytes;
+
+		g_mutex_lock (&item->parallel->lock);
+		item->parallel->num_bytes += new_size;
+		g_mutex_unlock (&item->parallel->lock);
+	}
+}
+
+static void
+parallel_copy_worker_func (gpointer data,
+			   gpointer user_data)
+{
+	ParallelCopyItem *item;
+	ParallelCopy *parallel;
+	GCancellable *cancellable;
+
+	item = data;
+	parallel = user_data;
+	cancellable = parallel->copy_job->common.cancellable;
+
+	if (!g_cancellable_is_cancelled (cancellable) &&
+	    nemo_local_copy_file (item->src, item->dest,
+				  parallel->flags,
+				  cancellable,
+				  parallel_copy_progress_callback,
+				  item,
+				  &item->error)) {
+		/* Ignore errors here. Failure to copy metadata is not a hard error */
+		g_file_copy_attributes (item->src, item->dest,
+					parallel->flags | G_FILE_COPY_ALL_METADATA,
+					cancellable, NULL);
+		item->copied = TRUE;
+	}
+
+	g_mutex_lock (&parallel->lock);
+	g_queue_push_tail (&parallel->finished, item);
+	parallel->n_pending--;
+	g_cond_signal (&parallel->cond);
+	g_mutex_unlock (&parallel->lock);
+}
+
+static ParallelCopy *
+parallel_copy_new (CopyMoveJob *copy_job,
+		   gboolean readonly_source_fs)
+{
+	ParallelCopy *parallel;
+
+	parallel = g_new0 (ParallelCopy, 1);
+	parallel->copy_job = copy_job;
+	parallel->readonly_source_fs = readonly_source_fs;
+	/* What copy_move_file() uses for a file that isn't overwritten */
+	parallel->flags = G_FILE_COPY_NOFOLLOW_SYMLINKS;
+	if (readonly_source_fs) {
+		parallel->flags |= G_FILE_COPY_TARGET_DEFAULT_PERMS;
+	}
+
+	g_mutex_init (&parallel->lock);
+	g_cond_init (&parallel->cond);
+	g_queue_init (&parallel->finished);
+
+	parallel->pool = g_thread_pool_new (parallel_copy_worker_func, parallel,
+					    PARALLEL_COPY_WORKERS, FALSE, NULL);
+
+	return parallel;
+}
+
+/* Gives an error copy_move_file() would handle without touching the
+ * destination, so the file can simply be tried again there. */
+static gboolean
+parallel_copy_should_retry (GError *error)
+{
+	return IS_IO_ERROR (error, EXISTS) ||
+		IS_IO_ERROR (error, INVALID_FILENAME) ||
+		IS_IO_ERROR (error, IS_DIRECTORY) ||
+		IS_IO_ERROR (error, WOULD_RECURSE) ||
+		IS_IO_ERROR (error, WOULD_MERGE);
+}
+
+static void
+parallel_copy_process_finished (ParallelCopy *parallel,
+				SourceInfo *source_info,
+				TransferInfo *transfer_info)
+{
+	CopyMoveJob *copy_job;
+	CommonJob *job;
+	ParallelCopyItem *item;
+	GQueue finished;
+	gboolean skipped_file;
+	char *dest_fs_type;
+
+	copy_job = parallel->copy_job;
+	job = (CommonJob *)copy_job;
+
+	g_mutex_lock (&parallel->lock);
+	finished = parallel->finished;
+	g_queue_init (&parallel->finished);
+	transfer_info->num_bytes += parallel->num_bytes;
+	parallel->num_bytes = 0;
+	g_mutex_unlock (&parallel->lock);
+
+	while ((item = g_queue_pop_head (&finished)) != NULL) {
+		if (item->copied) {
+			transfer_info->num_files ++;
+			nemo_file_changes_queue_file_added (item->dest);
+
+			if (job->undo_info != NULL) {
+				nemo_file_undo_info_ext_add_origin_target_pair (NEMO_FILE_UNDO_INFO_EXT (job->undo_info),
+										    item->src, item->dest);
+			}
+		} else if (item->error == NULL ||
+			   IS_IO_ERROR (item->error, CANCELLED) ||
+			   job_aborted (job)) {
+			/* Aborted, nothing to do */
+		} else if (parallel_copy_should_retry (item->error)) {
+			dest_fs_type = g_strdup (item->dest_fs_type);
+			skipped_file = FALSE;
+			copy_move_file (copy_job, item->src, item->dest_dir, item->same_fs,
+					FALSE, &dest_fs_type,
+					source_info, transfer_info, NULL, NULL, FALSE, &skipped_file,
+					parallel->readonly_source_fs);
+			g_free (dest_fs_type);
 		} else {
-			g_assert_not_reached ();
+			run_copy_file_error (copy_job, item->src, item->dest_dir, item->error,
+					     source_info, transfer_info);
 		}
+
+		parallel_copy_item_free (item);
 	}
- out:
-	*skipped_file = TRUE; /* Or aborted, but same-same */
-	g_object_unref (dest);
+
+	report_copy_progress (copy_job, source_info, transfer_info);
+}
+
+static void
+parallel_copy_push (ParallelCopy *parallel,
+		    GFile *src,
+		    GFile *dest_dir,
+		    gboolean same_fs,
+		    const char *dest_fs_type,
+		    SourceInfo *source_info,
+		    TransferInfo *transfer_info)
+{
+	ParallelCopyItem *item;
+	gboolean have_finished;
+	gint64 end_time;
+
+	item = g_new0 (ParallelCopyItem, 1);
+	item->parallel = parallel;
+	item->src = g_object_ref (src);
+	item->dest = get_target_file (src, dest_dir, dest_fs_type, same_fs);
+	item->dest_dir = g_object_ref (dest_dir);
+	item->same_fs = same_fs;
+	item->dest_fs_type = g_strdup (dest_fs_type);
+
+	g_mutex_lock (&parallel->lock);
+	while (parallel->n_pending >= PARALLEL_COPY_MAX_PENDING) {
+		end_time = g_get_monotonic_time () + PROGRESS_UPDATE_THRESHOLD * US_PER_MS;
+		if (!g_cond_wait_until (&parallel->cond, &parallel->lock, end_time)) {
+			/* Show the bytes of the files still being copied */
+			g_mutex_unlock (&parallel->lock);
+			parallel_copy_process_finished (parallel, source_info, transfer_info);
+			g_mutex_lock (&parallel->lock);
+		}
+	}
+	parallel->n_pending++;
+	have_finished = !g_queue_is_empty (&parallel->finished);
+	g_mutex_unlock (&parallel->lock);
+
+	g_thread_pool_push (parallel->pool, item, NULL);
+
+	if (have_finished) {
+		parallel_copy_process_finished (parallel, source_info, transfer_info);
+	}
+}
+
+static void
+parallel_copy_defer_attributes (ParallelCopy *parallel,
+				GFile *src,
+				GFile *dest,
+				GFileCopyFlags flags)
+{
+	ParallelCopyDirectory *directory;
+
+	directory = g_new0 (ParallelCopyDirectory, 1);
+	directory->src = g_object_ref (src);
+	directory->dest = g_object_ref (dest);
+	directory->flags = flags;
+
+	/* Deepest first, when they are applied */
+	parallel->directories = g_list_prepend (parallel->directories, directory);
+}
+
+/* Waits for the workers, handles what they left over and finally copies
+ * the folder attributes. */
+static void
+parallel_copy_finish (ParallelCopy *parallel,
+		      SourceInfo *source_info,
+		      TransferInfo *transfer_info)
+{
+	ParallelCopyDirectory *directory;
+	GCancellable *cancellable;
+	gboolean done;
+	gint64 end_time;
+	GList *l;
+
+	cancellable = parallel->copy_job->common.cancellable;
+
+	do {
+		g_mutex_lock (&parallel->lock);
+		/* Wake up now and then to show the bytes of the files still
+		 * being copied, large ones can take a while */
+		end_time = g_get_monotonic_time () + PROGRESS_UPDATE_THRESHOLD * US_PER_MS;
+		while (parallel->n_pending > 0 && g_queue_is_empty (&parallel->finished)) {
+			if (!g_cond_wait_until (&parallel->cond, &parallel->lock, end_time)) {
+				break;
+			}
+		}
+		done = parallel->n_pending == 0;
+		g_mutex_unlock (&parallel->lock);
+
+		parallel_copy_process_finished (parallel, source_info, transfer_info);
+	} while (!done);
+
+	g_thread_pool_free (parallel->pool, FALSE, TRUE);
+
+	for (l = parallel->directories; l != NULL; l = l->next) {
+		directory = l->data;
+
+		/* Ignore errors here. Failure to copy metadata is not a hard error */
+		g_file_copy_attributes (directory->src, directory->dest,
+					directory->flags,
+					cancellable, NULL);
+
+		g_object_unref (directory->src);
+		g_object_unref (directory->dest);
+		g_free (directory);
+	}
+	g_list_free (parallel->directories);
+
+	g_mutex_clear (&parallel->lock);
+	g_cond_clear (&parallel->cond);
+	g_free (parallel);
+}
+
+/* Only local copies are worth spreading over several threads, and only
+ * plain ones: moves delete as they go, and a custom target name is
+ * applied to every file copy_move_file() copies. */
+static gboolean
+can_copy_in_parallel (CopyMoveJob *job)
+{
+	GList *l;
+
+	if (job->is_move || job->target_name != NULL) {
+		return FALSE;
+	}
+
+	if (job->destination != NULL && !g_file_is_native (job->destination)) {
+		return FALSE;
+	}
+
+	for (l = job->files; l != NULL; l = l->next) {
+		if (!g_file_is_native (l->data)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
 }
 
 static void
@@ -4859,6 +6088,10 @@ copy_files (CopyMoveJob *job,
 		g_object_unref (source_dir);
 	}
 
+	if (can_copy_in_parallel (job)) {
+		job->parallel = parallel_copy_new (job, readonly_source_fs);
+	}
+
 	unique_names = (job->destination == NULL);
 	i = 0;
 	for (l = job->files;
@@ -4898,6 +6131,11 @@ copy_files (CopyMoveJob *job,
 		i++;
 	}
 
+	if (job->parallel != NULL) {
+		parallel_copy_finish (job->parallel, source_info, transfer_info);
+		job->parallel = NULL;
+	}
+
 	g_free (dest_fs_type);
 }
 
@@ -4952,12 +6190,21 @@ copy_job (GIOSchedulerJob *io_job,
 
     nemo_progress_info_start (common->progress);
 
-	scan_sources (job->files,
-		      &source_info,
-		      common,
-		      OP_KIND_COPY);
-	if (job_aborted (common)) {
-		goto aborted;
+	if (g_settings_get_boolean (nemo_preferences, NEMO_PREFERENCES_SCAN_BEFORE_COPY)) {
+		scan_sources (job->files,
+			      &source_info,
+			      common,
+			      OP_KIND_COPY);
+		if (job_aborted (common)) {
+			goto aborted;
+		}
+	} else {
+		/* Start copying right away, report_copy_progress() fills
+		 * in the totals as the scan goes on */
+		memset (&source_info, 0, sizeof (SourceInfo));
+		source_info.op = OP_KIND_COPY;
+
+		job->scan = copy_scan_new (job->files);
 	}
 
 	if (job->destination) {
@@ -4969,6 +6216,8 @@ copy_job (GIOSchedulerJob *io_job,
 		dest = g_file_get_parent (job->files->data);
 	}
 
+	/* Without a scan up front the size isn't known yet, and the
+	 * free space check is skipped */
 	verify_destination (&job->common,
 			    dest,
 			    &dest_fs_id,
@@ -4987,6 +6236,11 @@ copy_job (GIOSchedulerJob *io_job,
 
  aborted:
 
+	if (job->scan != NULL) {
+		copy_scan_free (job->scan);
+		job->scan = NULL;
+	}
+
 	g_free (dest_fs_id);
 
 	g_io_scheduler_job_send_to_mainloop_async (io_job,
@@ -7220,6 +8474,89 @@ job_is_small (GList *files)
     return ret;
 }
 
+static gboolean
+add_job_device (GPtrArray *devices, GFile *location)
+{
+    NemoFile *file;
+    gchar *fs_id;
+    guint i;
+
+    file = nemo_file_get_existing (location);
+
+    if (file == NULL)
+        return FALSE;
+
+    fs_id = nemo_file_get_filesystem_id (file);
+    nemo_file_unref (file);
+
+    if (fs_id == NULL)
+        return FALSE;
+
+    for (i = 0; i < devices->len; i++) {
+        if (g_strcmp0 (devices->pdata[i], fs_id) == 0) {
+            g_free (fs_id);
+            return TRUE;
+        }
+    }
+
+    g_ptr_array_add (devices, fs_id);
+
+    return TRUE;
+}
+
+/* The filesystems a job works on, so the queue can run jobs on unrelated
+ * devices side by side.  NULL when any of them isn't known yet, the
+ * queue then plays it safe. */
+static gchar **
+get_job_devices (OpKind kind, gpointer op_data)
+{
+    GPtrArray *devices;
+    GList *files, *l;
+    GFile *destination;
+
+    switch (kind) {
+        case OP_KIND_MOVE:
+        case OP_KIND_COPY:
+        case OP_KIND_DUPE:
+            ;
+            CopyMoveJob *cmjob = (CopyMoveJob *) op_data;
+            files = cmjob->files;
+            destination = cmjob->destination;
+            break;
+        case OP_KIND_DELETE:
+        case OP_KIND_TRASH:
+            ;
+            DeleteJob *deljob = (DeleteJob *) op_data;
+            files = deljob->files;
+            destination = NULL;
+            break;
+        default:
+            return NULL;
+    }
+
+    devices = g_ptr_array_new_with_free_func (g_free);
+
+    for (l = files; l != NULL; l = l->next) {
+        if (!add_job_device (devices, G_FILE (l->data))) {
+            g_ptr_array_free (devices, TRUE);
+            return NULL;
+        }
+    }
+
+    if (destination != NULL && !add_job_device (devices, destination)) {
+        g_ptr_array_free (devices, TRUE);
+        return NULL;
+    }
+
+#ifdef DEBUG_FILE_OP_QUEUE
+    g_message ("File op job uses %u filesystems\n", devices->len);
+#endif
+
+    g_ptr_array_add (devices, NULL);
+
+    return (gchar **) g_ptr_array_free (devices, FALSE);
+}
+
 static gboolean
 should_start_immediately (OpKind kind, gpointer op_data)
 {
@@ -7292,6 +8629,7 @@ add_job_to_job_queue (GIOSchedulerJobFunc job_func,
                                 user_data,
                                 cancellable,
                                 info,
+                                get_job_devices (kind, user_data),
                                 start_immediately);
 }
 
@@ -61,6 +61,9 @@ struct NemoFileDetails
 
 	GRefString *display_name;
 	char *display_name_collation_key;
+	/* normalized, case folded display name for the filter bar, built lazily */
+	char *display_name_match_key;
+	gsize display_name_match_key_length;
 	GRefString *edit_name;
 
 	goffset size; /* -1 is unknown */
@@ -86,6 +89,11 @@ struct NemoFileDetails
 	
 	char *selinux_context;
 	char *description;
+
+	/* Collation keys of the type descriptions, shared between all
+	 * files with the same description.  Built lazily for sorting. */
+	const char *type_collation_key;
+	const char *detailed_type_collation_key;
 	
 	GError *get_info_error;
 	
@@ -108,6 +108,26 @@ nemo_file_queue_remove (NemoFileQueue *queue,
 	nemo_file_unref (file);
 }
 
+void
+nemo_file_queue_move_to_head (NemoFileQueue *queue,
+				  NemoFile *file)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (queue->item_to_link_map, file);
+
+	if (link == NULL || link == queue->head) {
+		return;
+	}
+
+	if (link == queue->tail) {
+		queue->tail = queue->tail->prev;
+	}
+
+	queue->head = g_list_remove_link (queue->head, link);
+	queue->head = g_list_concat (link, queue->head);
+}
+
 NemoFile *
 nemo_file_queue_head (NemoFileQueue *queue)
 {
@@ -123,3 +143,9 @@ nemo_file_queue_is_empty (NemoFileQueue *queue)
 {
 	return (queue->head == NULL);
 }
+
+GList *
+nemo_file_queue_peek_head_link (NemoFileQueue *queue)
+{
+	return queue->head;
+}
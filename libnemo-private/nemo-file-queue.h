@@ -44,9 +44,18 @@ NemoFile *     nemo_file_queue_dequeue  (NemoFileQueue *queue);
 void               nemo_file_queue_remove   (NemoFileQueue *queue,
 						 NemoFile      *file);
 
+/* Move a file that is already in the queue to its head in constant time. */
+void               nemo_file_queue_move_to_head (NemoFileQueue *queue,
+						     NemoFile      *file);
+
 /* Get the file at the head of the queue without removing or unrefing it. */
 NemoFile *     nemo_file_queue_head     (NemoFileQueue *queue);
 
 gboolean           nemo_file_queue_is_empty (NemoFileQueue *queue);
 
+/* Get the queue's files in order, for looking ahead. The list and the
+ * files are owned by the queue and must not be modified.
+ */
+GList *            nemo_file_queue_peek_head_link (NemoFileQueue *queue);
+
 #endif /* NEMO_FILE_CHANGES_QUEUE_H */
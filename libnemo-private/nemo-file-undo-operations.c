@@ -1291,6 +1291,20 @@ nemo_file_undo_info_trash_add_file (NemoFileUndoInfoTrash *self,
 	g_hash_table_insert (self->priv->trashed, g_object_ref (file), GSIZE_TO_POINTER (orig_trash_time));
 }
 
+/* For files trashed together, with the deletion date their trash info
+ * was written with */
+void
+nemo_file_undo_info_trash_add_files (NemoFileUndoInfoTrash *self,
+					 GList                     *files,
+					 gint64                     trash_time)
+{
+	GList *l;
+
+	for (l = files; l != NULL; l = l->next) {
+		g_hash_table_insert (self->priv->trashed, g_object_ref (l->data), GSIZE_TO_POINTER (trash_time));
+	}
+}
+
 /* recursive permissions */
 G_DEFINE_TYPE (NemoFileUndoInfoRecPermissions, nemo_file_undo_info_rec_permissions, NEMO_TYPE_FILE_UNDO_INFO)
 
@@ -211,6 +211,9 @@ GType nemo_file_undo_info_trash_get_type (void) G_GNUC_CONST;
 NemoFileUndoInfo *nemo_file_undo_info_trash_new (gint item_count);
 void nemo_file_undo_info_trash_add_file (NemoFileUndoInfoTrash *self,
 					     GFile                     *file);
+void nemo_file_undo_info_trash_add_files (NemoFileUndoInfoTrash *self,
+					      GList                     *files,
+					      gint64                     trash_time);
 
 /* recursive permissions */
 #define NEMO_TYPE_FILE_UNDO_INFO_REC_PERMISSIONS         (nemo_file_undo_info_rec_permissions_get_type ())
@@ -35,6 +35,7 @@
 #include "nemo-file-private.h"
 #include "nemo-file-operations.h"
 #include "nemo-file-utilities.h"
+#include "nemo-filter-match.h"
 #include "nemo-global-preferences.h"
 #include "nemo-icon-names.h"
 #include "nemo-lib-self-check-functions.h"
@@ -267,6 +268,8 @@ nemo_file_set_display_name (NemoFile *file,
 
 		g_free (file->details->display_name_collation_key);
 		file->details->display_name_collation_key = g_utf8_collate_key_for_filename (display_name, -1);
+
+		g_clear_pointer (&file->details->display_name_match_key, g_free);
 	}
 
 	if (g_strcmp0 (file->details->edit_name, edit_name) != 0) {
@@ -289,6 +292,7 @@ nemo_file_clear_display_name (NemoFile *file)
 {
     g_clear_pointer (&file->details->display_name, g_ref_string_release);
     g_clear_pointer (&file->details->display_name_collation_key, g_free);
+    g_clear_pointer (&file->details->display_name_match_key, g_free);
     g_clear_pointer (&file->details->edit_name, g_ref_string_release);
 }
 
@@ -508,6 +512,8 @@ nemo_file_clear_info (NemoFile *file)
     g_clear_pointer (&file->details->mime_type, g_ref_string_release);
     g_clear_pointer (&file->details->selinux_context, g_free);
     g_clear_pointer (&file->details->description, g_free);
+    file->details->type_collation_key = NULL;
+    file->details->detailed_type_collation_key = NULL;
     g_clear_pointer (&file->details->owner, g_ref_string_release);
     g_clear_pointer (&file->details->owner_real, g_ref_string_release);
     g_clear_pointer (&file->details->group, g_ref_string_release);
@@ -812,6 +818,7 @@ finalize (GObject *object)
 	g_clear_pointer (&file->details->name, g_ref_string_release);
 	g_clear_pointer (&file->details->display_name, g_ref_string_release);
 	g_free (file->details->display_name_collation_key);
+	g_free (file->details->display_name_match_key);
 	g_clear_pointer (&file->details->edit_name, g_ref_string_release);
 	if (file->details->icon) {
 		g_object_unref (file->details->icon);
@@ -2306,6 +2313,11 @@ update_info_internal (NemoFile *file,
 
 	file->details->file_info_is_up_to_date = TRUE;
 
+	/* The type description depends on the mime type, link and
+	 * executable state, so work it out again when next sorting. */
+	file->details->type_collation_key = NULL;
+	file->details->detailed_type_collation_key = NULL;
+
     file->details->thumbnail_access_problem = FALSE;
 
     file->details->pinning = FILE_META_STATE_INIT;
@@ -3102,25 +3114,26 @@ compare_by_display_name (NemoFile *file_1, NemoFile *file_2)
 	return compare;
 }
 
+/* Same order as collating nemo_file_get_parent_uri_for_display () */
+static const char *
+peek_parent_collation_key (NemoFile *file)
+{
+	if (nemo_file_is_self_owned (file)) {
+		return "";
+	}
+
+	return nemo_directory_peek_location_collation_key (file->details->directory);
+}
+
 static int
 compare_by_directory_name (NemoFile *file_1, NemoFile *file_2)
 {
-	char *directory_1, *directory_2;
-	int compare;
-
 	if (file_1->details->directory == file_2->details->directory) {
 		return 0;
 	}
 
-	directory_1 = nemo_file_get_parent_uri_for_display (file_1);
-	directory_2 = nemo_file_get_parent_uri_for_display (file_2);
-
-	compare = g_utf8_collate (directory_1, directory_2);
-
-	g_free (directory_1);
-	g_free (directory_2);
-
-	return compare;
+	return strcmp (peek_parent_collation_key (file_1),
+		       peek_parent_collation_key (file_2));
 }
 
 static gboolean
@@ -3164,19 +3177,63 @@ prepend_automatic_keywords (NemoFile *file,
 	return names;
 }
 
+/* There are only so many type descriptions, so their collation keys are
+ * kept around for good and files point to them.
+ */
+static const char *
+get_type_collation_key (const char *type_string)
+{
+	static GHashTable *type_collation_keys = NULL;
+	char *key;
+
+	if (type_collation_keys == NULL) {
+		type_collation_keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+							     g_free, g_free);
+	}
+
+	key = g_hash_table_lookup (type_collation_keys, type_string);
+
+	if (key == NULL) {
+		key = g_utf8_collate_key (type_string, -1);
+		g_hash_table_insert (type_collation_keys, g_strdup (type_string), key);
+	}
+
+	return key;
+}
+
+static const char *
+peek_type_collation_key (NemoFile *file, gboolean detailed)
+{
+	const char **key;
+	char *type_string;
+
+	key = detailed ? &file->details->detailed_type_collation_key : &file->details->type_collation_key;
+
+	if (*key == NULL) {
+		type_string = detailed ? nemo_file_get_detailed_type_as_string (file) : nemo_file_get_type_as_string (file);
+
+		if (type_string == NULL) {
+			return NULL;
+		}
+
+		*key = get_type_collation_key (type_string);
+		g_free (type_string);
+	}
+
+	return *key;
+}
+
 static int
 compare_by_type (NemoFile *file_1, NemoFile *file_2, gboolean detailed)
 {
 	gboolean is_directory_1;
 	gboolean is_directory_2;
-	char *type_string_1;
-	char *type_string_2;
-	int result;
+	const char *type_key_1;
+	const char *type_key_2;
 
-	/* Directories go first. Then, if mime types are identical,
-	 * don't bother getting strings (for speed). This assumes
-	 * that the string is dependent entirely on the mime type,
-	 * which is true now but might not be later.
+	/* Directories go first.  Then the type descriptions, through
+	 * collation keys cached on the files, so sorting doesn't build
+	 * and collate two strings for every comparison.
 	 */
 	is_directory_1 = nemo_file_is_directory (file_1);
 	is_directory_2 = nemo_file_is_directory (file_2);
@@ -3193,32 +3250,27 @@ compare_by_type (NemoFile *file_1, NemoFile *file_2, gboolean detailed)
 		return +1;
 	}
 
-    if (detailed) {
-        type_string_1 = nemo_file_get_detailed_type_as_string (file_1);
-        type_string_2 = nemo_file_get_detailed_type_as_string (file_2);
-    } else {
-        type_string_1 = nemo_file_get_type_as_string (file_1);
-        type_string_2 = nemo_file_get_type_as_string (file_2);
-    }
+	type_key_1 = peek_type_collation_key (file_1, detailed);
+	type_key_2 = peek_type_collation_key (file_2, detailed);
 
-	if (type_string_1 == NULL || type_string_2 == NULL) {
-		if (type_string_1 != NULL) {
+	if (type_key_1 == NULL || type_key_2 == NULL) {
+		if (type_key_1 != NULL) {
 			return -1;
 		}
 
-		if (type_string_2 != NULL) {
+		if (type_key_2 != NULL) {
 			return 1;
 		}
 
 		return 0;
 	}
 
-	result = g_utf8_collate (type_string_1, type_string_2);
-
-	g_free (type_string_1);
-	g_free (type_string_2);
+	/* Same description, same interned key */
+	if (type_key_1 == type_key_2) {
+		return 0;
+	}
 
-	return result;
+	return strcmp (type_key_1, type_key_2);
 }
 
 static int
@@ -3449,6 +3501,44 @@ nemo_file_compare_for_sort (NemoFile *file_1,
 	return result;
 }
 
+/* The sort type nemo_file_compare_for_sort () has for @attribute, or
+ * NEMO_FILE_SORT_NONE if it is compared as a plain string.
+ */
+static NemoFileSortType
+get_sort_type_for_attribute_q (GQuark attribute)
+{
+	if (attribute == 0 || attribute == attribute_name_q) {
+		return NEMO_FILE_SORT_BY_DISPLAY_NAME;
+	} else if (attribute == attribute_size_q) {
+		return NEMO_FILE_SORT_BY_SIZE;
+	} else if (attribute == attribute_type_q) {
+		return NEMO_FILE_SORT_BY_TYPE;
+	} else if (attribute == attribute_detailed_type_q) {
+		return NEMO_FILE_SORT_BY_DETAILED_TYPE;
+	} else if (attribute == attribute_modification_date_q ||
+		   attribute == attribute_date_modified_q ||
+		   attribute == attribute_date_modified_with_time_q ||
+		   attribute == attribute_date_modified_full_q) {
+		return NEMO_FILE_SORT_BY_MTIME;
+	} else if (attribute == attribute_accessed_date_q ||
+		   attribute == attribute_date_accessed_q ||
+		   attribute == attribute_date_accessed_full_q) {
+		return NEMO_FILE_SORT_BY_ATIME;
+	} else if (attribute == attribute_creation_date_q ||
+		   attribute == attribute_date_created_q ||
+		   attribute == attribute_date_created_with_time_q ||
+		   attribute == attribute_date_created_full_q) {
+		return NEMO_FILE_SORT_BY_BTIME;
+	} else if (attribute == attribute_trashed_on_q ||
+		   attribute == attribute_trashed_on_full_q) {
+		return NEMO_FILE_SORT_BY_TRASHED_TIME;
+	} else if (attribute == attribute_search_result_count_q) {
+		return NEMO_FILE_SORT_BY_SEARCH_RESULT_COUNT;
+	}
+
+	return NEMO_FILE_SORT_NONE;
+}
+
 int
 nemo_file_compare_for_sort_by_attribute_q   (NemoFile                   *file_1,
 						 NemoFile                   *file_2,
@@ -3458,6 +3548,7 @@ nemo_file_compare_for_sort_by_attribute_q   (NemoFile                   *file_1,
 						 gboolean                        reversed,
                          gpointer                        search_dir)
 {
+	NemoFileSortType sort_type;
 	int result;
 
 	if (file_1 == file_2) {
@@ -3467,79 +3558,16 @@ nemo_file_compare_for_sort_by_attribute_q   (NemoFile                   *file_1,
 	/* Convert certain attributes into NemoFileSortTypes and use
 	 * nemo_file_compare_for_sort()
 	 */
-	if (attribute == 0 || attribute == attribute_name_q) {
-		return nemo_file_compare_for_sort (file_1, file_2,
-						       NEMO_FILE_SORT_BY_DISPLAY_NAME,
-						       directories_first,
-						       favorites_first,
-						       reversed,
-                               search_dir);
-	} else if (attribute == attribute_size_q) {
-		return nemo_file_compare_for_sort (file_1, file_2,
-						       NEMO_FILE_SORT_BY_SIZE,
-						       directories_first,
-						       favorites_first,
-						       reversed,
-                               search_dir);
-	} else if (attribute == attribute_type_q) {
-		return nemo_file_compare_for_sort (file_1, file_2,
-						       NEMO_FILE_SORT_BY_TYPE,
-						       directories_first,
-						       favorites_first,
-						       reversed,
-                               search_dir);
-	} else if (attribute == attribute_detailed_type_q) {
-        return nemo_file_compare_for_sort (file_1, file_2,
-                               NEMO_FILE_SORT_BY_DETAILED_TYPE,
-                               directories_first,
-                               favorites_first,
-                               reversed,
-                               search_dir);
-	} else if (attribute == attribute_modification_date_q ||
-               attribute == attribute_date_modified_q ||
-               attribute == attribute_date_modified_with_time_q ||
-               attribute == attribute_date_modified_full_q) {
-		return nemo_file_compare_for_sort (file_1, file_2,
-						       NEMO_FILE_SORT_BY_MTIME,
-						       directories_first,
-						       favorites_first,
-						       reversed,
-                               search_dir);
-    } else if (attribute == attribute_accessed_date_q ||
-               attribute == attribute_date_accessed_q ||
-               attribute == attribute_date_accessed_full_q) {
-		return nemo_file_compare_for_sort (file_1, file_2,
-						       NEMO_FILE_SORT_BY_ATIME,
-						       directories_first,
-						       favorites_first,
-						       reversed,
-                               search_dir);
-    } else if (attribute == attribute_creation_date_q ||
-               attribute == attribute_date_created_q ||
-               attribute == attribute_date_created_with_time_q ||
-               attribute == attribute_date_created_full_q) {
-        return nemo_file_compare_for_sort (file_1, file_2,
-                               NEMO_FILE_SORT_BY_BTIME,
-                               directories_first,
-                               favorites_first,
-                               reversed,
-                               search_dir);
-    } else if (attribute == attribute_trashed_on_q ||
-               attribute == attribute_trashed_on_full_q) {
+	sort_type = get_sort_type_for_attribute_q (attribute);
+
+	if (sort_type != NEMO_FILE_SORT_NONE) {
 		return nemo_file_compare_for_sort (file_1, file_2,
-						       NEMO_FILE_SORT_BY_TRASHED_TIME,
-						       directories_first,
-						       favorites_first,
-						       reversed,
-                               search_dir);
-	} else if (attribute == attribute_search_result_count_q) {
-        return nemo_file_compare_for_sort (file_1, file_2,
-                               NEMO_FILE_SORT_BY_SEARCH_RESULT_COUNT,
-                               directories_first,
-                               favorites_first,
-                               reversed,
-                               search_dir);
-    }
+						   sort_type,
+						   directories_first,
+						   favorites_first,
+						   reversed,
+						   search_dir);
+	}
 
 	/* it is a normal attribute, compare by strings */
 
@@ -3554,7 +3582,10 @@ nemo_file_compare_for_sort_by_attribute_q   (NemoFile                   *file_1,
 		value_2 = nemo_file_get_string_attribute_q (file_2,
 								attribute);
 
-		if (value_1 != NULL && value_2 != NULL) {
+		/* Files without the attribute go first, as in compare_sort_keys () */
+		if (value_1 == NULL || value_2 == NULL) {
+			result = (value_1 != NULL) - (value_2 != NULL);
+		} else {
 			result = strcmp (value_1, value_2);
 		}
 
@@ -3586,6 +3617,331 @@ nemo_file_compare_for_sort_by_attribute     (NemoFile                   *file_1,
                                   search_dir);
 }
 
+/* A file's position in a bulk sort, worked out once so comparing two of
+ * them doesn't go back to the file.  See nemo_file_sort_for_sort ().
+ */
+typedef struct {
+	guint index;
+	/* favorites, pinned and directories first, lower goes first */
+	guint8 group;
+	/* whatever goes before the value: directory or not, Knowledge */
+	guint8 class;
+	/* see compare_by_display_name (): 0 no name, 1 name, 3 sort last */
+	guint8 name_class;
+	gboolean reversed_sort_order;
+	int sort_order;
+	gint64 value;
+	const char *string; /* type collation key or attribute value */
+	const char *name_key;
+	const char *directory_key;
+	char *owned_string;
+} SortKey;
+
+typedef struct {
+	NemoFileSortType sort_type;
+	gboolean reversed;
+} SortKeyParams;
+
+static void
+fill_sort_key (SortKey *key,
+	       NemoFile *file,
+	       guint index,
+	       NemoFileSortType sort_type,
+	       GQuark attribute,
+	       gboolean directories_first,
+	       gboolean favorites_first,
+	       gpointer search_dir)
+{
+	const char *name;
+	gboolean is_directory;
+	guint count = 0;
+	goffset size = 0;
+	time_t time = 0;
+
+	memset (key, 0, sizeof (SortKey));
+	key->index = index;
+
+	is_directory = nemo_file_is_directory (file);
+
+	/* Same order as nemo_file_compare_for_sort_internal () */
+	key->group = ((favorites_first && !nemo_file_get_is_favorite (file)) << 2) |
+		     (!nemo_file_get_pinning (file) << 1) |
+		     (directories_first && !is_directory);
+	key->sort_order = file->details->sort_order;
+
+	name = nemo_file_peek_display_name (file);
+	if (name == NULL) {
+		key->name_class = 0;
+	} else if (name[0] == SORT_LAST_CHAR1 || name[0] == SORT_LAST_CHAR2) {
+		key->name_class = 3;
+	} else {
+		key->name_class = 1;
+	}
+	key->name_key = nemo_file_peek_display_name_collation_key (file);
+	key->directory_key = peek_parent_collation_key (file);
+
+	switch (sort_type) {
+	case NEMO_FILE_SORT_BY_SIZE:
+		key->class = is_directory ? 0 : 3;
+		if (is_directory) {
+			key->class += get_item_count (file, &count);
+			key->value = count;
+		} else {
+			key->class += get_size (file, &size);
+			key->value = size;
+		}
+		break;
+	case NEMO_FILE_SORT_BY_TYPE:
+	case NEMO_FILE_SORT_BY_DETAILED_TYPE:
+		key->class = is_directory ? 0 : 1;
+		if (!is_directory) {
+			key->string = peek_type_collation_key (file, sort_type == NEMO_FILE_SORT_BY_DETAILED_TYPE);
+		}
+		break;
+	case NEMO_FILE_SORT_BY_MTIME:
+		key->class = get_time (file, &time, NEMO_DATE_TYPE_MODIFIED);
+		key->value = time;
+		break;
+	case NEMO_FILE_SORT_BY_ATIME:
+		key->class = get_time (file, &time, NEMO_DATE_TYPE_ACCESSED);
+		key->value = time;
+		break;
+	case NEMO_FILE_SORT_BY_BTIME:
+		key->class = get_time (file, &time, NEMO_DATE_TYPE_CREATED);
+		key->value = time;
+		break;
+	case NEMO_FILE_SORT_BY_TRASHED_TIME:
+		key->class = get_time (file, &time, NEMO_DATE_TYPE_TRASHED);
+		key->value = time;
+		break;
+	case NEMO_FILE_SORT_BY_SEARCH_RESULT_COUNT:
+		key->value = nemo_file_get_search_result_count (file, search_dir);
+		break;
+	case NEMO_FILE_SORT_NONE:
+		key->owned_string = nemo_file_get_string_attribute_q (file, attribute);
+		key->string = key->owned_string;
+		break;
+	case NEMO_FILE_SORT_BY_DISPLAY_NAME:
+	default:
+		break;
+	}
+}
+
+static int
+compare_sort_key_names (const SortKey *key_1, const SortKey *key_2)
+{
+	if (key_1->name_class != key_2->name_class) {
+		return key_1->name_class < key_2->name_class ? -1 : +1;
+	}
+
+	if (key_1->name_class == 0) {
+		return 0;
+	}
+
+	return g_strcmp0 (key_1->name_key, key_2->name_key);
+}
+
+static int
+compare_sort_key_full_paths (const SortKey *key_1, const SortKey *key_2)
+{
+	int result;
+
+	result = strcmp (key_1->directory_key, key_2->directory_key);
+	if (result != 0) {
+		return result;
+	}
+
+	return compare_sort_key_names (key_1, key_2);
+}
+
+/* Knowledge sorts the other way around: unknown things first */
+static int
+compare_sort_key_values (const SortKey *key_1, const SortKey *key_2,
+			 gboolean descending_class)
+{
+	if (key_1->class != key_2->class) {
+		return (key_1->class < key_2->class) != descending_class ? -1 : +1;
+	}
+
+	if (key_1->value != key_2->value) {
+		return key_1->value < key_2->value ? -1 : +1;
+	}
+
+	return 0;
+}
+
+/* Gives the same order as nemo_file_compare_for_sort () and
+ * nemo_file_compare_for_sort_by_attribute_q () do.
+ */
+static int
+compare_sort_keys (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const SortKey *key_1 = a;
+	const SortKey *key_2 = b;
+	const SortKeyParams *params = user_data;
+	int result;
+
+	if (key_1->group != key_2->group) {
+		return key_1->group < key_2->group ? -1 : +1;
+	}
+
+	if (key_1->sort_order != key_2->sort_order) {
+		result = key_1->sort_order < key_2->sort_order ? -1 : +1;
+		return params->reversed ? -result : result;
+	}
+
+	switch (params->sort_type) {
+	case NEMO_FILE_SORT_BY_DISPLAY_NAME:
+		result = compare_sort_key_names (key_1, key_2);
+		if (result == 0) {
+			result = strcmp (key_1->directory_key, key_2->directory_key);
+		}
+		break;
+	case NEMO_FILE_SORT_BY_SIZE:
+		/* Directories (0-2) before files (3-5), each by Knowledge */
+		if ((key_1->class < 3) != (key_2->class < 3)) {
+			result = key_1->class < 3 ? -1 : +1;
+		} else {
+			result = compare_sort_key_values (key_1, key_2, TRUE);
+		}
+		if (result == 0) {
+			result = compare_sort_key_full_paths (key_1, key_2);
+		}
+		break;
+	case NEMO_FILE_SORT_BY_TYPE:
+	case NEMO_FILE_SORT_BY_DETAILED_TYPE:
+		if (key_1->class != key_2->class) {
+			result = key_1->class < key_2->class ? -1 : +1;
+		} else if (key_1->string == NULL || key_2->string == NULL) {
+			result = (key_1->string == NULL) - (key_2->string == NULL);
+		} else {
+			result = strcmp (key_1->string, key_2->string);
+		}
+		if (result == 0) {
+			result = compare_sort_key_full_paths (key_1, key_2);
+		}
+		break;
+	case NEMO_FILE_SORT_BY_MTIME:
+	case NEMO_FILE_SORT_BY_ATIME:
+	case NEMO_FILE_SORT_BY_BTIME:
+	case NEMO_FILE_SORT_BY_TRASHED_TIME:
+		result = compare_sort_key_values (key_1, key_2, TRUE);
+		if (result == 0) {
+			result = compare_sort_key_full_paths (key_1, key_2);
+		}
+		break;
+	case NEMO_FILE_SORT_BY_SEARCH_RESULT_COUNT:
+		result = compare_sort_key_values (key_1, key_2, FALSE);
+		if (result == 0) {
+			result = compare_sort_key_full_paths (key_1, key_2);
+		}
+		break;
+	case NEMO_FILE_SORT_NONE:
+	default:
+		/* Files without the attribute used to compare equal to
+		 * everything, which is no order at all; they go first. */
+		if (key_1->string == NULL || key_2->string == NULL) {
+			result = (key_1->string != NULL) - (key_2->string != NULL);
+		} else {
+			result = strcmp (key_1->string, key_2->string);
+		}
+		break;
+	}
+
+	if (params->reversed) {
+		result = -result;
+	}
+
+	if (result == 0) {
+		result = key_1->index < key_2->index ? -1 : +1;
+	}
+
+	return result;
+}
+
+static void
+sort_files_by_keys (NemoFile **files,
+		    guint n_files,
+		    NemoFileSortType sort_type,
+		    GQuark attribute,
+		    gboolean directories_first,
+		    gboolean favorites_first,
+		    gboolean reversed,
+		    gpointer search_dir,
+		    guint *order)
+{
+	SortKeyParams params;
+	SortKey *keys;
+	guint i;
+
+	keys = g_new (SortKey, n_files);
+
+	for (i = 0; i < n_files; i++) {
+		fill_sort_key (&keys[i], files[i], i, sort_type, attribute,
+			       directories_first, favorites_first, search_dir);
+	}
+
+	params.sort_type = sort_type;
+	params.reversed = reversed;
+
+	g_qsort_with_data (keys, n_files, sizeof (SortKey), compare_sort_keys, &params);
+
+	for (i = 0; i < n_files; i++) {
+		order[i] = keys[i].index;
+		g_free (keys[i].owned_string);
+	}
+
+	g_free (keys);
+}
+
+/**
+ * nemo_file_sort_for_sort:
+ * @files: (array length=n_files): The files to sort
+ * @order: (out caller-allocates) (array length=n_files): Receives the
+ * indices into @files in sorted order
+ *
+ * Sorts @files the way nemo_file_compare_for_sort () orders them, but
+ * looks up what each file is sorted by only once rather than on every
+ * comparison.  Files that compare equal keep their order.
+ **/
+void
+nemo_file_sort_for_sort (NemoFile **files,
+			 guint n_files,
+			 NemoFileSortType sort_type,
+			 gboolean directories_first,
+			 gboolean favorites_first,
+			 gboolean reversed,
+			 gpointer search_dir,
+			 guint *order)
+{
+	g_return_if_fail (sort_type != NEMO_FILE_SORT_NONE);
+
+	sort_files_by_keys (files, n_files, sort_type, 0,
+			    directories_first, favorites_first, reversed,
+			    search_dir, order);
+}
+
+/**
+ * nemo_file_sort_for_sort_by_attribute_q:
+ *
+ * Like nemo_file_sort_for_sort (), in the order of
+ * nemo_file_compare_for_sort_by_attribute_q ().
+ **/
+void
+nemo_file_sort_for_sort_by_attribute_q (NemoFile **files,
+					guint n_files,
+					GQuark attribute,
+					gboolean directories_first,
+					gboolean favorites_first,
+					gboolean reversed,
+					gpointer search_dir,
+					guint *order)
+{
+	sort_files_by_keys (files, n_files, get_sort_type_for_attribute_q (attribute), attribute,
+			    directories_first, favorites_first, reversed,
+			    search_dir, order);
+}
+
 
 /**
  * nemo_file_compare_name:
@@ -4104,6 +4460,37 @@ nemo_file_get_display_name (NemoFile *file)
 	return g_strdup (nemo_file_peek_display_name (file));
 }
 
+/**
+ * nemo_file_peek_display_name_match_key:
+ *
+ * Get the display name as a key for nemo_filter_match_key_contains().
+ * It is cached until the display name changes.
+ *
+ * @file: The file in question.
+ * @length: Where to store the key length in bytes, or NULL.
+ *
+ * Return value: The match key, owned by @file.
+ */
+const char *
+nemo_file_peek_display_name_match_key (NemoFile *file,
+				       gsize    *length)
+{
+	const char *display_name;
+
+	if (file->details->display_name_match_key == NULL) {
+		display_name = nemo_file_peek_display_name (file);
+
+		file->details->display_name_match_key = nemo_filter_match_key_new (display_name, -1);
+		file->details->display_name_match_key_length = strlen (file->details->display_name_match_key);
+	}
+
+	if (length != NULL) {
+		*length = file->details->display_name_match_key_length;
+	}
+
+	return file->details->display_name_match_key;
+}
+
 char *
 nemo_file_get_edit_name (NemoFile *file)
 {
@@ -8824,6 +9211,40 @@ nemo_file_list_cancel_call_when_ready (NemoFileListHandle *handle)
 	}
 }
 
+/* Move the files to the front of their directories' work queues, so
+ * their attributes are loaded before everything queued earlier.  The
+ * first file in the list ends up first.
+ */
+void
+nemo_file_list_prioritize (GList *file_list)
+{
+	GHashTable *directories;
+	GHashTableIter iter;
+	gpointer directory;
+	GList *l;
+	NemoFile *file;
+
+	directories = g_hash_table_new (NULL, NULL);
+
+	for (l = g_list_last (file_list); l != NULL; l = l->prev) {
+		file = NEMO_FILE (l->data);
+
+		if (file->details->directory == NULL) {
+			continue;
+		}
+
+		nemo_directory_prioritize_file (file->details->directory, file);
+		g_hash_table_add (directories, file->details->directory);
+	}
+
+	g_hash_table_iter_init (&iter, directories);
+	while (g_hash_table_iter_next (&iter, &directory, NULL)) {
+		nemo_directory_async_state_changed (NEMO_DIRECTORY (directory));
+	}
+
+	g_hash_table_destroy (directories);
+}
+
 static void
 thumbnail_limit_changed_callback (gpointer user_data)
 {
@@ -188,6 +188,8 @@ void                    nemo_file_increment_thumbnail_try_count     (NemoFile
 /* Basic attributes for file objects. */
 gboolean                nemo_file_contains_text                     (NemoFile                   *file);
 char *                  nemo_file_get_display_name                  (NemoFile                   *file);
+const char *            nemo_file_peek_display_name_match_key       (NemoFile                   *file,
+									 gsize                      *length);
 char *                  nemo_file_get_edit_name                     (NemoFile                   *file);
 char *                  nemo_file_get_name                          (NemoFile                   *file);
 const char *            nemo_file_peek_name                         (NemoFile                   *file);
@@ -455,6 +457,22 @@ int                     nemo_file_compare_for_sort_by_attribute_q   (NemoFile
 									 gboolean                        favorites_first,
 									 gboolean                        reversed,
                                      gpointer                        search_dir);
+void                    nemo_file_sort_for_sort                     (NemoFile                  **files,
+									 guint                           n_files,
+									 NemoFileSortType                sort_type,
+									 gboolean                        directories_first,
+									 gboolean                        favorites_first,
+									 gboolean                        reversed,
+									 gpointer                        search_dir,
+									 guint                          *order);
+void                    nemo_file_sort_for_sort_by_attribute_q      (NemoFile                  **files,
+									 guint                           n_files,
+									 GQuark                          attribute,
+									 gboolean                        directories_first,
+									 gboolean                        favorites_first,
+									 gboolean                        reversed,
+									 gpointer                        search_dir,
+									 guint                          *order);
 gboolean                nemo_file_is_date_sort_attribute_q          (GQuark                          attribute);
 
 int                     nemo_file_compare_display_name              (NemoFile                   *file_1,
@@ -520,6 +538,8 @@ void                    nemo_file_list_call_when_ready              (GList
 									 NemoFileListCallback        callback,
 									 gpointer                        callback_data);
 void                    nemo_file_list_cancel_call_when_ready       (NemoFileListHandle         *handle);
+/* Views pass the files on screen first, then the ones just outside of it */
+void                    nemo_file_list_prioritize                   (GList                          *file_list);
 
 char *   nemo_file_get_owner_as_string            (NemoFile          *file,
                                                           gboolean           include_real_name);
@@ -0,0 +1,563 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-filter-match.c - matching file names against the filter bar text.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-filter-match.h"
+
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Below this many names a single thread is faster than handing out work */
+#define PARALLEL_MATCH_THRESHOLD 10000
+#define PARALLEL_MATCH_MAX_THREADS 8
+
+/* fzf-style fuzzy scoring */
+#define SCORE_MATCH 16
+#define SCORE_GAP_START -3
+#define SCORE_GAP_EXTENSION -1
+#define BONUS_BOUNDARY 8
+#define BONUS_CONSECUTIVE 4
+#define BONUS_FIRST_CHAR_MULTIPLIER 2
+
+struct NemoFilterQuery {
+	NemoFilterMatchMode mode;
+
+	char *key;
+	gsize key_length;
+
+	GPatternSpec *pattern;
+	GRegex *regex;
+};
+
+char *
+nemo_filter_match_key_new (const char *text,
+			   gssize      length)
+{
+	char *normalized, *key;
+	const char *p;
+	gsize len;
+
+	g_return_val_if_fail (text != NULL, NULL);
+
+	len = length < 0 ? strlen (text) : (gsize) length;
+
+	/* Nearly all names are plain ASCII, which NFKD leaves alone */
+	for (p = text; p < text + len; p++) {
+		if ((guchar) *p >= 0x80) {
+			break;
+		}
+	}
+
+	if (p == text + len) {
+		return g_ascii_strdown (text, len);
+	}
+
+	normalized = g_utf8_normalize (text, len, G_NORMALIZE_ALL);
+	if (normalized == NULL) {
+		/* not valid UTF-8, fall back to something that still matches itself */
+		return g_ascii_strdown (text, len);
+	}
+
+	key = g_utf8_casefold (normalized, -1);
+	g_free (normalized);
+
+	return key;
+}
+
+static gboolean
+contains_scalar (const char *haystack,
+		 gsize       haystack_length,
+		 const char *needle,
+		 gsize       needle_length)
+{
+	const char *p, *last;
+
+	if (needle_length > haystack_length) {
+		return FALSE;
+	}
+
+	last = haystack + haystack_length - needle_length;
+	p = haystack;
+
+	while (p <= last) {
+		p = memchr (p, needle[0], last - p + 1);
+		if (p == NULL) {
+			return FALSE;
+		}
+		if (memcmp (p + 1, needle + 1, needle_length - 1) == 0) {
+			return TRUE;
+		}
+		p++;
+	}
+
+	return FALSE;
+}
+
+#if defined (__SSE2__)
+
+/* Compare the first and the last byte of the needle against 16
+ * candidate positions at once, and only memcmp() the candidates where
+ * both agree.  File names rarely have more than one or two of those.
+ */
+static gboolean
+contains_sse2 (const char *haystack,
+	       gsize       haystack_length,
+	       const char *needle,
+	       gsize       needle_length)
+{
+	const __m128i first = _mm_set1_epi8 (needle[0]);
+	const __m128i last = _mm_set1_epi8 (needle[needle_length - 1]);
+	gsize i;
+
+	for (i = 0; i + needle_length - 1 + 16 <= haystack_length; i += 16) {
+		__m128i block_first, block_last;
+		guint mask;
+
+		block_first = _mm_loadu_si128 ((const __m128i *) (haystack + i));
+		block_last = _mm_loadu_si128 ((const __m128i *) (haystack + i + needle_length - 1));
+
+		mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (first, block_first),
+							 _mm_cmpeq_epi8 (last, block_last)));
+
+		while (mask != 0) {
+			guint bit = __builtin_ctz (mask);
+
+			if (memcmp (haystack + i + bit + 1, needle + 1, needle_length - 2) == 0) {
+				return TRUE;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	/* whatever is left is shorter than one block */
+	return contains_scalar (haystack + i, haystack_length - i,
+				needle, needle_length);
+}
+
+#endif
+
+gboolean
+nemo_filter_match_key_contains (const char *haystack,
+				gsize       haystack_length,
+				const char *needle,
+				gsize       needle_length)
+{
+	if (needle_length == 0) {
+		return TRUE;
+	}
+
+	if (needle_length > haystack_length) {
+		return FALSE;
+	}
+
+	if (needle_length == 1) {
+		return memchr (haystack, needle[0], haystack_length) != NULL;
+	}
+
+#if defined (__SSE2__)
+	if (haystack_length >= 16 + needle_length - 1) {
+		return contains_sse2 (haystack, haystack_length, needle, needle_length);
+	}
+#endif
+
+	return contains_scalar (haystack, haystack_length, needle, needle_length);
+}
+
+static inline gsize
+key_char_length (const char *p)
+{
+	if ((guchar) *p < 0x80) {
+		return 1;
+	}
+
+	return g_utf8_next_char (p) - p;
+}
+
+static inline gboolean
+key_char_matches (const char *h,
+		  const char *h_end,
+		  const char *n,
+		  gsize       n_char_length)
+{
+	if (n_char_length == 1) {
+		return *h == *n;
+	}
+
+	return h + n_char_length <= h_end && memcmp (h, n, n_char_length) == 0;
+}
+
+static inline gboolean
+is_word_separator (char c)
+{
+	switch (c) {
+	case ' ':
+	case '-':
+	case '_':
+	case '.':
+	case ',':
+	case '(':
+	case ')':
+	case '[':
+	case ']':
+	case '+':
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* TRUE if the characters of @needle appear in @haystack in order */
+static gboolean
+is_subsequence (const char *haystack,
+		gsize       haystack_length,
+		const char *needle,
+		gsize       needle_length)
+{
+	const char *h, *h_end, *n, *n_end;
+	gsize n_char_length;
+
+	h_end = haystack + haystack_length;
+	n_end = needle + needle_length;
+
+	for (h = haystack, n = needle; h < h_end && n < n_end; h = g_utf8_next_char (h)) {
+		n_char_length = key_char_length (n);
+		if (key_char_matches (h, h_end, n, n_char_length)) {
+			n += n_char_length;
+		}
+	}
+
+	return n >= n_end;
+}
+
+static gint
+fuzzy_score (const char *haystack,
+	     gsize       haystack_length,
+	     const char *needle,
+	     gsize       needle_length)
+{
+	const char *h, *h_end, *n, *n_end, *prev, *start, *end;
+	gsize n_char_length;
+	gboolean prev_matched, in_gap, first;
+	gint score, bonus;
+
+	h_end = haystack + haystack_length;
+	n_end = needle + needle_length;
+
+	/* Forward pass, which is all most rejected names ever see */
+	for (h = haystack, n = needle; h < h_end && n < n_end; h = g_utf8_next_char (h)) {
+		n_char_length = key_char_length (n);
+		if (key_char_matches (h, h_end, n, n_char_length)) {
+			n += n_char_length;
+		}
+	}
+
+	if (n < n_end) {
+		return NEMO_FILTER_NO_MATCH;
+	}
+
+	end = h;
+
+	/* Walk back from the end to find the shortest matching window */
+	for (h = end, n = n_end; n > needle; ) {
+		const char *n_prev;
+
+		h = g_utf8_prev_char (h);
+		n_prev = g_utf8_prev_char (n);
+		if (key_char_matches (h, end, n_prev, n - n_prev)) {
+			n = n_prev;
+		}
+	}
+
+	start = h;
+
+	score = 0;
+	prev_matched = FALSE;
+	in_gap = FALSE;
+	first = TRUE;
+	prev = start > haystack ? g_utf8_prev_char (start) : NULL;
+
+	for (h = start, n = needle; h < end && n < n_end; prev = h, h = g_utf8_next_char (h)) {
+		n_char_length = key_char_length (n);
+
+		if (key_char_matches (h, end, n, n_char_length)) {
+			bonus = 0;
+			if (prev == NULL || is_word_separator (*prev)) {
+				bonus = BONUS_BOUNDARY;
+			}
+			if (prev_matched) {
+				bonus = MAX (bonus, BONUS_CONSECUTIVE);
+			}
+			if (first) {
+				bonus *= BONUS_FIRST_CHAR_MULTIPLIER;
+				first = FALSE;
+			}
+
+			score += SCORE_MATCH + bonus;
+			n += n_char_length;
+			prev_matched = TRUE;
+			in_gap = FALSE;
+		} else {
+			score += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+			prev_matched = FALSE;
+			in_gap = TRUE;
+		}
+	}
+
+	return score;
+}
+
+NemoFilterQuery *
+nemo_filter_query_new (const char          *text,
+		       NemoFilterMatchMode  mode,
+		       GError             **error)
+{
+	NemoFilterQuery *query;
+
+	g_return_val_if_fail (text != NULL, NULL);
+
+	query = g_new0 (NemoFilterQuery, 1);
+	query->mode = mode;
+	query->key = nemo_filter_match_key_new (text, -1);
+	query->key_length = strlen (query->key);
+
+	if (mode == NEMO_FILTER_MATCH_GLOB) {
+		if (strpbrk (query->key, "*?") == NULL) {
+			char *pattern;
+
+			/* no wildcards yet, behave like a substring search */
+			pattern = g_strconcat ("*", query->key, "*", NULL);
+			query->pattern = g_pattern_spec_new (pattern);
+			g_free (pattern);
+		} else {
+			query->pattern = g_pattern_spec_new (query->key);
+		}
+	} else if (mode == NEMO_FILTER_MATCH_REGEX) {
+		char *normalized;
+
+		/* Not case folded: that would turn \W into \w.  Names are
+		 * folded already and G_REGEX_CASELESS takes care of the rest. */
+		normalized = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+		query->regex = g_regex_new (normalized != NULL ? normalized : text,
+					    G_REGEX_CASELESS | G_REGEX_OPTIMIZE,
+					    0, error);
+		g_free (normalized);
+
+		if (query->regex == NULL) {
+			nemo_filter_query_free (query);
+			return NULL;
+		}
+	}
+
+	return query;
+}
+
+void
+nemo_filter_query_free (NemoFilterQuery *query)
+{
+	if (query == NULL) {
+		return;
+	}
+
+	g_free (query->key);
+	g_clear_pointer (&query->pattern, g_pattern_spec_free);
+	g_clear_pointer (&query->regex, g_regex_unref);
+	g_free (query);
+}
+
+NemoFilterMatchMode
+nemo_filter_query_get_mode (NemoFilterQuery *query)
+{
+	return query->mode;
+}
+
+gboolean
+nemo_filter_query_narrows (NemoFilterQuery *query,
+			   NemoFilterQuery *previous)
+{
+	if (query == NULL || previous == NULL || query->mode != previous->mode) {
+		return FALSE;
+	}
+
+	switch (query->mode) {
+	case NEMO_FILTER_MATCH_SUBSTRING:
+		return nemo_filter_match_key_contains (query->key, query->key_length,
+						       previous->key, previous->key_length);
+	case NEMO_FILTER_MATCH_FUZZY:
+		return is_subsequence (query->key, query->key_length,
+				       previous->key, previous->key_length);
+	case NEMO_FILTER_MATCH_GLOB:
+	case NEMO_FILTER_MATCH_REGEX:
+	default:
+		return FALSE;
+	}
+}
+
+gint
+nemo_filter_query_match (NemoFilterQuery *query,
+			 const char      *key,
+			 gsize            key_length)
+{
+	gboolean matched;
+
+	switch (query->mode) {
+	case NEMO_FILTER_MATCH_FUZZY:
+		return fuzzy_score (key, key_length, query->key, query->key_length);
+	case NEMO_FILTER_MATCH_GLOB:
+		matched = g_pattern_match (query->pattern, key_length, key, NULL);
+		break;
+	case NEMO_FILTER_MATCH_REGEX:
+		matched = g_regex_match_full (query->regex, key, key_length, 0, 0, NULL, NULL);
+		break;
+	case NEMO_FILTER_MATCH_SUBSTRING:
+	default:
+		matched = nemo_filter_match_key_contains (key, key_length,
+							  query->key, query->key_length);
+		break;
+	}
+
+	return matched ? 0 : NEMO_FILTER_NO_MATCH;
+}
+
+/* What the threads working on one batch share */
+typedef struct {
+	GMutex lock;
+	GCond cond;
+	guint n_pending; /* chunks handed to the pool and not done yet */
+} MatchBatch;
+
+typedef struct {
+	NemoFilterQuery *query;
+	const char * const *keys;
+	const gsize *key_lengths;
+	gint *scores;
+	guint start;
+	guint end;
+	MatchBatch *batch;
+} MatchChunk;
+
+static void
+match_chunk (MatchChunk *chunk)
+{
+	guint i;
+
+	for (i = chunk->start; i < chunk->end; i++) {
+		chunk->scores[i] = nemo_filter_query_match (chunk->query,
+							    chunk->keys[i],
+							    chunk->key_lengths[i]);
+	}
+}
+
+static void
+match_pool_func (gpointer data,
+		 gpointer user_data)
+{
+	MatchChunk *chunk = data;
+	MatchBatch *batch = chunk->batch;
+
+	match_chunk (chunk);
+
+	g_mutex_lock (&batch->lock);
+	if (--batch->n_pending == 0) {
+		g_cond_signal (&batch->cond);
+	}
+	g_mutex_unlock (&batch->lock);
+}
+
+/* Started on first use and kept, so typing into the filter bar doesn't
+ * start and join threads for every chunk of names.  The calling thread
+ * always works on a chunk too, hence one thread fewer.
+ */
+static GThreadPool *
+get_match_pool (void)
+{
+	static GThreadPool *pool = NULL;
+
+	if (g_once_init_enter (&pool)) {
+		GThreadPool *new_pool;
+
+		new_pool = g_thread_pool_new (match_pool_func, NULL,
+					      PARALLEL_MATCH_MAX_THREADS - 1,
+					      FALSE, NULL);
+		g_once_init_leave (&pool, new_pool);
+	}
+
+	return pool;
+}
+
+void
+nemo_filter_query_match_batch (NemoFilterQuery    *query,
+			       const char * const *keys,
+			       const gsize        *key_lengths,
+			       guint               n_keys,
+			       gint               *scores)
+{
+	MatchBatch batch;
+	MatchChunk *chunks;
+	GThreadPool *pool;
+	guint n_threads, per_thread, i;
+
+	n_threads = MIN (g_get_num_processors (), PARALLEL_MATCH_MAX_THREADS);
+
+	if (n_keys < PARALLEL_MATCH_THRESHOLD || n_threads < 2) {
+		MatchChunk chunk = { query, keys, key_lengths, scores, 0, n_keys, NULL };
+
+		match_chunk (&chunk);
+		return;
+	}
+
+	pool = get_match_pool ();
+
+	g_mutex_init (&batch.lock);
+	g_cond_init (&batch.cond);
+	batch.n_pending = n_threads - 1;
+
+	chunks = g_new (MatchChunk, n_threads);
+	per_thread = (n_keys + n_threads - 1) / n_threads;
+
+	for (i = 0; i < n_threads; i++) {
+		chunks[i].query = query;
+		chunks[i].keys = keys;
+		chunks[i].key_lengths = key_lengths;
+		chunks[i].scores = scores;
+		chunks[i].start = MIN (i * per_thread, n_keys);
+		chunks[i].end = MIN (chunks[i].start + per_thread, n_keys);
+		chunks[i].batch = &batch;
+	}
+
+	/* the calling thread takes the first chunk itself */
+	for (i = 1; i < n_threads; i++) {
+		g_thread_pool_push (pool, &chunks[i], NULL);
+	}
+
+	match_chunk (&chunks[0]);
+
+	g_mutex_lock (&batch.lock);
+	while (batch.n_pending > 0) {
+		g_cond_wait (&batch.cond, &batch.lock);
+	}
+	g_mutex_unlock (&batch.lock);
+
+	g_mutex_clear (&batch.lock);
+	g_cond_clear (&batch.cond);
+	g_free (chunks);
+}
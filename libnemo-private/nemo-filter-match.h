@@ -0,0 +1,83 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-filter-match.h - matching file names against the filter bar text.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_FILTER_MATCH_H
+#define NEMO_FILTER_MATCH_H
+
+#include <glib.h>
+
+/* Keep in sync with org.nemo.FilterMatchMode */
+typedef enum {
+	NEMO_FILTER_MATCH_SUBSTRING,
+	NEMO_FILTER_MATCH_FUZZY,
+	NEMO_FILTER_MATCH_GLOB,
+	NEMO_FILTER_MATCH_REGEX
+} NemoFilterMatchMode;
+
+/* Score of a name the query doesn't match */
+#define NEMO_FILTER_NO_MATCH G_MININT
+
+typedef struct NemoFilterQuery NemoFilterQuery;
+
+/* Build the key that names and filter text are compared by: NFKD
+ * normalized and case folded UTF-8.  Free with g_free.
+ */
+char *   nemo_filter_match_key_new        (const char *text,
+					   gssize      length);
+
+/* Does @needle occur in @haystack?  Both must be match keys; because
+ * UTF-8 is self-synchronizing a plain byte search is enough.  Never
+ * allocates.
+ */
+gboolean nemo_filter_match_key_contains   (const char *haystack,
+					   gsize       haystack_length,
+					   const char *needle,
+					   gsize       needle_length);
+
+/* A compiled filter bar query.  Matching is read-only, so one query
+ * can be shared by several threads.
+ */
+NemoFilterQuery *   nemo_filter_query_new         (const char          *text,
+						   NemoFilterMatchMode  mode,
+						   GError             **error);
+void                nemo_filter_query_free        (NemoFilterQuery     *query);
+NemoFilterMatchMode nemo_filter_query_get_mode    (NemoFilterQuery     *query);
+
+/* TRUE if everything @query matches was also matched by @previous, so
+ * names @previous rejected don't need to be looked at again.
+ */
+gboolean            nemo_filter_query_narrows     (NemoFilterQuery     *query,
+						   NemoFilterQuery     *previous);
+
+/* Returns NEMO_FILTER_NO_MATCH, or a score where higher is better.
+ * Only fuzzy queries rank; every other mode scores matches as 0.
+ */
+gint                nemo_filter_query_match       (NemoFilterQuery     *query,
+						   const char          *key,
+						   gsize                key_length);
+
+/* Score @n_keys keys at once, spreading big batches over all cores. */
+void                nemo_filter_query_match_batch (NemoFilterQuery     *query,
+						   const char * const  *keys,
+						   const gsize         *key_lengths,
+						   guint                n_keys,
+						   gint                *scores);
+
+#endif /* NEMO_FILTER_MATCH_H */
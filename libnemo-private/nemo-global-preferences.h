@@ -45,6 +45,7 @@ G_BEGIN_DECLS
 #define NEMO_PREFERENCES_DATE_FORMAT            "date-format"
 #define NEMO_PREFERENCES_DATE_FONT_CHOICE  "date-font-choice"
 #define NEMO_PREFERENCES_MONO_FONT_NAME "monospace-font-name"
+#define NEMO_PREFERENCES_FILTER_MATCH_MODE "filter-match-mode"
 
 /* Mouse */
 #define NEMO_PREFERENCES_MOUSE_USE_EXTRA_BUTTONS		"mouse-use-extra-buttons"
@@ -268,6 +269,9 @@ typedef enum
 /* File operations queue */
 #define NEMO_PREFERENCES_NEVER_QUEUE_FILE_OPS          "never-queue-file-ops"
 
+/* Count the sources before a copy, or while it runs */
+#define NEMO_PREFERENCES_SCAN_BEFORE_COPY              "scan-before-copy"
+
 #define NEMO_PREFERENCES_CLICK_DOUBLE_PARENT_FOLDER    "click-double-parent-folder"
 #define NEMO_PREFERENCES_EXPAND_ROW_ON_DND_DWELL       "expand-row-on-dnd-dwell"
 
@@ -285,6 +289,7 @@ typedef enum
 #define NEMO_PREFERENCES_SEARCH_VISIBLE_COLUMNS        "search-visible-columns"
 #define NEMO_PREFERENCES_SEARCH_SORT_COLUMN            "search-sort-column"
 #define NEMO_PREFERENCES_SEARCH_REVERSE_SORT           "search-reverse-sort"
+#define NEMO_PREFERENCES_SEARCH_WORKER_THREADS         "search-worker-threads"
 
 void nemo_global_preferences_init                      (void);
 void nemo_global_preferences_finalize                  (void);
@@ -116,6 +116,10 @@ struct NemoIconCanvasItemDetails {
 
 	guint is_visible : 1;
 
+	/* text sizes are a placeholder until the item comes into view */
+	guint text_is_estimate : 1;
+	guint text_must_be_measured : 1;
+
     guint is_pinned : 1;
     guint fav_unavailable : 1;
 
@@ -874,6 +878,56 @@ prepare_pango_layout_for_draw (NemoIconCanvasItem *item,
 	}
 }
 
+/* In the icon grid the layout only needs the label's footprint, which is
+ * the same for every item at a given zoom level, so items away from the
+ * viewport get that instead of a PangoLayout of their own.  They are
+ * measured for real when they scroll into view, or when a hit test
+ * reaches them.  Selected labels show more lines than the layout allows
+ * for, so they are always measured. */
+static gboolean
+estimate_label_text (NemoIconCanvasItem *item)
+{
+	NemoIconCanvasItemDetails *details;
+	NemoIconContainer *container;
+	double pixels_per_unit;
+	int max_text_width, text_height;
+
+	details = item->details;
+	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+
+	if (details->is_visible ||
+	    details->text_must_be_measured ||
+	    details->is_highlighted_for_selection ||
+	    container->details->is_desktop ||
+	    container->details->label_position != NEMO_ICON_LABEL_POSITION_UNDER) {
+		return FALSE;
+	}
+
+	max_text_width = floor (nemo_icon_canvas_item_get_max_text_width (item));
+	if (max_text_width < 0) {
+		return FALSE;
+	}
+
+	pixels_per_unit = EEL_CANVAS_ITEM (item)->canvas->pixels_per_unit;
+
+	if (container->details->fixed_text_height < 0) {
+		container->details->fixed_text_height =
+			nemo_icon_canvas_item_get_fixed_text_height_for_layout (item) / pixels_per_unit;
+	}
+
+	text_height = container->details->fixed_text_height * pixels_per_unit + TEXT_BACK_PADDING_Y*2;
+
+	details->text_dx = 0;
+	details->text_width = max_text_width + TEXT_BACK_PADDING_X*2;
+	details->text_height = text_height;
+	details->text_height_for_layout = text_height;
+	details->text_height_for_entire_text = text_height;
+	details->editable_text_height = text_height;
+	details->text_is_estimate = TRUE;
+
+	return TRUE;
+}
+
 static void
 measure_label_text (NemoIconCanvasItem *item)
 {
@@ -916,6 +970,12 @@ measure_label_text (NemoIconCanvasItem *item)
 	return;
 #endif
 
+	if (estimate_label_text (item)) {
+		return;
+	}
+
+	details->text_is_estimate = FALSE;
+
 	editable_width = 0;
 	editable_height = 0;
 	editable_height_for_layout = 0;
@@ -1190,7 +1250,37 @@ nemo_icon_canvas_item_set_is_visible (NemoIconCanvasItem       *item,
 
 	if (!visible) {
 		nemo_icon_canvas_item_invalidate_label (item);
+	} else if (item->details->text_is_estimate) {
+		nemo_icon_canvas_item_invalidate_label_size (item);
+		eel_canvas_item_request_update (EEL_CANVAS_ITEM (item));
+	}
+}
+
+void
+nemo_icon_canvas_item_ensure_label_measured (NemoIconCanvasItem *item)
+{
+	NemoIconCanvasItemDetails *details;
+
+	details = item->details;
+
+	if (!details->text_is_estimate) {
+		return;
+	}
+
+	details->text_must_be_measured = TRUE;
+	nemo_icon_canvas_item_invalidate_label_size (item);
+	nemo_icon_canvas_item_ensure_bounds_up_to_date (item);
+	details->text_must_be_measured = FALSE;
+
+	/* Only items in view keep their layouts */
+	if (!details->is_visible) {
+		g_clear_object (&details->editable_text_layout);
+		g_clear_object (&details->additional_text_layout);
 	}
+
+	details->text_rect = compute_text_rectangle (item, details->canvas_rect,
+						     TRUE, BOUNDS_USAGE_FOR_DISPLAY);
+	eel_canvas_item_request_update (EEL_CANVAS_ITEM (item));
 }
 
 void
@@ -1592,6 +1682,10 @@ hit_test (NemoIconCanvasItem *icon_item, EelIRect canvas_rect)
 		return TRUE;
 	}
 
+	/* An estimated label is as wide as any label can be, only the real
+	 * one tells whether it was hit */
+	nemo_icon_canvas_item_ensure_label_measured (icon_item);
+
 	/* Check for hit in the text. */
 	if (eel_irect_hits_irect (details->text_rect, canvas_rect)
 	    && !icon_item->details->is_renaming) {
@@ -87,6 +87,7 @@ gboolean    nemo_icon_canvas_item_hit_test_stretch_handles (NemoIconCanvasItem
 								gdouble                       world_y,
 								GtkCornerType                *corner);
 void        nemo_icon_canvas_item_invalidate_label         (NemoIconCanvasItem       *item);
+void        nemo_icon_canvas_item_ensure_label_measured    (NemoIconCanvasItem       *item);
 void        nemo_icon_canvas_item_invalidate_label_size    (NemoIconCanvasItem       *item);
 EelDRect    nemo_icon_canvas_item_get_icon_rectangle       (const NemoIconCanvasItem *item);
 EelDRect    nemo_icon_canvas_item_get_text_rectangle       (NemoIconCanvasItem       *item,
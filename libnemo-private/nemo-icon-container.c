@@ -545,6 +545,10 @@ reveal_icon (NemoIconContainer *container,
 
 	set_pending_icon_to_reveal (container, NULL);
 
+	/* Its neighbours may still have estimated labels, which are never
+	 * narrower than the real ones */
+	nemo_icon_canvas_item_ensure_label_measured (icon->item);
+
 	gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
 
 	hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
@@ -2222,6 +2226,9 @@ get_rubberband (NemoIcon *icon1,
 	EelDRect rect2;
 	EelDRect ret;
 
+	nemo_icon_canvas_item_ensure_label_measured (icon1->item);
+	nemo_icon_canvas_item_ensure_label_measured (icon2->item);
+
 	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon1->item),
 				    &rect1.x0, &rect1.y0,
 				    &rect1.x1, &rect1.y1);
@@ -5602,12 +5609,13 @@ update_visible_icons_cb (NemoIconContainer *container)
 	double min_y, max_y;
 	double min_x, max_x;
 	double x0, y0, x1, y1;
-	GList *node;
+	GList *node, *on_screen, *margin;
 	NemoIcon *icon;
-	gboolean visible;
+	gboolean visible, is_on_screen;
 	GtkAllocation allocation;
 
     container->details->update_visible_icons_id = 0;
+    on_screen = margin = NULL;
 
 	hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
 	vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
@@ -5627,6 +5635,12 @@ update_visible_icons_cb (NemoIconContainer *container)
 	for (node = g_list_last (container->details->icons); node != NULL; node = node->prev) {
 		icon = node->data;
 
+		if (icon->is_filtered_out) {
+			/* Its position is stale, don't let it load anything */
+			nemo_icon_canvas_item_set_is_visible (icon->item, FALSE);
+			continue;
+		}
+
 		if (nemo_icon_container_icon_is_positioned (icon)) {
 			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
 						    &x0,
@@ -5646,10 +5660,12 @@ update_visible_icons_cb (NemoIconContainer *container)
                 overshoot = (max_x - min_x) / 2;
 
 				visible = x1 >= min_x - overshoot && x0 <= max_x + overshoot;
+				is_on_screen = x1 >= min_x && x0 <= max_x;
 			} else {
                 overshoot = (max_y - min_y) / 2;
 
 				visible = y1 >= min_y - overshoot && y0 <= max_y + overshoot;
+				is_on_screen = y1 >= min_y && y0 <= max_y;
 			}
 
 			if (visible) {
@@ -5672,12 +5688,23 @@ update_visible_icons_cb (NemoIconContainer *container)
 				}
 
 				nemo_icon_container_update_icon (container, icon);
+
+				/* Walking backwards, so prepending leaves both lists in icon order */
+				if (is_on_screen) {
+					on_screen = g_list_prepend (on_screen, nemo_file_ref (file));
+				} else {
+					margin = g_list_prepend (margin, nemo_file_ref (file));
+				}
 			} else {
 				nemo_icon_canvas_item_set_is_visible (icon->item, FALSE);
 			}
 		}
 	}
 
+	on_screen = g_list_concat (on_screen, margin);
+	nemo_file_list_prioritize (on_screen);
+	nemo_file_list_free (on_screen);
+
     return G_SOURCE_REMOVE;
 }
 
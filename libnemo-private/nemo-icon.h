@@ -71,6 +71,9 @@ typedef struct {
 
 	eel_boolean_bit has_lazy_position : 1;
 
+	/* Whether the window's filter hides this item. Layout skips it. */
+	eel_boolean_bit is_filtered_out : 1;
+
     eel_boolean_bit ok_to_show_thumb : 1;
 } NemoIcon;
 
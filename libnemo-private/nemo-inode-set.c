@@ -0,0 +1,163 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-inode-set.c - remembering which (device, inode) pairs were seen.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-inode-set.h"
+
+#define INITIAL_CAPACITY 64
+
+typedef struct {
+	guint64 device;
+	guint64 inode; /* 0 marks an empty slot */
+} InodeSlot;
+
+/* Linear probing, kept at most half full */
+struct NemoInodeSet {
+	InodeSlot *slots;
+	guint capacity; /* a power of two */
+	guint size;
+};
+
+static inline guint64
+mix (guint64 x)
+{
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= G_GUINT64_CONSTANT (0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= G_GUINT64_CONSTANT (0x94d049bb133111eb);
+	x ^= x >> 31;
+
+	return x;
+}
+
+static inline guint
+slot_for (guint64 device,
+	  guint64 inode,
+	  guint   capacity)
+{
+	return (guint) (mix (inode ^ mix (device)) & (capacity - 1));
+}
+
+static InodeSlot *
+lookup_slot (InodeSlot *slots,
+	     guint      capacity,
+	     guint64    device,
+	     guint64    inode)
+{
+	guint i;
+
+	for (i = slot_for (device, inode, capacity);
+	     slots[i].inode != 0;
+	     i = (i + 1) & (capacity - 1)) {
+		if (slots[i].inode == inode && slots[i].device == device) {
+			break;
+		}
+	}
+
+	return &slots[i];
+}
+
+static void
+grow (NemoInodeSet *set)
+{
+	InodeSlot *old_slots;
+	guint old_capacity, i;
+
+	old_slots = set->slots;
+	old_capacity = set->capacity;
+
+	set->capacity *= 2;
+	set->slots = g_new0 (InodeSlot, set->capacity);
+
+	for (i = 0; i < old_capacity; i++) {
+		if (old_slots[i].inode != 0) {
+			*lookup_slot (set->slots, set->capacity,
+				      old_slots[i].device, old_slots[i].inode) = old_slots[i];
+		}
+	}
+
+	g_free (old_slots);
+}
+
+NemoInodeSet *
+nemo_inode_set_new (void)
+{
+	NemoInodeSet *set;
+
+	set = g_new0 (NemoInodeSet, 1);
+	set->capacity = INITIAL_CAPACITY;
+	set->slots = g_new0 (InodeSlot, set->capacity);
+
+	return set;
+}
+
+void
+nemo_inode_set_free (NemoInodeSet *set)
+{
+	g_free (set->slots);
+	g_free (set);
+}
+
+gboolean
+nemo_inode_set_add (NemoInodeSet *set,
+		    guint64       device,
+		    guint64       inode)
+{
+	InodeSlot *slot;
+
+	if (inode == 0) {
+		return FALSE;
+	}
+
+	slot = lookup_slot (set->slots, set->capacity, device, inode);
+
+	if (slot->inode != 0) {
+		return FALSE;
+	}
+
+	slot->device = device;
+	slot->inode = inode;
+	set->size++;
+
+	if (set->size * 2 > set->capacity) {
+		grow (set);
+	}
+
+	return TRUE;
+}
+
+gboolean
+nemo_inode_set_contains (NemoInodeSet *set,
+			 guint64       device,
+			 guint64       inode)
+{
+	if (inode == 0) {
+		return FALSE;
+	}
+
+	return lookup_slot (set->slots, set->capacity, device, inode)->inode != 0;
+}
+
+guint
+nemo_inode_set_size (NemoInodeSet *set)
+{
+	return set->size;
+}
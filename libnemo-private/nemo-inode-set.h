@@ -0,0 +1,45 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-inode-set.h - remembering which (device, inode) pairs were seen.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_INODE_SET_H
+#define NEMO_INODE_SET_H
+
+#include <glib.h>
+
+/* An open-addressing hash set of (device, inode) pairs, used by deep
+ * counts to only count the size of hard-linked files once.
+ */
+typedef struct NemoInodeSet NemoInodeSet;
+
+NemoInodeSet * nemo_inode_set_new    (void);
+void           nemo_inode_set_free   (NemoInodeSet *set);
+
+/* Returns TRUE if the pair wasn't in the set yet.  Inode 0 means
+ * "unknown" and is never added.
+ */
+gboolean       nemo_inode_set_add    (NemoInodeSet *set,
+				      guint64       device,
+				      guint64       inode);
+gboolean       nemo_inode_set_contains (NemoInodeSet *set,
+				        guint64       device,
+				        guint64       inode);
+guint          nemo_inode_set_size   (NemoInodeSet *set);
+
+#endif /* NEMO_INODE_SET_H */
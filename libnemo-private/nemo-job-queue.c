@@ -41,6 +41,8 @@ typedef struct {
     gpointer user_data;
     NemoProgressInfo *info;
     GCancellable *cancellable;
+    /* Filesystems the job reads or writes, NULL if unknown */
+    gchar **devices;
 } Job;
 
 static NemoJobQueue *singleton = NULL;
@@ -163,6 +165,7 @@ job_finished_cb (NemoJobQueue *self,
     self->priv->running_jobs = g_list_remove (self->priv->running_jobs, job);
     self->priv->queued_jobs = g_list_remove (self->priv->queued_jobs, job);
 
+    g_strfreev (job->devices);
     g_free (job);
 
     nemo_job_queue_start_next_job (self);
@@ -182,10 +185,12 @@ nemo_job_queue_add_new_job (NemoJobQueue         *self,
                             gpointer              user_data,
                             GCancellable         *cancellable,
                             NemoProgressInfo     *info,
+                            gchar               **devices,
                             gboolean              start_immediately)
 {
 	if (g_list_find_custom (self->priv->queued_jobs, user_data, (GCompareFunc) compare_job_data_func) != NULL) {
 		g_warning ("Adding the same file job object to the job queue");
+		g_strfreev (devices);
 		return;
 	}
 
@@ -194,6 +199,7 @@ nemo_job_queue_add_new_job (NemoJobQueue         *self,
     new_job->user_data = user_data;
     new_job->cancellable = cancellable;
     new_job->info = info;
+    new_job->devices = devices;
 
 	self->priv->queued_jobs =
 		g_list_append (self->priv->queued_jobs, new_job);
@@ -225,11 +231,63 @@ start_job (NemoJobQueue *self, Job *job)
     self->priv->running_jobs = g_list_append (self->priv->running_jobs, job);
 }
 
+/* Jobs we don't know the filesystems of contend with everything */
+static gboolean
+jobs_share_device (Job *job,
+                   Job *other)
+{
+    gint i;
+
+    if (job->devices == NULL || other->devices == NULL)
+        return TRUE;
+
+    for (i = 0; job->devices[i] != NULL; i++) {
+        if (g_strv_contains ((const gchar * const *) other->devices, job->devices[i]))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static gboolean
+job_shares_device_with_any (Job   *job,
+                            GList *jobs)
+{
+    GList *l;
+
+    for (l = jobs; l != NULL; l = l->next) {
+        if (jobs_share_device (job, l->data))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Start every queued job whose filesystems are idle.  A job waits for
+ * the running jobs it shares a device with, and for the jobs queued
+ * ahead of it that do, so each device works through its jobs in queue
+ * order while independent devices are busy at the same time. */
 void
 nemo_job_queue_start_next_job (NemoJobQueue *self)
 {
-    if (g_list_length (self->priv->running_jobs) == 0 && g_list_length (self->priv->queued_jobs) > 0)
-        start_job (self, self->priv->queued_jobs->data);
+    GList *l, *next, *waiting;
+    Job *job;
+
+    waiting = NULL;
+
+    for (l = self->priv->queued_jobs; l != NULL; l = next) {
+        next = l->next;
+        job = l->data;
+
+        if (job_shares_device_with_any (job, self->priv->running_jobs) ||
+            job_shares_device_with_any (job, waiting)) {
+            waiting = g_list_prepend (waiting, job);
+        } else {
+            start_job (self, job);
+        }
+    }
+
+    g_list_free (waiting);
 }
 
 void
@@ -242,6 +300,32 @@ nemo_job_queue_start_job_by_info (NemoJobQueue     *self,
         start_job (self, target->data);
 }
 
+/* Moves a queued job ahead of the one queued before it.  Returns FALSE
+ * if it is running already or first in line. */
+gboolean
+nemo_job_queue_move_job_up (NemoJobQueue     *self,
+                            NemoProgressInfo *info)
+{
+    GList *target, *previous;
+    Job *job;
+
+    target = g_list_find_custom (self->priv->queued_jobs, info, (GCompareFunc) compare_info_func);
+
+    if (target == NULL || target->prev == NULL)
+        return FALSE;
+
+    job = target->data;
+    previous = target->prev;
+
+    self->priv->queued_jobs = g_list_delete_link (self->priv->queued_jobs, target);
+    self->priv->queued_jobs = g_list_insert_before (self->priv->queued_jobs, previous, job);
+
+    /* It may not have to wait for the job it overtook */
+    nemo_job_queue_start_next_job (self);
+
+    return TRUE;
+}
+
 GList *
 nemo_job_queue_get_all_jobs (NemoJobQueue *self)
 {
@@ -62,6 +62,7 @@ void nemo_job_queue_add_new_job (NemoJobQueue *self,
                                  gpointer user_data,
                                  GCancellable *cancellable,
                                  NemoProgressInfo *info,
+                                 gchar **devices,
                                  gboolean start_immediately);
 
 void nemo_job_queue_start_next_job (NemoJobQueue *self);
@@ -69,6 +70,9 @@ void nemo_job_queue_start_next_job (NemoJobQueue *self);
 void nemo_job_queue_start_job_by_info (NemoJobQueue     *self,
                                        NemoProgressInfo *info);
 
+gboolean nemo_job_queue_move_job_up (NemoJobQueue     *self,
+                                     NemoProgressInfo *info);
+
 GList *nemo_job_queue_get_all_jobs (NemoJobQueue *self);
 
 G_END_DECLS
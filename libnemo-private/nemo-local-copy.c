@@ -0,0 +1,330 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-local-copy.c - copying local files with the kernel's help.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+/* For copy_file_range() */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "nemo-local-copy.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#if HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+
+/* Bytes per copy_file_range() call, so cancellation and progress are
+ * looked at now and then even when the kernel does all the work */
+#define RANGE_CHUNK_SIZE (8 * 1024 * 1024)
+
+#define BUFFER_SIZE (1024 * 1024)
+
+typedef enum {
+	COPY_DONE,
+	COPY_UNSUPPORTED,
+	COPY_FAILED
+} CopyResult;
+
+static void
+set_error_from_errno (GError    **error,
+		      int         errsv,
+		      const char *format)
+{
+	g_set_error (error, G_IO_ERROR,
+		     g_io_error_from_errno (errsv),
+		     format, g_strerror (errsv));
+}
+
+/* Shares the extents of the source on filesystems that can (btrfs, XFS
+ * with reflink, ...).  It either clones the whole file or nothing. */
+static CopyResult
+copy_clone (int in_fd,
+	    int out_fd)
+{
+#ifdef FICLONE
+	if (ioctl (out_fd, FICLONE, in_fd) == 0) {
+		return COPY_DONE;
+	}
+#endif
+
+	return COPY_UNSUPPORTED;
+}
+
+/* Lets the kernel copy without going through userspace, and the server
+ * do it for NFS 4.2 and SMB3. */
+static CopyResult
+copy_range (int                     in_fd,
+	    int                     out_fd,
+	    goffset                 size,
+	    goffset                *copied,
+	    GCancellable           *cancellable,
+	    GFileProgressCallback   progress_callback,
+	    gpointer                progress_callback_data,
+	    GError                **error)
+{
+#if HAVE_COPY_FILE_RANGE
+	ssize_t n;
+
+	for (;;) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			return COPY_FAILED;
+		}
+
+		n = copy_file_range (in_fd, NULL, out_fd, NULL, RANGE_CHUNK_SIZE, 0);
+
+		if (n < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR) {
+				continue;
+			}
+
+			/* Old kernels, copies across filesystems and
+			 * filesystems without support */
+			if (*copied == 0 &&
+			    (errsv == ENOSYS || errsv == EXDEV || errsv == EINVAL ||
+			     errsv == EOPNOTSUPP || errsv == EBADF || errsv == EPERM)) {
+				return COPY_UNSUPPORTED;
+			}
+
+			set_error_from_errno (error, errsv, _("Error copying file: %s"));
+			return COPY_FAILED;
+		}
+
+		if (n == 0) {
+			/* Some pseudo filesystems report 0 right away */
+			if (*copied == 0 && size > 0) {
+				return COPY_UNSUPPORTED;
+			}
+
+			return COPY_DONE;
+		}
+
+		*copied += n;
+
+		if (progress_callback) {
+			progress_callback (*copied, MAX (size, *copied), progress_callback_data);
+		}
+	}
+#else
+	return COPY_UNSUPPORTED;
+#endif
+}
+
+/* Continues from wherever copy_range() left the file offsets */
+static gboolean
+copy_buffer (int                     in_fd,
+	     int                     out_fd,
+	     goffset                 size,
+	     goffset                *copied,
+	     GCancellable           *cancellable,
+	     GFileProgressCallback   progress_callback,
+	     gpointer                progress_callback_data,
+	     GError                **error)
+{
+	char *buffer;
+	ssize_t n_read, n_written, pos;
+	gboolean res;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise (in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	buffer = g_malloc (BUFFER_SIZE);
+	res = TRUE;
+
+	while (res) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			res = FALSE;
+			break;
+		}
+
+		n_read = read (in_fd, buffer, BUFFER_SIZE);
+
+		if (n_read < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			set_error_from_errno (error, errno, _("Error reading from file: %s"));
+			res = FALSE;
+			break;
+		}
+
+		if (n_read == 0) {
+			break;
+		}
+
+		for (pos = 0; pos < n_read; pos += n_written) {
+			n_written = write (out_fd, buffer + pos, n_read - pos);
+
+			if (n_written < 0) {
+				if (errno == EINTR) {
+					n_written = 0;
+					continue;
+				}
+
+				set_error_from_errno (error, errno, _("Error writing to file: %s"));
+				res = FALSE;
+				break;
+			}
+		}
+
+		if (res) {
+			*copied += n_read;
+
+			if (progress_callback) {
+				progress_callback (*copied, MAX (size, *copied), progress_callback_data);
+			}
+		}
+	}
+
+	g_free (buffer);
+
+	return res;
+}
+
+gboolean
+nemo_local_copy_file (GFile                  *source,
+		      GFile                  *destination,
+		      GFileCopyFlags          flags,
+		      GCancellable           *cancellable,
+		      GFileProgressCallback   progress_callback,
+		      gpointer                progress_callback_data,
+		      GError                **error)
+{
+	char *source_path, *dest_path;
+	struct stat source_stat;
+	int in_fd, out_fd, open_flags;
+	goffset copied;
+	CopyResult result;
+	gboolean res;
+
+	source_path = NULL;
+	dest_path = NULL;
+	in_fd = -1;
+	out_fd = -1;
+
+	if (!g_file_is_native (source) ||
+	    !g_file_is_native (destination) ||
+	    (flags & G_FILE_COPY_BACKUP) != 0) {
+		goto fallback;
+	}
+
+	source_path = g_file_get_path (source);
+	dest_path = g_file_get_path (destination);
+
+	if (source_path == NULL || dest_path == NULL) {
+		goto fallback;
+	}
+
+	/* Look before opening, a FIFO would block the open */
+	if (((flags & G_FILE_COPY_NOFOLLOW_SYMLINKS) ?
+	     lstat (source_path, &source_stat) :
+	     stat (source_path, &source_stat)) != 0 ||
+	    !S_ISREG (source_stat.st_mode)) {
+		goto fallback;
+	}
+
+	open_flags = O_RDONLY | O_CLOEXEC;
+	if (flags & G_FILE_COPY_NOFOLLOW_SYMLINKS) {
+		open_flags |= O_NOFOLLOW;
+	}
+
+	in_fd = open (source_path, open_flags);
+	if (in_fd < 0 ||
+	    fstat (in_fd, &source_stat) != 0 ||
+	    !S_ISREG (source_stat.st_mode)) {
+		goto fallback;
+	}
+
+	/* Overwriting, and whatever error creating the file runs into,
+	 * is left to g_file_copy().  The mode is narrowed right away, the
+	 * exact one is set with the other attributes below. */
+	out_fd = open (dest_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+		       (flags & G_FILE_COPY_TARGET_DEFAULT_PERMS) ? 0666 : (source_stat.st_mode & 0777));
+	if (out_fd < 0) {
+		goto fallback;
+	}
+
+	copied = 0;
+	res = TRUE;
+
+	result = copy_clone (in_fd, out_fd);
+
+	if (result == COPY_DONE) {
+		copied = source_stat.st_size;
+
+		if (progress_callback) {
+			progress_callback (copied, copied, progress_callback_data);
+		}
+	} else {
+		result = copy_range (in_fd, out_fd, source_stat.st_size, &copied,
+				     cancellable, progress_callback, progress_callback_data,
+				     error);
+
+		if (result == COPY_UNSUPPORTED) {
+			res = copy_buffer (in_fd, out_fd, source_stat.st_size, &copied,
+					   cancellable, progress_callback, progress_callback_data,
+					   error);
+		} else {
+			res = (result == COPY_DONE);
+		}
+	}
+
+	close (in_fd);
+
+	/* NFS reports failed writes on close */
+	if (close (out_fd) != 0 && res) {
+		set_error_from_errno (error, errno, _("Error writing to file: %s"));
+		res = FALSE;
+	}
+
+	if (res) {
+		/* Ignore errors here, as g_file_copy() does */
+		g_file_copy_attributes (source, destination, flags, cancellable, NULL);
+	} else {
+		g_unlink (dest_path);
+	}
+
+	g_free (source_path);
+	g_free (dest_path);
+
+	return res;
+
+ fallback:
+	if (in_fd >= 0) {
+		close (in_fd);
+	}
+
+	g_free (source_path);
+	g_free (dest_path);
+
+	return g_file_copy (source, destination, flags, cancellable,
+			    progress_callback, progress_callback_data, error);
+}
@@ -0,0 +1,41 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-local-copy.h - copying local files with the kernel's help.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_LOCAL_COPY_H
+#define NEMO_LOCAL_COPY_H
+
+#include <gio/gio.h>
+
+/* A drop-in for g_file_copy().  A regular file copied between local
+ * paths to a destination that doesn't exist yet is cloned with FICLONE
+ * where the filesystem supports it, else copied with copy_file_range(),
+ * else through a large buffer.  Everything else, and every failure
+ * before the first byte is written, goes to g_file_copy() so the errors
+ * are the ones it would have given.
+ */
+gboolean nemo_local_copy_file (GFile                  *source,
+			       GFile                  *destination,
+			       GFileCopyFlags          flags,
+			       GCancellable           *cancellable,
+			       GFileProgressCallback   progress_callback,
+			       gpointer                progress_callback_data,
+			       GError                **error);
+
+#endif /* NEMO_LOCAL_COPY_H */
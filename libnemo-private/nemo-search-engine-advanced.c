@@ -22,6 +22,7 @@
 #include "nemo-directory.h"
 #include "nemo-file-utilities.h"
 #include "nemo-search-engine-advanced.h"
+#include "nemo-search-literal.h"
 #include "nemo-global-preferences.h"
 
 #include <limits.h>
@@ -43,6 +44,15 @@
 #define CONTENT_SEARCH_BATCH_SIZE 1
 #define SNIPPET_EXTEND_SIZE 100
 
+/* Content is matched one window at a time, so memory use doesn't depend on file size */
+#define CONTENT_WINDOW_SIZE (1024 * 1024)
+#define CONTENT_READ_CHUNK_SIZE (64 * 1024)
+
+#define SEARCH_MAX_WORKERS 16
+#define SEARCH_VISITED_SHARDS 16
+/* Idle workers re-check for cancellation at least this often */
+#define SEARCH_IDLE_WAIT_USEC (100 * G_TIME_SPAN_MILLISECOND)
+
 typedef struct {
     gchar *def_path;
     gchar *exec_format;
@@ -51,27 +61,54 @@ typedef struct {
     /* future? */
 } SearchHelper;
 
+typedef struct _SearchThreadData SearchThreadData;
+
+/* Each worker owns a deque of directories still to be visited.  The owner
+ * takes from the head, so a single worker walks the tree breadth-first like
+ * it always has; idle workers steal from the tail of someone else's deque.
+ * Hits are collected per worker and handed to the main loop without any
+ * shared lock. */
 typedef struct {
+    SearchThreadData *data;
+    guint index;
+
+    GMutex lock;
+    GQueue directories; /* GFiles */
+
+    gint n_processed_files;
+    GList *hit_list; // holds FileSearchResults
+} SearchWorker;
+
+struct _SearchThreadData {
 	NemoSearchEngineAdvanced *engine;
 	GCancellable *cancellable;
 
 	GList *mime_types;
 
-	GQueue *directories; /* GFiles */
+    SearchWorker *workers;
+    guint n_workers;
+
+    /* Directories queued or being visited - the walk is over when this drops to 0 */
+    gint pending_dirs;
+
+    GMutex idle_lock;
+    GCond idle_cond;
+    gint n_idle;
+
+    /* id::file strings, sharded by hash so workers rarely contend */
+    GHashTable *visited[SEARCH_VISITED_SHARDS];
+    GMutex visited_lock[SEARCH_VISITED_SHARDS];
 
-	GHashTable *visited;
     GHashTable *skip_folders;
 
-	gint n_processed_files;
     GRegex *content_re;
     GRegex *newline_re;
+    /* Set for plain-text content searches - windows without it are skipped without PCRE */
+    NemoSearchLiteral *content_literal;
 
     GRegex *filename_re;
     GPatternSpec *filename_glob_pattern;
 
-    GMutex hit_list_lock;
-    GList *hit_list; // holds FileSearchResults
-
     gboolean show_hidden;
     gboolean count_hits;
     gboolean recurse;
@@ -80,7 +117,7 @@ typedef struct {
     gboolean location_supports_content_search;
 
     GTimer *timer;
-} SearchThreadData;
+};
 
 struct NemoSearchEngineAdvancedDetails {
 	NemoQuery *query;
@@ -404,14 +441,18 @@ search_thread_data_new (NemoSearchEngineAdvanced *engine,
     SearchThreadData *data;
     char *uri;
     GFile *location;
-    gint i;
+    gint i, n_workers;
 
 	data = g_new0 (SearchThreadData, 1);
 
     data->show_hidden = nemo_query_get_show_hidden (query);
 	data->engine = engine;
-	data->directories = g_queue_new ();
-	data->visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (i = 0; i < SEARCH_VISITED_SHARDS; i++) {
+        data->visited[i] = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        g_mutex_init (&data->visited_lock[i]);
+    }
+
 	uri = nemo_query_get_location (query);
 	location = NULL;
 	if (uri != NULL) {
@@ -422,7 +463,35 @@ search_thread_data_new (NemoSearchEngineAdvanced *engine,
 	if (location == NULL) {
 		location = g_file_new_for_path ("/");
 	}
-	g_queue_push_tail (data->directories, location);
+
+    n_workers = g_settings_get_int (nemo_search_preferences, NEMO_PREFERENCES_SEARCH_WORKER_THREADS);
+
+    if (n_workers <= 0) {
+        n_workers = g_get_num_processors ();
+    }
+
+    /* Don't hammer remote servers with parallel enumerations */
+    if (!g_file_is_native (location)) {
+        n_workers = 1;
+    }
+
+    data->n_workers = CLAMP (n_workers, 1, SEARCH_MAX_WORKERS);
+    data->workers = g_new0 (SearchWorker, data->n_workers);
+
+    for (i = 0; i < (gint) data->n_workers; i++) {
+        data->workers[i].data = data;
+        data->workers[i].index = i;
+        g_mutex_init (&data->workers[i].lock);
+        g_queue_init (&data->workers[i].directories);
+    }
+
+    DEBUG ("Searching with %u worker thread(s)", data->n_workers);
+
+    g_mutex_init (&data->idle_lock);
+    g_cond_init (&data->idle_cond);
+
+    data->pending_dirs = 1;
+	g_queue_push_tail (&data->workers[0].directories, location);
 
     data->file_case_sensitive = nemo_query_get_file_case_sensitive (query);
     data->file_use_regex = nemo_query_get_use_file_regex (query);
@@ -489,8 +558,6 @@ search_thread_data_new (NemoSearchEngineAdvanced *engine,
 	data->cancellable = g_cancellable_new ();
     data->timer = g_timer_new ();
 
-    g_mutex_init (&data->hit_list_lock);
-
     if (nemo_query_has_content_pattern (query)) {
         data->content_re = nemo_search_engine_advanced_create_content_regex (query, &error);
 
@@ -504,6 +571,15 @@ search_thread_data_new (NemoSearchEngineAdvanced *engine,
             DEBUG ("regex is '%s'", g_regex_get_pattern (data->content_re));
         }
 
+        if (data->content_re != NULL && !nemo_query_get_use_content_regex (query)) {
+            g_autofree gchar *text = nemo_query_get_content_pattern (query);
+            g_autofree gchar *normalized = g_utf8_normalize (text, -1, G_NORMALIZE_NFD);
+
+            data->content_literal = nemo_search_literal_new (normalized,
+                                                             nemo_query_get_content_case_sensitive (query));
+            DEBUG ("literal fast path is %s", data->content_literal ? "enabled" : "not possible");
+        }
+
         data->newline_re = g_regex_new ("[\\n\\r]{2,}",
                                            G_REGEX_OPTIMIZE,
                                            0,
@@ -524,20 +600,36 @@ search_thread_data_new (NemoSearchEngineAdvanced *engine,
 static void
 search_thread_data_free (SearchThreadData *data)
 {
-	g_queue_foreach (data->directories,
-			 (GFunc)g_object_unref, NULL);
-	g_queue_free (data->directories);
-	g_hash_table_destroy (data->visited);
+    guint i;
+
+    for (i = 0; i < data->n_workers; i++) {
+        SearchWorker *worker = &data->workers[i];
+
+        g_queue_foreach (&worker->directories,
+                         (GFunc)g_object_unref, NULL);
+        g_queue_clear (&worker->directories);
+        g_list_free_full (worker->hit_list, (GDestroyNotify) file_search_result_free);
+        g_mutex_clear (&worker->lock);
+    }
+    g_free (data->workers);
+
+    for (i = 0; i < SEARCH_VISITED_SHARDS; i++) {
+        g_hash_table_destroy (data->visited[i]);
+        g_mutex_clear (&data->visited_lock[i]);
+    }
+
+    g_mutex_clear (&data->idle_lock);
+    g_cond_clear (&data->idle_cond);
+
     g_hash_table_destroy (data->skip_folders);
 	g_object_unref (data->cancellable);
 	g_list_free_full (data->mime_types, g_free);
-	g_list_free_full (data->hit_list, (GDestroyNotify) file_search_result_free);
     g_clear_pointer (&data->content_re, g_regex_unref);
     g_clear_pointer (&data->newline_re, g_regex_unref);
+    g_clear_pointer (&data->content_literal, nemo_search_literal_free);
     g_clear_pointer (&data->filename_re, g_regex_unref);
     g_clear_pointer (&data->filename_glob_pattern, g_pattern_spec_free);
     g_timer_destroy (data->timer);
-    g_mutex_clear (&data->hit_list_lock);
 
     g_free (data);
 }
@@ -588,21 +680,113 @@ search_thread_add_hits_idle (gpointer user_data)
 }
 
 static void
-send_batch (SearchThreadData *data)
+send_batch (SearchWorker *worker)
 {
 	SearchHits *hits;
 
-    g_mutex_lock (&data->hit_list_lock);
-	data->n_processed_files = 0;
+	worker->n_processed_files = 0;
 
-	if (data->hit_list) {
+	if (worker->hit_list) {
 		hits = g_new0 (SearchHits, 1);
-		hits->hit_list = data->hit_list;
-		hits->thread_data = data;
+		hits->hit_list = worker->hit_list;
+		hits->thread_data = worker->data;
 		g_idle_add (search_thread_add_hits_idle, hits);
 	}
-	data->hit_list = NULL;
-    g_mutex_unlock (&data->hit_list_lock);
+	worker->hit_list = NULL;
+}
+
+static gboolean
+search_thread_data_mark_visited (SearchThreadData *data,
+                                 const gchar      *id)
+{
+    guint shard;
+    gboolean added;
+
+    shard = g_str_hash (id) % SEARCH_VISITED_SHARDS;
+
+    g_mutex_lock (&data->visited_lock[shard]);
+
+    added = !g_hash_table_contains (data->visited[shard], id);
+
+    if (added) {
+        g_hash_table_add (data->visited[shard], g_strdup (id));
+    }
+
+    g_mutex_unlock (&data->visited_lock[shard]);
+
+    return added;
+}
+
+static void
+search_worker_push (SearchWorker *worker,
+                    GFile        *dir)
+{
+    SearchThreadData *data = worker->data;
+
+    g_atomic_int_inc (&data->pending_dirs);
+
+    g_mutex_lock (&worker->lock);
+    g_queue_push_tail (&worker->directories, dir);
+    g_mutex_unlock (&worker->lock);
+
+    /* An idle worker only sleeps after failing to steal while holding idle_lock,
+     * so taking it here can't miss a waiter that hasn't seen this directory. */
+    if (g_atomic_int_get (&data->n_idle) > 0) {
+        g_mutex_lock (&data->idle_lock);
+        g_cond_signal (&data->idle_cond);
+        g_mutex_unlock (&data->idle_lock);
+    }
+}
+
+static GFile *
+search_worker_steal (SearchWorker *worker)
+{
+    SearchThreadData *data = worker->data;
+    GFile *dir = NULL;
+    guint i;
+
+    for (i = 1; i < data->n_workers && dir == NULL; i++) {
+        SearchWorker *victim = &data->workers[(worker->index + i) % data->n_workers];
+
+        g_mutex_lock (&victim->lock);
+        dir = g_queue_pop_tail (&victim->directories);
+        g_mutex_unlock (&victim->lock);
+    }
+
+    return dir;
+}
+
+static GFile *
+search_worker_next_directory (SearchWorker *worker)
+{
+    SearchThreadData *data = worker->data;
+    GFile *dir;
+
+    g_mutex_lock (&worker->lock);
+    dir = g_queue_pop_head (&worker->directories);
+    g_mutex_unlock (&worker->lock);
+
+    if (dir != NULL || data->n_workers == 1) {
+        return dir;
+    }
+
+    g_mutex_lock (&data->idle_lock);
+    g_atomic_int_inc (&data->n_idle);
+
+    /* Only this worker pushes onto its own deque, so once it's empty all
+     * remaining work is in other deques or still being enumerated. */
+    while ((dir = search_worker_steal (worker)) == NULL &&
+           g_atomic_int_get (&data->pending_dirs) > 0 &&
+           !g_cancellable_is_cancelled (data->cancellable)) {
+        g_cond_wait_until (&data->idle_cond,
+                           &data->idle_lock,
+                           g_get_monotonic_time () + SEARCH_IDLE_WAIT_USEC);
+    }
+
+    g_atomic_int_add (&data->n_idle, -1);
+    g_mutex_unlock (&data->idle_lock);
+
+    return dir;
 }
 
 #define STD_ATTRIBUTES \
@@ -679,185 +863,270 @@ get_stream_from_helper (SearchHelper *helper,
     return stream;
 }
 
+/* Collapses runs of blank lines the way the whole text used to be, but only
+ * for the part of the file that ends up in the snippet. */
 static gchar *
-create_snippet (GMatchInfo  *match_info,
-                const gchar *contents,
-                gssize       total_length)
+escape_snippet_part (SearchThreadData *data,
+                     const gchar      *start,
+                     const gchar      *end)
 {
-    gint start_bytes, end_bytes;
-    gchar *snippet = NULL;
+    gchar *stripped, *escaped;
 
-    if (g_match_info_fetch_pos (match_info, 0, &start_bytes, &end_bytes) && start_bytes >= 0) {
-        GString *marked_up;
-        glong start, end, new_start, new_end;
-        gchar *matched_str, *start_substr, *end_substr, *start_escaped, *end_escaped;
+    stripped = NULL;
 
-        start = g_utf8_pointer_to_offset (contents, contents + start_bytes);
-        end = g_utf8_pointer_to_offset (contents, contents + end_bytes);
+    if (data->newline_re != NULL) {
+        stripped = g_regex_replace_literal (data->newline_re, start, end - start, 0, "\n", 0, NULL);
+    }
 
-        // Extend the snipped forwards and back a bit to give context.
-        new_start = MAX (0, start - SNIPPET_EXTEND_SIZE);
+    if (stripped == NULL) {
+        stripped = g_strndup (start, end - start);
+    }
 
-        // g_match_info_fetch_pos() can return an end_bytes that == total_length,
-        // maybe a utf-8 encoding issue - g_utf8_substring can't deal with this,
-        // so just clamp new_end to >= end.
-        new_end = MIN (end + SNIPPET_EXTEND_SIZE, MAX (end, total_length - 1));
+    escaped = g_markup_escape_text (stripped, -1);
+    g_free (stripped);
 
-        matched_str = g_match_info_fetch (match_info, 0);
+    return escaped;
+}
 
-        start_substr = g_utf8_substring (contents, new_start, start);
-        start_escaped = g_markup_escape_text (start_substr, -1);
-        g_free (start_substr);
+static gchar *
+create_snippet (SearchThreadData *data,
+                GMatchInfo       *match_info,
+                const gchar      *contents,
+                gsize             length)
+{
+    const gchar *match_start, *match_end, *snippet_start, *snippet_end, *prev;
+    gint start_bytes, end_bytes;
+    gchar *start_escaped, *matched_escaped, *end_escaped;
+    gchar *snippet;
+    gint i;
 
-        end_substr = g_utf8_substring (contents, end, new_end);
-        end_escaped = g_markup_escape_text (end_substr, -1);
-        g_free (end_substr);
+    if (!g_match_info_fetch_pos (match_info, 0, &start_bytes, &end_bytes) || start_bytes < 0) {
+        return NULL;
+    }
 
-        marked_up = g_string_new (NULL);
-        g_string_append (marked_up, start_escaped);
-        g_string_append (marked_up, "<b>");
-        g_string_append (marked_up, matched_str);
-        g_string_append (marked_up, "</b>");
-        g_string_append (marked_up, end_escaped);
+    match_start = contents + start_bytes;
+    match_end = contents + end_bytes;
 
-        g_free (start_escaped);
-        g_free (end_escaped);
-        g_free (matched_str);
+    // Extend the snippet forwards and back a bit to give context.
+    snippet_start = match_start;
 
-        snippet = g_string_free (marked_up, FALSE);
-    }
+    for (i = 0; i < SNIPPET_EXTEND_SIZE; i++) {
+        prev = g_utf8_find_prev_char (contents, snippet_start);
 
-    return snippet;
-}
+        if (prev == NULL) {
+            break;
+        }
 
-static gchar *
-load_contents (SearchThreadData *data,
-               GFile            *file,
-               SearchHelper     *helper,
-               GError          **error)
-{
-    // TODO: Use flock/mmap for local files?
-    GSubprocess *helper_proc;
-    GInputStream *stream = NULL;
-    GString *str;
+        snippet_start = prev;
+    }
 
-    helper_proc = NULL;
+    snippet_end = match_end;
 
-    if (helper != NULL) {
-        stream = get_stream_from_helper (helper, file, &helper_proc, error);
-    } else {
-        // text/plain
-        stream = G_INPUT_STREAM (g_file_read (file, data->cancellable, error));
+    for (i = 0; i < SNIPPET_EXTEND_SIZE && snippet_end < contents + length; i++) {
+        snippet_end = g_utf8_next_char (snippet_end);
     }
 
-    if (stream == NULL) {
-        return NULL;
-    }
+    snippet_end = MIN (snippet_end, contents + length);
 
-    str = g_string_new (NULL);
-    gssize len = 0;
+    start_escaped = escape_snippet_part (data, snippet_start, match_start);
+    matched_escaped = escape_snippet_part (data, match_start, match_end);
+    end_escaped = escape_snippet_part (data, match_end, snippet_end);
 
-    do {
-        gchar chunk[4096];
-        len = g_input_stream_read (stream, chunk, 4096, data->cancellable, error);
+    snippet = g_strconcat (start_escaped, "<b>", matched_escaped, "</b>", end_escaped, NULL);
 
-        if (len <= 0) {
-            break;
-        }
+    g_free (start_escaped);
+    g_free (matched_escaped);
+    g_free (end_escaped);
 
-        if (chunk != NULL) {
-            g_string_append_len (str, chunk, len);
-        }
-    } while (!g_cancellable_is_cancelled (data->cancellable));
+    return snippet;
+}
 
-    g_input_stream_close (stream,
-                          data->cancellable,
-                          *error == NULL ? error : NULL);
+/* Returns the length of the prefix of the window that can be searched now.
+ * Windows end after the last newline so a line is never split between two of
+ * them, unless a single line is longer than the whole window - then it's cut
+ * on a character boundary. */
+static gsize
+get_window_cut (const guint8 *bytes,
+                gsize         length)
+{
+    gsize cut;
 
-    // GSubprocess owns the input stream for its STDOUT, but we own it for the text/plain stream.
-    if (helper_proc != NULL) {
-        g_subprocess_wait (helper_proc,
-                           NULL,
-                           *error == NULL ? error : NULL);
-        g_object_unref (helper_proc);
-    } else {
-        g_object_unref (stream);
+    for (cut = length; cut > 0; cut--) {
+        if (bytes[cut - 1] == '\n') {
+            return cut;
+        }
+    }
+
+    for (cut = length - 1; cut > 0 && length - cut < 4; cut--) {
+        if ((bytes[cut] & 0xc0) != 0x80) {
+            return cut;
+        }
     }
 
-    return g_string_free (str, FALSE);
+    return length;
 }
 
-static void
-search_for_content_hits (SearchThreadData *data,
-                         GFile            *file,
-                         SearchHelper     *helper)
+/* Matches one window of the file in place, only making a copy when it has to
+ * be repaired into valid UTF-8. Returns TRUE once there's no point in reading
+ * any further. */
+static gboolean
+search_window (SearchThreadData  *data,
+               GFile             *file,
+               const gchar       *bytes,
+               gsize              length,
+               FileSearchResult **fsr)
 {
     GMatchInfo *match_info;
     GError *error;
-    gchar *contents = NULL;
-    gchar *stripped, *utf8;
+    const gchar *text, *candidate;
+    gchar *repaired;
+    gboolean done;
+    gint start_position;
 
     error = NULL;
+    repaired = NULL;
+    done = FALSE;
+    text = bytes;
+    start_position = 0;
 
-    contents = load_contents (data, file, helper, &error);
+    if (data->content_literal != NULL) {
+        candidate = nemo_search_literal_find (data->content_literal, bytes, length);
 
-    if (g_cancellable_is_cancelled (data->cancellable)) {
-        g_clear_error (&error);
-        g_free (contents);
-        return;
-    }
+        if (candidate == NULL) {
+            return FALSE;
+        }
 
-    if (error != NULL) {
-        gchar *uri = g_file_get_uri (file);
-        g_warning ("Could not load contents of '%s' during content search: %s", uri, error->message);
-        g_free (uri);
-        g_error_free (error);
-        g_free (contents);
-        return;
+        /* PCRE only has to confirm from here on and find the match positions */
+        start_position = candidate - bytes;
     }
 
-    utf8 = g_utf8_make_valid (contents, -1);
-    g_free (contents);
-
-    if (data->newline_re != NULL) {
-        stripped = g_regex_replace_literal (data->newline_re, (const gchar *) utf8, -1, 0, "\n", 0, NULL);
-    } else {
-        stripped = g_strdup ((const gchar *) utf8);
+    if (!g_utf8_validate (bytes, length, NULL)) {
+        repaired = g_utf8_make_valid (bytes, length);
+        text = repaired;
+        length = strlen (repaired);
+        start_position = 0;
     }
 
-    g_free (utf8);
-
-    FileSearchResult *fsr = NULL;
-
-    g_regex_match (data->content_re, stripped, 0, &match_info);
+    g_regex_match_full (data->content_re, text, length, start_position, 0, &match_info, NULL);
 
     while (g_match_info_matches (match_info) && !g_cancellable_is_cancelled (data->cancellable)) {
-        if (fsr == NULL) {
-            fsr = file_search_result_new (g_file_get_uri (file), create_snippet (match_info, stripped, g_utf8_strlen (stripped, -1)));
+        if (*fsr == NULL) {
+            *fsr = file_search_result_new (g_file_get_uri (file), create_snippet (data, match_info, text, length));
         }
 
         if (!data->count_hits) {
+            done = TRUE;
             break;
         }
 
-        file_search_result_add_hit (fsr);
+        file_search_result_add_hit (*fsr);
 
         if (!g_match_info_next (match_info, &error) && error) {
             g_warning ("Error iterating thru pattern matches (/%s/): code %d - %s",
                        g_regex_get_pattern (data->content_re), error->code, error->message);
             g_error_free (error);
+            done = TRUE;
             break;
         }
     }
 
     g_match_info_unref (match_info);
-    g_free (stripped);
+    g_free (repaired);
+
+    return done;
+}
+
+static FileSearchResult *
+search_for_content_hits (SearchThreadData *data,
+                         GFile            *file,
+                         SearchHelper     *helper)
+{
+    GSubprocess *helper_proc;
+    GInputStream *stream;
+    GByteArray *window;
+    FileSearchResult *fsr;
+    GError *error;
+    gboolean eof, done;
+
+    error = NULL;
+    fsr = NULL;
+    helper_proc = NULL;
+
+    if (helper != NULL) {
+        stream = get_stream_from_helper (helper, file, &helper_proc, &error);
+    } else {
+        // text/plain
+        stream = G_INPUT_STREAM (g_file_read (file, data->cancellable, &error));
+    }
+
+    if (stream != NULL) {
+        /* Only ever hold one window of the file (plus the partial line carried
+         * over from the previous one), however big the file is. */
+        window = g_byte_array_sized_new (CONTENT_WINDOW_SIZE + CONTENT_READ_CHUNK_SIZE);
+        eof = done = FALSE;
+
+        while (!eof && !done && !g_cancellable_is_cancelled (data->cancellable)) {
+            gsize cut;
+
+            while (window->len < CONTENT_WINDOW_SIZE) {
+                guint filled = window->len;
+                gssize len;
 
-    if (fsr != NULL) {
-        g_mutex_lock (&data->hit_list_lock);
-        data->hit_list = g_list_prepend (data->hit_list, fsr);
-        g_mutex_unlock (&data->hit_list_lock);
+                g_byte_array_set_size (window, filled + CONTENT_READ_CHUNK_SIZE);
+                len = g_input_stream_read (stream, window->data + filled, CONTENT_READ_CHUNK_SIZE,
+                                           data->cancellable, &error);
+                g_byte_array_set_size (window, filled + MAX (len, 0));
+
+                if (len <= 0) {
+                    eof = TRUE;
+                    break;
+                }
+            }
+
+            if (window->len == 0 || error != NULL) {
+                break;
+            }
+
+            cut = eof ? window->len : get_window_cut (window->data, window->len);
+            done = search_window (data, file, (const gchar *) window->data, cut, &fsr);
+
+            g_byte_array_remove_range (window, 0, cut);
+        }
+
+        g_byte_array_unref (window);
+
+        g_input_stream_close (stream,
+                              data->cancellable,
+                              error == NULL ? &error : NULL);
+
+        // GSubprocess owns the input stream for its STDOUT, but we own it for the text/plain stream.
+        // If we stopped reading early the helper gets EPIPE and exits.
+        if (helper_proc != NULL) {
+            g_subprocess_wait (helper_proc,
+                               NULL,
+                               error == NULL ? &error : NULL);
+            g_object_unref (helper_proc);
+        } else {
+            g_object_unref (stream);
+        }
     }
+
+    if (g_cancellable_is_cancelled (data->cancellable)) {
+        g_clear_error (&error);
+        g_clear_pointer (&fsr, file_search_result_free);
+        return NULL;
+    }
+
+    if (error != NULL) {
+        gchar *uri = g_file_get_uri (file);
+        g_warning ("Could not load contents of '%s' during content search: %s", uri, error->message);
+        g_free (uri);
+        g_error_free (error);
+        g_clear_pointer (&fsr, file_search_result_free);
+        return NULL;
+    }
+
+    return fsr;
 }
 
 static gboolean
@@ -919,8 +1188,9 @@ should_skip_child (SearchThreadData *data, GFileInfo *info, GFile *file, gboolea
 }
 
 static void
-visit_directory (GFile *dir, SearchThreadData *data)
+visit_directory (GFile *dir, SearchWorker *worker)
 {
+    SearchThreadData *data = worker->data;
 	GFileEnumerator *enumerator;
 	GFileInfo *info;
     GFile *child;
@@ -1030,43 +1300,37 @@ visit_directory (GFile *dir, SearchThreadData *data)
                         if (DEBUGGING) {
                             g_message ("Evaluating '%s'", g_file_peek_path (child));
                         }
-                        search_for_content_hits (data, child, helper);
+                        FileSearchResult *fsr;
+
+                        fsr = search_for_content_hits (data, child, helper);
+
+                        if (fsr != NULL) {
+                            worker->hit_list = g_list_prepend (worker->hit_list, fsr);
+                        }
                     }
                 }
             } else {
                 FileSearchResult *fsr = NULL;
 
                 fsr = file_search_result_new (g_file_get_uri (child), NULL);
-                g_mutex_lock (&data->hit_list_lock);
-                data->hit_list = g_list_prepend (data->hit_list, fsr);
-                g_mutex_unlock (&data->hit_list_lock);
+                worker->hit_list = g_list_prepend (worker->hit_list, fsr);
             }
         }
 
-		data->n_processed_files++;
+		worker->n_processed_files++;
 
-        if (data->n_processed_files > (data->content_re ? CONTENT_SEARCH_BATCH_SIZE :
-                                                        FILE_SEARCH_ONLY_BATCH_SIZE)) {
-            send_batch (data);
+        if (worker->n_processed_files > (data->content_re ? CONTENT_SEARCH_BATCH_SIZE :
+                                                          FILE_SEARCH_ONLY_BATCH_SIZE)) {
+            send_batch (worker);
         }
 
 		if (is_dir && data->recurse && !skip_child) {
-            gboolean visited;
             const char *id;
 
 			id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
-			visited = FALSE;
-			if (id) {
-				if (g_hash_table_lookup_extended (data->visited,
-								  id, NULL, NULL)) {
-					visited = TRUE;
-				} else {
-					g_hash_table_insert (data->visited, g_strdup (id), NULL);
-				}
-			}
 
-			if (!visited) {
-				g_queue_push_tail (data->directories, g_object_ref (child));
+			if (id == NULL || search_thread_data_mark_visited (data, id)) {
+				search_worker_push (worker, g_object_ref (child));
 			}
 		}
 
@@ -1079,33 +1343,69 @@ visit_directory (GFile *dir, SearchThreadData *data)
 }
 
 
+static gpointer
+search_worker_func (gpointer user_data)
+{
+    SearchWorker *worker;
+    SearchThreadData *data;
+    GFile *dir;
+
+    worker = user_data;
+    data = worker->data;
+
+    while (!g_cancellable_is_cancelled (data->cancellable) &&
+           (dir = search_worker_next_directory (worker)) != NULL) {
+
+        visit_directory (dir, worker);
+        g_object_unref (dir);
+
+        if (g_atomic_int_dec_and_test (&data->pending_dirs)) {
+            g_mutex_lock (&data->idle_lock);
+            g_cond_broadcast (&data->idle_cond);
+            g_mutex_unlock (&data->idle_lock);
+        }
+    }
+
+    send_batch (worker);
+
+    return NULL;
+}
+
 static gpointer
 search_thread_func (gpointer user_data)
 {
 	SearchThreadData *data;
 	GFile *dir;
 	GFileInfo *info;
+    GThread **threads;
 	const char *id;
+    guint i;
 	data = user_data;
 
 	/* Insert id for toplevel directory into visited */
-	dir = g_queue_peek_head (data->directories);
+	dir = g_queue_peek_head (&data->workers[0].directories);
 	info = g_file_query_info (dir, G_FILE_ATTRIBUTE_ID_FILE, 0, data->cancellable, NULL);
 	if (info) {
 		id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
 		if (id) {
-			g_hash_table_insert (data->visited, g_strdup (id), NULL);
+			search_thread_data_mark_visited (data, id);
 		}
 		g_object_unref (info);
 	}
 
-    while (!g_cancellable_is_cancelled (data->cancellable) &&
-           (dir = g_queue_pop_head (data->directories)) != NULL) {
+    threads = g_new0 (GThread *, data->n_workers);
 
-		visit_directory (dir, data);
-		g_object_unref (dir);
-	}
-	send_batch (data);
+    for (i = 1; i < data->n_workers; i++) {
+        threads[i] = g_thread_new ("nemo-search-worker", search_worker_func, &data->workers[i]);
+    }
+
+    search_worker_func (&data->workers[0]);
+
+    for (i = 1; i < data->n_workers; i++) {
+        g_thread_join (threads[i]);
+    }
+
+    g_free (threads);
 
 	g_idle_add (search_thread_done_idle, data);
 
@@ -0,0 +1,312 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-search-literal.c - fast scanning for plain-text content searches.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-search-literal.h"
+
+#include <string.h>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+/* What content search can't repair invalid UTF-8 into without changing results */
+#define UTF8_REPLACEMENT_CHARACTER "\xef\xbf\xbd"
+
+typedef const char * (* FindFunc) (const NemoSearchLiteral *literal,
+				   const guchar            *haystack,
+				   gsize                    haystack_length);
+
+/* Case-insensitive ASCII letters are stored lower case with 0x20 in
+ * fold: (byte | fold) == lower only holds for the two cases of the same
+ * letter, so one compare per byte handles both.
+ *
+ * bytes is the part of the text that is scanned for, starting offset
+ * bytes into it; text_length is the length of the whole text.
+ */
+struct NemoSearchLiteral {
+	guchar *bytes;
+	guchar *fold;
+	gsize length;
+	gsize offset;
+	gsize text_length;
+	FindFunc find;
+};
+
+static inline gboolean
+literal_matches_at (const NemoSearchLiteral *literal,
+		    const guchar            *h)
+{
+	gsize i;
+
+	for (i = 0; i < literal->length; i++) {
+		if ((h[i] | literal->fold[i]) != literal->bytes[i]) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static const char *
+find_scalar (const NemoSearchLiteral *literal,
+	     const guchar            *haystack,
+	     gsize                    haystack_length)
+{
+	const guchar *h, *last_start;
+
+	if (haystack_length < literal->length) {
+		return NULL;
+	}
+
+	last_start = haystack + haystack_length - literal->length;
+
+	if (literal->fold[0] == 0) {
+		h = haystack;
+
+		while (h <= last_start &&
+		       (h = memchr (h, literal->bytes[0], last_start - h + 1)) != NULL) {
+			if (literal_matches_at (literal, h)) {
+				return (const char *) h;
+			}
+
+			h++;
+		}
+
+		return NULL;
+	}
+
+	for (h = haystack; h <= last_start; h++) {
+		if ((h[0] | 0x20) == literal->bytes[0] && literal_matches_at (literal, h)) {
+			return (const char *) h;
+		}
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_X86_DISPATCH
+
+/* Compare blocks against the first and last byte of the literal at once
+ * and only verify positions where both agree.
+ */
+__attribute__ ((target ("sse2")))
+static const char *
+find_sse2 (const NemoSearchLiteral *literal,
+	   const guchar            *haystack,
+	   gsize                    haystack_length)
+{
+	const gsize n = literal->length;
+	const __m128i first = _mm_set1_epi8 ((char) literal->bytes[0]);
+	const __m128i first_fold = _mm_set1_epi8 ((char) literal->fold[0]);
+	const __m128i last = _mm_set1_epi8 ((char) literal->bytes[n - 1]);
+	const __m128i last_fold = _mm_set1_epi8 ((char) literal->fold[n - 1]);
+	gsize i;
+
+	for (i = 0; i + 16 + n - 1 <= haystack_length; i += 16) {
+		__m128i block_first, block_last;
+		guint mask;
+
+		block_first = _mm_or_si128 (_mm_loadu_si128 ((const __m128i *) (haystack + i)), first_fold);
+		block_last = _mm_or_si128 (_mm_loadu_si128 ((const __m128i *) (haystack + i + n - 1)), last_fold);
+
+		mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (first, block_first),
+							 _mm_cmpeq_epi8 (last, block_last)));
+
+		while (mask != 0) {
+			guint bit = __builtin_ctz (mask);
+
+			if (literal_matches_at (literal, haystack + i + bit)) {
+				return (const char *) (haystack + i + bit);
+			}
+
+			mask &= mask - 1;
+		}
+	}
+
+	return find_scalar (literal, haystack + i, haystack_length - i);
+}
+
+__attribute__ ((target ("avx2")))
+static const char *
+find_avx2 (const NemoSearchLiteral *literal,
+	   const guchar            *haystack,
+	   gsize                    haystack_length)
+{
+	const gsize n = literal->length;
+	const __m256i first = _mm256_set1_epi8 ((char) literal->bytes[0]);
+	const __m256i first_fold = _mm256_set1_epi8 ((char) literal->fold[0]);
+	const __m256i last = _mm256_set1_epi8 ((char) literal->bytes[n - 1]);
+	const __m256i last_fold = _mm256_set1_epi8 ((char) literal->fold[n - 1]);
+	gsize i;
+
+	for (i = 0; i + 32 + n - 1 <= haystack_length; i += 32) {
+		__m256i block_first, block_last;
+		guint mask;
+
+		block_first = _mm256_or_si256 (_mm256_loadu_si256 ((const __m256i *) (haystack + i)), first_fold);
+		block_last = _mm256_or_si256 (_mm256_loadu_si256 ((const __m256i *) (haystack + i + n - 1)), last_fold);
+
+		mask = (guint) _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (first, block_first),
+									_mm256_cmpeq_epi8 (last, block_last)));
+
+		while (mask != 0) {
+			guint bit = __builtin_ctz (mask);
+
+			if (literal_matches_at (literal, haystack + i + bit)) {
+				return (const char *) (haystack + i + bit);
+			}
+
+			mask &= mask - 1;
+		}
+	}
+
+	return find_sse2 (literal, haystack + i, haystack_length - i);
+}
+
+#endif /* HAVE_X86_DISPATCH */
+
+static FindFunc
+choose_find_func (void)
+{
+#ifdef HAVE_X86_DISPATCH
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("avx2")) {
+		return find_avx2;
+	}
+
+	if (__builtin_cpu_supports ("sse2")) {
+		return find_sse2;
+	}
+#endif
+
+	return find_scalar;
+}
+
+/* Can @c be compared byte-wise when ignoring case?  Non-ASCII
+ * characters can't, and PCRE also folds 'k' and 's' to KELVIN SIGN and
+ * LATIN SMALL LETTER LONG S. */
+static gboolean
+is_foldable (guchar c)
+{
+	c = g_ascii_tolower (c);
+
+	return c < 0x80 && c != 'k' && c != 's';
+}
+
+NemoSearchLiteral *
+nemo_search_literal_new (const char *text,
+			 gboolean    case_sensitive)
+{
+	NemoSearchLiteral *literal;
+	gsize text_length, offset, length, start, i;
+
+	text_length = strlen (text);
+
+	if (text_length == 0 || strstr (text, UTF8_REPLACEMENT_CHARACTER) != NULL) {
+		return NULL;
+	}
+
+	if (case_sensitive) {
+		offset = 0;
+		length = text_length;
+	} else {
+		/* Scan for the longest run that can be compared byte-wise */
+		offset = 0;
+		length = 0;
+
+		for (start = 0; start < text_length; start = i + 1) {
+			for (i = start; i < text_length && is_foldable (text[i]); i++);
+
+			if (i - start > length) {
+				offset = start;
+				length = i - start;
+			}
+		}
+
+		if (length == 0) {
+			return NULL;
+		}
+	}
+
+	literal = g_new0 (NemoSearchLiteral, 1);
+	literal->bytes = (guchar *) g_strndup (text + offset, length);
+	literal->fold = g_new0 (guchar, length);
+	literal->length = length;
+	literal->offset = offset;
+	literal->text_length = text_length;
+
+	if (!case_sensitive) {
+		for (i = 0; i < length; i++) {
+			if (g_ascii_isalpha (literal->bytes[i])) {
+				literal->bytes[i] = g_ascii_tolower (literal->bytes[i]);
+				literal->fold[i] = 0x20;
+			}
+		}
+	}
+
+	literal->find = choose_find_func ();
+
+	return literal;
+}
+
+gboolean
+nemo_search_literal_is_exact (const NemoSearchLiteral *literal)
+{
+	return literal->length == literal->text_length;
+}
+
+void
+nemo_search_literal_free (NemoSearchLiteral *literal)
+{
+	g_free (literal->bytes);
+	g_free (literal->fold);
+	g_free (literal);
+}
+
+const char *
+nemo_search_literal_find (const NemoSearchLiteral *literal,
+			  const char              *haystack,
+			  gsize                    haystack_length)
+{
+	const char *hit, *start;
+	gsize before;
+
+	hit = literal->find (literal, (const guchar *) haystack, haystack_length);
+
+	if (hit == NULL || nemo_search_literal_is_exact (literal)) {
+		return hit;
+	}
+
+	/* What comes before the run can match text of a different length,
+	 * like 'k' matching the three bytes of KELVIN SIGN, but no character
+	 * is longer than four bytes */
+	before = MIN (literal->offset * 4, (gsize) (hit - haystack));
+	start = hit - before;
+
+	/* which can be the middle of a character, where PCRE can't start */
+	while (start > haystack && ((guchar) *start & 0xc0) == 0x80) {
+		start--;
+	}
+
+	return start;
+}
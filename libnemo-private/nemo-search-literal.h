@@ -0,0 +1,50 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-search-literal.h - fast scanning for plain-text content searches.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_SEARCH_LITERAL_H
+#define NEMO_SEARCH_LITERAL_H
+
+#include <glib.h>
+
+typedef struct NemoSearchLiteral NemoSearchLiteral;
+
+/* Compile @text (UTF-8) for scanning.  Case-insensitive searches only
+ * scan for the longest run of ASCII text without letters that have
+ * non-ASCII case variants ('k' and 's'), so they only find where the
+ * text could be.  Returns NULL when there is no such run.
+ */
+NemoSearchLiteral * nemo_search_literal_new      (const char              *text,
+						  gboolean                 case_sensitive);
+void                nemo_search_literal_free     (NemoSearchLiteral       *literal);
+
+/* TRUE if nemo_search_literal_find() only returns real occurrences */
+gboolean            nemo_search_literal_is_exact (const NemoSearchLiteral *literal);
+
+/* The first position in @haystack the text could start at, or NULL if
+ * it doesn't occur.  Every occurrence is at or after the returned
+ * position, which is on a character boundary.  Uses AVX2 or SSE2 when
+ * the CPU has them.  Read-only, so one literal can be shared by several
+ * threads.
+ */
+const char *        nemo_search_literal_find     (const NemoSearchLiteral *literal,
+						  const char              *haystack,
+						  gsize                    haystack_length);
+
+#endif /* NEMO_SEARCH_LITERAL_H */
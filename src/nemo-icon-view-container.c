@@ -68,9 +68,6 @@ static void find_empty_location (NemoIconContainer *container,
                                  int *x,
                                  int *y);
 
-/* Function to check if icon should be visible in layout based on filter status */
-static gboolean icon_should_be_visible_in_layout (NemoIcon *icon);
-
 G_DEFINE_TYPE (NemoIconViewContainer, nemo_icon_view_container, NEMO_TYPE_ICON_CONTAINER);
 
 static GQuark attribute_none_q;
@@ -645,6 +642,10 @@ lay_down_one_line (NemoIconContainer *container,
     for (p = line_start; p != line_end; p = p->next) {
         icon = p->data;
 
+        if (icon->is_filtered_out) {
+            continue;
+        }
+
         position = &g_array_index (positions, NemoCanvasRects, i++);
 
         if (container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
@@ -689,6 +690,10 @@ lay_down_one_column (NemoIconContainer *container,
     for (p = line_start; p != line_end; p = p->next) {
         icon = p->data;
 
+        if (icon->is_filtered_out) {
+            continue;
+        }
+
         position = &g_array_index (positions, NemoCanvasRects, i++);
 
         nemo_icon_container_icon_set_position
@@ -716,7 +721,6 @@ lay_down_icons_horizontal (NemoIconContainer *container,
     double canvas_width, y;
     GArray *positions;
     NemoCanvasRects *position;
-    EelDRect bounds;
     EelDRect icon_bounds;
     EelDRect text_bounds;
     double line_width;
@@ -731,44 +735,11 @@ lay_down_icons_horizontal (NemoIconContainer *container,
     GtkAllocation allocation;
     gint icon_size, text_size, use_size;
 
-    // --- BEGIN MODIFICATION ---
-    GList *icons_to_layout;
-    GList *allocated_visible_icons_list = NULL;
-    NemoWindow *window = nemo_view_get_nemo_window(NEMO_VIEW(get_icon_view(container)));
-
-    if (window && window->details->filter_text && window->details->filter_text[0] != '\0') {
-        // Filter is active, build the filtered list
-        GList *p_filter;
-        NemoIcon *icon_filter;
-        for (p_filter = icons; p_filter != NULL; p_filter = p_filter->next) {
-            icon_filter = p_filter->data;
-            if (icon_should_be_visible_in_layout(icon_filter)) {
-                allocated_visible_icons_list = g_list_append(allocated_visible_icons_list, icon_filter);
-            }
-        }
-        if (allocated_visible_icons_list == NULL && icons != NULL) {
-             // No icons visible after filtering, but original list was not empty
-             return;
-        }
-        icons_to_layout = allocated_visible_icons_list;
-    } else {
-        // No filter active, or window context not available
-        icons_to_layout = icons;
-    }
+    g_assert (NEMO_IS_ICON_CONTAINER (container));
 
-    /* If there are no icons to lay out, return early */
-    if (icons_to_layout == NULL) {
-        if (allocated_visible_icons_list != NULL) {
-             g_list_free(allocated_visible_icons_list); // Free the list structure, not the data
-        }
+    if (icons == NULL) {
         return;
     }
-    // --- END MODIFICATION ---
-
-
-    g_assert (NEMO_IS_ICON_CONTAINER (container));
-
-    // The original: if (icons == NULL) return; is now covered by icons_to_layout == NULL check.
 
     positions = g_array_new (FALSE, FALSE, sizeof (NemoCanvasRects));
     gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
@@ -786,17 +757,17 @@ lay_down_icons_horizontal (NemoIconContainer *container,
     icon_size = nemo_get_icon_size_for_zoom_level (container->details->zoom_level);
     text_size = nemo_get_icon_text_width_for_zoom_level (container->details->zoom_level);
 
-    // Original filtering loop is removed.
-    // The subsequent logic now uses icons_to_layout.
-
     use_size = MAX (icon_size, text_size) + 15;
     icon_size /= ppu;
     if (container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
         /* Would it be worth caching these bounds for the next loop? */
-        // Use icons_to_layout here
-        for (p = icons_to_layout; p != NULL; p = p->next) {
+        for (p = icons; p != NULL; p = p->next) {
             icon = p->data;
 
+            if (icon->is_filtered_out) {
+                continue;
+            }
+
             icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
             max_icon_width = MAX (max_icon_width, ceil (icon_bounds.x1 - icon_bounds.x0));
 
@@ -814,24 +785,28 @@ lay_down_icons_horizontal (NemoIconContainer *container,
     }
 
     line_width = container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE ? column_gap : 0;
-    // Use icons_to_layout here
-    line_start = icons_to_layout;
+    /* Lines start at the first icon the filter leaves visible */
+    line_start = NULL;
     y = start_y + row_gap;
     i = 0;
 
-    // Use icons_to_layout here
-    for (p = icons_to_layout; p != NULL; p = p->next) {
+    for (p = icons; p != NULL; p = p->next) {
         icon = p->data;
 
+        if (icon->is_filtered_out) {
+            continue;
+        }
+
+        if (line_start == NULL) {
+            line_start = p;
+        }
+
         if (container->details->fixed_text_height == -1) {
             container->details->fixed_text_height = nemo_icon_canvas_item_get_fixed_text_height_for_layout (icon->item) / ppu;
         }
 
-        /* Assume it's only one level hierarchy to avoid costly affine calculations */
-        nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
-                                 &bounds.x0, &bounds.y0,
-                                 &bounds.x1, &bounds.y1);
-
+        /* Only the icon itself matters here; every label gets the same
+         * grid_width x fixed_text_height slot, so nothing is measured. */
         icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
         icon_width = grid_width;
 
@@ -888,13 +863,6 @@ lay_down_icons_horizontal (NemoIconContainer *container,
     }
 
     g_array_free (positions, TRUE);
-
-    // --- BEGIN MODIFICATION ---
-    // Free the temporary list if it was created
-    if (allocated_visible_icons_list != NULL) {
-        g_list_free(allocated_visible_icons_list); // Free the list structure, not the data
-    }
-    // --- END MODIFICATION ---
 }
 
 /* column-wise layout. At the moment, this only works with label-beside-icon (used by "Compact View"). */
@@ -929,44 +897,12 @@ lay_down_icons_vertical (NemoIconContainer *container,
     int height;
     int i;
 
-    // --- BEGIN MODIFICATION ---
-    GList *icons_to_layout;
-    GList *allocated_visible_icons_list = NULL;
-    NemoWindow *window = nemo_view_get_nemo_window(NEMO_VIEW(get_icon_view(container)));
-
-    if (window && window->details->filter_text && window->details->filter_text[0] != '\0') {
-        // Filter is active, build the filtered list
-        GList *p_filter;
-        NemoIcon *icon_filter;
-        for (p_filter = icons; p_filter != NULL; p_filter = p_filter->next) {
-            icon_filter = p_filter->data;
-            if (icon_should_be_visible_in_layout(icon_filter)) {
-                allocated_visible_icons_list = g_list_append(allocated_visible_icons_list, icon_filter);
-            }
-        }
-        if (allocated_visible_icons_list == NULL && icons != NULL) {
-             // No icons visible after filtering, but original list was not empty
-             return;
-        }
-        icons_to_layout = allocated_visible_icons_list;
-    } else {
-        // No filter active, or window context not available
-        icons_to_layout = icons;
-    }
-
-    /* If there are no icons to lay out, return early */
-    if (icons_to_layout == NULL) {
-        if (allocated_visible_icons_list != NULL) {
-             g_list_free(allocated_visible_icons_list); // Free the list structure, not the data
-        }
-        return;
-    }
-    // --- END MODIFICATION ---
-
     g_assert (NEMO_IS_ICON_CONTAINER (container));
     g_assert (container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE);
 
-    // Original: if (icons == NULL) return; is now covered by icons_to_layout == NULL check.
+    if (icons == NULL) {
+        return;
+    }
 
     ppu = EEL_CANVAS (container)->pixels_per_unit;
     gap = floor (ICON_TEXT_GAP / ppu);
@@ -981,15 +917,11 @@ lay_down_icons_vertical (NemoIconContainer *container,
     max_icon_height = max_text_height = 0.0;
     max_bounds_height = 0.0;
 
-    // Use icons_to_layout here
-    get_max_icon_dimensions (icons_to_layout, NULL,
+    get_max_icon_dimensions (icons, NULL,
                  &max_icon_width, &max_icon_height,
                  &max_text_width, &max_text_height,
                  &max_bounds_height);
 
-    // Original filtering loop is removed.
-    // The subsequent logic now uses icons_to_layout.
-
     max_width = max_icon_width + max_text_width;
     max_height = MAX (max_icon_height, max_text_height);
     max_height_with_borders = gap + max_height;
@@ -997,17 +929,24 @@ lay_down_icons_vertical (NemoIconContainer *container,
     max_bounds_height_with_borders = gap + max_bounds_height;
 
     line_height = gap;
-    // Use icons_to_layout here
-    line_start = icons_to_layout;
+    /* Columns start at the first icon the filter leaves visible */
+    line_start = NULL;
     x = 0;
     i = 0;
 
     max_width_in_column = 0.0;
 
-    // Use icons_to_layout here
-    for (p = icons_to_layout; p != NULL; p = p->next) {
+    for (p = icons; p != NULL; p = p->next) {
         icon = p->data;
 
+        if (icon->is_filtered_out) {
+            continue;
+        }
+
+        if (line_start == NULL) {
+            line_start = p;
+        }
+
         /* If this icon doesn't fit, it's time to lay out the column that's queued up. */
 
         /* We use the bounds height here, since for wrapping we also want to consider
@@ -1075,13 +1014,6 @@ lay_down_icons_vertical (NemoIconContainer *container,
     }
 
     g_array_free (positions, TRUE);
-
-    // --- BEGIN MODIFICATION ---
-    // Free the temporary list if it was created
-    if (allocated_visible_icons_list != NULL) {
-        g_list_free(allocated_visible_icons_list); // Free the list structure, not the data
-    }
-    // --- END MODIFICATION ---
 }
 
 static void
@@ -1291,7 +1223,7 @@ nemo_icon_view_container_lay_down_icons (NemoIconContainer *container, GList *ic
 
 
 static void
-get_max_icon_dimensions (GList *icon_start, // This will be the full list of icons
+get_max_icon_dimensions (GList *icon_start,
                          GList *icon_end,
                          double *max_icon_width,
                          double *max_icon_height,
@@ -1312,11 +1244,9 @@ get_max_icon_dimensions (GList *icon_start, // This will be the full list of ico
     for (p = icon_start; p != icon_end; p = p->next) {
         icon = p->data;
 
-        // --- BEGIN MODIFICATION ---
-        if (!icon_should_be_visible_in_layout(icon)) { // Respect the "filtered-out" state
+        if (icon->is_filtered_out) {
             continue;
         }
-        // --- END MODIFICATION ---
 
         icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
         *max_icon_width = MAX (*max_icon_width, ceil (icon_bounds.x1 - icon_bounds.x0));
@@ -2295,18 +2225,3 @@ nemo_icon_view_container_set_sort_desktop (NemoIconViewContainer *container,
 {
 	container->sort_for_desktop = desktop;
 }
-
-/* Check if an icon should be included in layout based on its filtered state */
-static gboolean
-icon_should_be_visible_in_layout (NemoIcon *icon)
-{
-    /* Check if the icon has been filtered out */
-    gpointer filtered_data = g_object_get_data(G_OBJECT(icon->item), "filtered-out");
-    gboolean is_filtered = (filtered_data != NULL && GPOINTER_TO_INT(filtered_data));
-    
-    /* We simply return whether the icon should be visible or not.
-     * The actual hiding/showing is handled when the filtered-out flag is set
-     * in nemo-window.c's set_icon_filtered_state function
-     */
-    return !is_filtered;
-}
@@ -1776,6 +1776,25 @@ compare_files (NemoView   *icon_view,
 	return nemo_icon_view_compare_files ((NemoIconView *)icon_view, a, b);
 }
 
+static void
+sort_files (NemoView  *view,
+	    NemoFile **files,
+	    guint      n_files,
+	    guint     *order)
+{
+	NemoIconView *icon_view;
+
+	icon_view = NEMO_ICON_VIEW (view);
+
+	nemo_file_sort_for_sort (files, n_files,
+				 icon_view->details->sort->sort_type,
+				 nemo_view_should_sort_directories_first (view),
+				 nemo_view_should_sort_favorites_first (view),
+				 icon_view->details->sort_reversed,
+				 NULL,
+				 order);
+}
+
 static void
 nemo_icon_view_screen_changed (GtkWidget *widget,
 				   GdkScreen *previous_screen)
@@ -2722,6 +2741,7 @@ nemo_icon_view_class_init (NemoIconViewClass *klass)
 	nemo_view_class->set_selection = nemo_icon_view_set_selection;
 	nemo_view_class->invert_selection = nemo_icon_view_invert_selection;
 	nemo_view_class->compare_files = compare_files;
+	nemo_view_class->sort_files = sort_files;
 	nemo_view_class->zoom_to_level = nemo_icon_view_zoom_to_level;
 	nemo_view_class->get_zoom_level = nemo_icon_view_get_zoom_level;
         nemo_view_class->click_policy_changed = nemo_icon_view_click_policy_changed;
@@ -53,6 +53,9 @@ static GQuark attribute_name_q,
 /* msec delay after Loading... dummy row turns into (empty) */
 #define LOADING_TO_EMPTY_DELAY 100
 
+/* Rendered icons kept around for repaints, a few screens worth */
+#define RENDERED_ICON_CACHE_SIZE 512
+
 static guint list_model_signals[LAST_SIGNAL] = { 0 };
 
 static int nemo_list_model_file_entry_compare_func (gconstpointer a,
@@ -85,8 +88,42 @@ struct NemoListModelDetails {
 
 	GList *highlight_files;
     gboolean temp_unsorted;
+
+	/* Top level entries hidden by the filter.  They keep their
+	 * GSequenceIter (and their top_reverse_map entry) while parked
+	 * here, so hiding and showing a row never reallocates it. */
+	GSequence *filtered_files;
+	NemoListModelFilterFunc filter_func;
+	gpointer filter_data;
+	GDestroyNotify filter_data_destroy;
+	gboolean sort_by_filter_score;
+	/* bumped by every filter pass, see FileEntry.filter_stamp */
+	guint filter_stamp;
+
+	/* RenderedIconKey -> RenderedIcon, most recently used first in
+	 * rendered_icon_lru */
+	GHashTable *rendered_icons;
+	GQueue rendered_icon_lru;
 };
 
+/* Everything the icon column's surface for a row depends on, apart from
+ * the state of the files themselves.  Those drop their rendered icons
+ * when they change. */
+typedef struct {
+	NemoFile *file;
+	NemoFile *parent_file;
+	int icon_size;
+	int icon_scale;
+	NemoFileIconFlags flags;
+	gboolean highlighted;
+} RenderedIconKey;
+
+typedef struct {
+	RenderedIconKey key;
+	cairo_surface_t *surface;
+	GList link;
+} RenderedIcon;
+
 typedef struct {
 	NemoListModel *model;
 
@@ -105,6 +142,8 @@ struct FileEntry {
 	guint loaded : 1;
     guint expanding : 1;
     guint ok_to_show_thumb : 1;
+	int filter_score;
+	guint filter_stamp;	/* pass that produced filter_score */
 };
 
 G_DEFINE_TYPE_WITH_CODE (NemoListModel, nemo_list_model, G_TYPE_OBJECT,
@@ -268,6 +307,107 @@ nemo_list_model_get_icon_scale (NemoListModel *model)
    return retval;
 }
 
+static guint
+rendered_icon_key_hash (const RenderedIconKey *key)
+{
+	return g_direct_hash (key->file) ^
+		(g_direct_hash (key->parent_file) << 7) ^
+		(key->icon_size << 16) ^ (key->icon_scale << 24) ^
+		(key->flags << 8) ^ key->highlighted;
+}
+
+static gboolean
+rendered_icon_key_equal (const RenderedIconKey *a,
+			 const RenderedIconKey *b)
+{
+	return a->file == b->file &&
+		a->parent_file == b->parent_file &&
+		a->icon_size == b->icon_size &&
+		a->icon_scale == b->icon_scale &&
+		a->flags == b->flags &&
+		a->highlighted == b->highlighted;
+}
+
+static void
+rendered_icon_free (RenderedIcon *icon)
+{
+	/* The refs keep the files from being reused while they are keys */
+	nemo_file_unref (icon->key.file);
+	nemo_file_unref (icon->key.parent_file);
+	cairo_surface_destroy (icon->surface);
+	g_free (icon);
+}
+
+static cairo_surface_t *
+rendered_icon_cache_lookup (NemoListModel *model, const RenderedIconKey *key)
+{
+	RenderedIcon *icon;
+
+	icon = g_hash_table_lookup (model->details->rendered_icons, key);
+	if (icon == NULL) {
+		return NULL;
+	}
+
+	g_queue_unlink (&model->details->rendered_icon_lru, &icon->link);
+	g_queue_push_head_link (&model->details->rendered_icon_lru, &icon->link);
+
+	return icon->surface;
+}
+
+static void
+rendered_icon_cache_remove (NemoListModel *model, RenderedIcon *icon)
+{
+	g_queue_unlink (&model->details->rendered_icon_lru, &icon->link);
+	g_hash_table_remove (model->details->rendered_icons, &icon->key);
+}
+
+static void
+rendered_icon_cache_insert (NemoListModel *model, const RenderedIconKey *key,
+			    cairo_surface_t *surface)
+{
+	RenderedIcon *icon;
+
+	if (model->details->rendered_icon_lru.length >= RENDERED_ICON_CACHE_SIZE) {
+		rendered_icon_cache_remove (model, model->details->rendered_icon_lru.tail->data);
+	}
+
+	icon = g_new0 (RenderedIcon, 1);
+	icon->key = *key;
+	nemo_file_ref (icon->key.file);
+	nemo_file_ref (icon->key.parent_file);
+	icon->surface = cairo_surface_reference (surface);
+	icon->link.data = icon;
+
+	g_hash_table_insert (model->details->rendered_icons, &icon->key, icon);
+	g_queue_push_head_link (&model->details->rendered_icon_lru, &icon->link);
+}
+
+/* Drop what was rendered for @file, or for its children, whose emblems
+ * depend on it */
+static void
+rendered_icon_cache_invalidate_file (NemoListModel *model, NemoFile *file)
+{
+	GList *l, *next;
+	RenderedIcon *icon;
+
+	for (l = model->details->rendered_icon_lru.head; l != NULL; l = next) {
+		next = l->next;
+		icon = l->data;
+
+		if (icon->key.file == file || icon->key.parent_file == file) {
+			rendered_icon_cache_remove (model, icon);
+		}
+	}
+}
+
+static void
+rendered_icon_cache_clear (NemoListModel *model)
+{
+	while (model->details->rendered_icon_lru.head != NULL) {
+		rendered_icon_cache_remove (model, model->details->rendered_icon_lru.head->data);
+	}
+}
+
 static void
 nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int column, GValue *value)
 {
@@ -314,6 +454,7 @@ nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int colu
             GdkPixbuf *icon, *rendered_icon;
             NemoIconInfo *icon_info;
             GList *emblem_icons, *l;
+            RenderedIconKey key;
 
 			zoom_level = nemo_list_model_get_zoom_level_from_column_id (column);
 			icon_size = nemo_get_list_icon_size_for_zoom_level (zoom_level);
@@ -344,6 +485,21 @@ nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int colu
 				}
 			}
 
+            key.file = file;
+            key.parent_file = parent_file;
+            key.icon_size = icon_size;
+            key.icon_scale = icon_scale;
+            key.flags = flags;
+            key.highlighted = model->details->highlight_files != NULL &&
+                              g_list_find_custom (model->details->highlight_files,
+                                                  file, (GCompareFunc) nemo_file_compare_location) != NULL;
+
+            surface = rendered_icon_cache_lookup (model, &key);
+            if (surface != NULL) {
+                g_value_set_boxed (value, surface);
+                break;
+            }
+
             icon_info = nemo_file_get_icon (file, icon_size, 0, icon_scale, flags);
             emblem_icons = nemo_file_get_emblem_icons (file, parent_file);
 
@@ -392,10 +548,7 @@ nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int colu
 
 			nemo_icon_info_unref (icon_info);
 
-			if (model->details->highlight_files != NULL &&
-			    g_list_find_custom (model->details->highlight_files,
-			                        file, (GCompareFunc) nemo_file_compare_location))
-			{
+			if (key.highlighted) {
 				rendered_icon = eel_create_spotlight_pixbuf (icon);
 
 				if (rendered_icon != NULL) {
@@ -405,6 +558,7 @@ nemo_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int colu
 			}
 
             surface = gdk_cairo_surface_create_from_pixbuf (icon, icon_scale, NULL);
+            rendered_icon_cache_insert (model, &key, surface);
             g_value_take_boxed (value, surface);
 			g_object_unref (icon);
 		}
@@ -616,6 +770,27 @@ lookup_file (NemoListModel *model, NemoFile *file,
 	return ptr;
 }
 
+static gboolean
+file_entry_is_filtered (NemoListModel *model, FileEntry *file_entry)
+{
+	return file_entry->parent == NULL &&
+	       g_sequence_iter_get_sequence (file_entry->ptr) == model->details->filtered_files;
+}
+
+static int
+file_filter_score (NemoListModel *model, NemoFile *file)
+{
+	int score;
+
+	if (model->details->filter_func == NULL || file == NULL) {
+		return 0;
+	}
+
+	(* model->details->filter_func) (&file, 1, &score, model->details->filter_data);
+
+	return score;
+}
+
 
 struct GetIters {
 	NemoListModel *model;
@@ -630,7 +805,7 @@ dir_to_iters (struct GetIters *data,
 	GSequenceIter *ptr;
 
 	ptr = g_hash_table_lookup (reverse_map, data->file);
-	if (ptr) {
+	if (ptr && !file_entry_is_filtered (data->model, g_sequence_get (ptr))) {
 		GtkTreeIter *iter;
 		iter = g_new0 (GtkTreeIter, 1);
 		nemo_list_model_ptr_to_iter (data->model, ptr, iter);
@@ -696,7 +871,7 @@ nemo_list_model_get_tree_iter_from_file (NemoListModel *model, NemoFile *file,
 	GSequenceIter *ptr;
 
 	ptr = lookup_file (model, file, directory);
-	if (!ptr) {
+	if (!ptr || file_entry_is_filtered (model, g_sequence_get (ptr))) {
 		return FALSE;
 	}
 
@@ -721,6 +896,13 @@ nemo_list_model_file_entry_compare_func (gconstpointer a,
 	file_entry2 = (FileEntry *)b;
 
 	if (file_entry1->file != NULL && file_entry2->file != NULL) {
+		/* Ranked filter results go best match first, whatever the column */
+		if (model->details->sort_by_filter_score &&
+		    file_entry1->parent == NULL && file_entry2->parent == NULL &&
+		    file_entry1->filter_score != file_entry2->filter_score) {
+			return file_entry1->filter_score > file_entry2->filter_score ? -1 : 1;
+		}
+
 		result = nemo_file_compare_for_sort_by_attribute_q (file_entry1->file, file_entry2->file,
 									model->details->sort_attribute,
 									model->details->sort_directories_first,
@@ -753,13 +935,52 @@ nemo_list_model_compare_func (NemoListModel *model,
 	return result;
 }
 
+/* Bulk version of nemo_list_model_compare_func (), see
+ * nemo_file_sort_for_sort () */
+void
+nemo_list_model_sort_files (NemoListModel *model,
+			    NemoFile **files,
+			    guint n_files,
+			    guint *order)
+{
+	nemo_file_sort_for_sort_by_attribute_q (files, n_files,
+						model->details->sort_attribute,
+						model->details->sort_directories_first,
+						model->details->sort_favorites_first,
+						(model->details->order == GTK_SORT_DESCENDING),
+						model->details->view_dir,
+						order);
+}
+
+/* Ranked filter results go best match first, whatever the column.  The
+ * sort is stable, so within a rank the column order stays.
+ */
+static int
+compare_entries_by_filter_score (gconstpointer a,
+				 gconstpointer b,
+				 gpointer      user_data)
+{
+	FileEntry **entries = user_data;
+	FileEntry *file_entry1 = entries[*(const guint *) a];
+	FileEntry *file_entry2 = entries[*(const guint *) b];
+
+	if (file_entry1->filter_score != file_entry2->filter_score) {
+		return file_entry1->filter_score > file_entry2->filter_score ? -1 : 1;
+	}
+
+	return 0;
+}
+
 static void
 nemo_list_model_sort_file_entries (NemoListModel *model, GSequence *files, GtkTreePath *path)
 {
-	GSequenceIter **old_order;
+	GSequenceIter *ptr, *end;
 	GtkTreeIter iter;
+	FileEntry **entries;
+	NemoFile **sort_files;
+	guint *file_rows, *sort_order;
 	int *new_order;
-	int length;
+	int length, n_files, n_placeholders;
 	int i;
 	FileEntry *file_entry;
 	gboolean has_iter;
@@ -770,11 +991,19 @@ nemo_list_model_sort_file_entries (NemoListModel *model, GSequence *files, GtkTr
 		return;
 	}
 
-	/* generate old order of GSequenceIter's */
-	old_order = g_new (GSequenceIter *, length);
-	for (i = 0; i < length; ++i) {
-		GSequenceIter *ptr = g_sequence_get_iter_at_pos (files, i);
-
+	entries = g_new (FileEntry *, length);
+	sort_files = g_new (NemoFile *, length);
+	file_rows = g_new (guint, length);
+	new_order = g_new (int, length);
+	n_files = 0;
+	n_placeholders = 0;
+
+	/* Sort the children first, and collect the files sorting is about.
+	 * Placeholder rows (no file) always go first.
+	 * Note: new_order[newpos] = oldpos */
+	for (ptr = g_sequence_get_begin_iter (files), i = 0;
+	     !g_sequence_iter_is_end (ptr);
+	     ptr = g_sequence_iter_next (ptr), i++) {
 		file_entry = g_sequence_get (ptr);
 		if (file_entry->files != NULL) {
 			gtk_tree_path_append_index (path, i);
@@ -782,22 +1011,48 @@ nemo_list_model_sort_file_entries (NemoListModel *model, GSequence *files, GtkTr
 			gtk_tree_path_up (path);
 		}
 
-		old_order[i] = ptr;
+		entries[i] = file_entry;
+		if (file_entry->file != NULL) {
+			sort_files[n_files] = file_entry->file;
+			file_rows[n_files] = i;
+			n_files++;
+		} else {
+			new_order[n_placeholders++] = i;
+		}
 	}
 
-	/* sort */
-	g_sequence_sort (files, nemo_list_model_file_entry_compare_func, model);
+	/* Work out each file's sort key once and sort those, rather than
+	 * comparing files through nemo_file_compare_for_sort () */
+	sort_order = g_new (guint, n_files);
+	nemo_file_sort_for_sort_by_attribute_q (sort_files, n_files,
+						model->details->sort_attribute,
+						model->details->sort_directories_first,
+						model->details->sort_favorites_first,
+						(model->details->order == GTK_SORT_DESCENDING),
+						model->details->view_dir,
+						sort_order);
 
-	/* generate new order */
-	new_order = g_new (int, length);
-	/* Note: new_order[newpos] = oldpos */
-	for (i = 0; i < length; ++i) {
-		new_order[g_sequence_iter_get_position (old_order[i])] = i;
+	for (i = 0; i < n_files; i++) {
+		sort_order[i] = file_rows[sort_order[i]];
 	}
 
-	/* Let the world know about our new order */
+	if (model->details->sort_by_filter_score &&
+	    entries[0]->parent == NULL) {
+		g_qsort_with_data (sort_order, n_files, sizeof (guint),
+				   compare_entries_by_filter_score, entries);
+	}
 
-	g_assert (new_order != NULL);
+	for (i = 0; i < n_files; i++) {
+		new_order[n_placeholders + i] = sort_order[i];
+	}
+
+	/* Rebuild the sequence in the new order, the iters stay valid */
+	end = g_sequence_get_end_iter (files);
+	for (i = 0; i < length; i++) {
+		g_sequence_move (entries[new_order[i]]->ptr, end);
+	}
+
+	/* Let the world know about our new order */
 
 	has_iter = FALSE;
 	if (gtk_tree_path_get_depth (path) != 0) {
@@ -810,7 +1065,10 @@ nemo_list_model_sort_file_entries (NemoListModel *model, GSequence *files, GtkTr
 	gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model),
 				       path, has_iter ? &iter : NULL, new_order);
 
-	g_free (old_order);
+	g_free (entries);
+	g_free (sort_files);
+	g_free (file_rows);
+	g_free (sort_order);
 	g_free (new_order);
 }
 
@@ -973,17 +1231,27 @@ nemo_list_model_multi_drag_data_delete (EggTreeMultiDragSource *drag_source, GLi
 	return TRUE;
 }
 
-static void
-add_dummy_row (NemoListModel *model, FileEntry *parent_entry)
+static FileEntry *
+insert_dummy_entry (NemoListModel *model, FileEntry *parent_entry)
 {
 	FileEntry *dummy_file_entry;
-	GtkTreeIter iter;
-	GtkTreePath *path;
 
 	dummy_file_entry = g_new0 (FileEntry, 1);
 	dummy_file_entry->parent = parent_entry;
 	dummy_file_entry->ptr = g_sequence_insert_sorted (parent_entry->files, dummy_file_entry,
 							  nemo_list_model_file_entry_compare_func, model);
+
+	return dummy_file_entry;
+}
+
+static void
+add_dummy_row (NemoListModel *model, FileEntry *parent_entry)
+{
+	FileEntry *dummy_file_entry;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	dummy_file_entry = insert_dummy_entry (model, parent_entry);
 	iter.stamp = model->details->stamp;
 	iter.user_data = dummy_file_entry->ptr;
 
@@ -992,13 +1260,125 @@ add_dummy_row (NemoListModel *model, FileEntry *parent_entry)
 	gtk_tree_path_free (path);
 }
 
+static FileEntry *
+file_entry_new (NemoFile *file, FileEntry *parent_entry)
+{
+	FileEntry *file_entry;
+
+	file_entry = g_new0 (FileEntry, 1);
+	file_entry->file = nemo_file_ref (file);
+	file_entry->parent = parent_entry;
+	file_entry->subdirectory = NULL;
+	file_entry->files = NULL;
+    file_entry->ok_to_show_thumb =
+        nemo_file_get_load_deferred_attrs (file) == NEMO_FILE_LOAD_DEFERRED_ATTRS_PRELOAD;
+
+	return file_entry;
+}
+
+/* Directory rows start out with a dummy "loading" child, unless we know
+ * they're empty.  Without @announce nobody is listening, so the dummy
+ * goes in quietly.
+ */
+static void
+add_file_entry_children (NemoListModel *model, FileEntry *file_entry,
+			 GtkTreePath *path, GtkTreeIter *iter, gboolean announce)
+{
+	guint count;
+	gboolean got_count, unreadable;
+
+	if (!nemo_file_is_directory (file_entry->file)) {
+		return;
+	}
+
+	file_entry->files = g_sequence_new ((GDestroyNotify)file_entry_free);
+
+	got_count = nemo_file_get_directory_item_count (file_entry->file, &count, &unreadable);
+
+	if ((!got_count && !unreadable) || count > 0) {
+		if (announce) {
+			add_dummy_row (model, file_entry);
+			gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
+							      path, iter);
+		} else {
+			insert_dummy_entry (model, file_entry);
+		}
+	}
+}
+
+/* Park a top level entry with the other filtered rows, nobody gets told */
+static void
+park_filtered_file_entry (NemoListModel *model, FileEntry *file_entry)
+{
+	file_entry->ptr = g_sequence_append (model->details->filtered_files, file_entry);
+	g_hash_table_insert (model->details->top_reverse_map, file_entry->file, file_entry->ptr);
+
+	add_file_entry_children (model, file_entry, NULL, NULL, FALSE);
+}
+
+/* The first real child of an expanded directory takes over the row of
+ * the dummy "loading" entry. */
+static gboolean
+remove_loading_dummy (NemoListModel *model, FileEntry *parent_entry)
+{
+	GSequenceIter *dummy_ptr;
+	FileEntry *dummy_entry;
+
+	/* At this point we set loaded. Either we saw
+	 * "done" and ignored it waiting for this, or we do this
+	 * earlier, but then we replace the dummy row anyway,
+	 * so it doesn't matter */
+	parent_entry->loaded = 1;
+
+	if (g_sequence_get_length (parent_entry->files) != 1) {
+		return FALSE;
+	}
+
+	dummy_ptr = g_sequence_get_iter_at_pos (parent_entry->files, 0);
+	dummy_entry = g_sequence_get (dummy_ptr);
+	if (dummy_entry->file != NULL) {
+		return FALSE;
+	}
+
+	/* replace the dummy loading entry */
+	model->details->stamp++;
+	g_sequence_remove (dummy_ptr);
+
+	return TRUE;
+}
+
+static void
+file_entry_inserted (NemoListModel *model, FileEntry *file_entry,
+		     gboolean replace_dummy, gboolean announce)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	if (!announce) {
+		add_file_entry_children (model, file_entry, NULL, NULL, FALSE);
+		return;
+	}
+
+	iter.stamp = model->details->stamp;
+	iter.user_data = file_entry->ptr;
+
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), &iter);
+	if (replace_dummy) {
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+	} else {
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+	}
+
+	add_file_entry_children (model, file_entry, path, &iter, TRUE);
+
+	gtk_tree_path_free (path);
+}
+
 gboolean
 nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
 			      NemoDirectory *directory)
 {
-	GtkTreeIter iter;
-	GtkTreePath *path;
-	FileEntry *file_entry;
+	FileEntry *file_entry, *parent_entry;
 	GSequenceIter *ptr, *parent_ptr;
 	GSequence *files;
 	gboolean replace_dummy;
@@ -1007,50 +1387,31 @@ nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
 	parent_ptr = g_hash_table_lookup (model->details->directory_reverse_map,
 					  directory);
 	if (parent_ptr) {
-		file_entry = g_sequence_get (parent_ptr);
-		ptr = g_hash_table_lookup (file_entry->reverse_map, file);
+		parent_entry = g_sequence_get (parent_ptr);
+		parent_hash = parent_entry->reverse_map;
+		files = parent_entry->files;
 	} else {
-		file_entry = NULL;
-		ptr = g_hash_table_lookup (model->details->top_reverse_map, file);
+		parent_entry = NULL;
+		parent_hash = model->details->top_reverse_map;
+		files = model->details->files;
 	}
 
+	ptr = g_hash_table_lookup (parent_hash, file);
+
 	if (ptr != NULL) {
 		g_warning ("file already in tree (parent_ptr: %p)!!!\n", parent_ptr);
 		return FALSE;
 	}
 
-	file_entry = g_new0 (FileEntry, 1);
-	file_entry->file = nemo_file_ref (file);
-	file_entry->parent = NULL;
-	file_entry->subdirectory = NULL;
-	file_entry->files = NULL;
-    file_entry->ok_to_show_thumb =
-        nemo_file_get_load_deferred_attrs (file) == NEMO_FILE_LOAD_DEFERRED_ATTRS_PRELOAD;
-	files = model->details->files;
-	parent_hash = model->details->top_reverse_map;
+	file_entry = file_entry_new (file, parent_entry);
 
 	replace_dummy = FALSE;
 
-	if (parent_ptr != NULL) {
-		file_entry->parent = g_sequence_get (parent_ptr);
-		/* At this point we set loaded. Either we saw
-		 * "done" and ignored it waiting for this, or we do this
-		 * earlier, but then we replace the dummy row anyway,
-		 * so it doesn't matter */
-		file_entry->parent->loaded = 1;
-		parent_hash = file_entry->parent->reverse_map;
-		files = file_entry->parent->files;
-		if (g_sequence_get_length (files) == 1) {
-			GSequenceIter *dummy_ptr = g_sequence_get_iter_at_pos (files, 0);
-			FileEntry *dummy_entry = g_sequence_get (dummy_ptr);
-			if (dummy_entry->file == NULL) {
-				/* replace the dummy loading entry */
-				model->details->stamp++;
-				g_sequence_remove (dummy_ptr);
-
-				replace_dummy = TRUE;
-			}
-		}
+	if (parent_entry != NULL) {
+		replace_dummy = remove_loading_dummy (model, parent_entry);
+	} else if ((file_entry->filter_score = file_filter_score (model, file)) == NEMO_LIST_MODEL_FILTERED_OUT) {
+		park_filtered_file_entry (model, file_entry);
+		return TRUE;
 	}
 
 	if (model->details->temp_unsorted)
@@ -1061,34 +1422,141 @@ nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
 
 	g_hash_table_insert (parent_hash, file, file_entry->ptr);
 
-	iter.stamp = model->details->stamp;
-	iter.user_data = file_entry->ptr;
+	file_entry_inserted (model, file_entry, replace_dummy, TRUE);
 
-	path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), &iter);
-	if (replace_dummy) {
-		gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+	return TRUE;
+}
+
+/* Bulk version of nemo_list_model_add_file ().  The batch is sorted once
+ * through the precomputed sort keys and then merged into the rows that
+ * are already there, instead of a binary search with
+ * nemo_file_compare_for_sort () per file.  When nobody is connected to
+ * the model, e.g. because the view detached it while filling it, the
+ * row signals are skipped too.
+ */
+void
+nemo_list_model_add_files (NemoListModel *model, GList *files,
+			   NemoDirectory *directory)
+{
+	FileEntry *file_entry, *parent_entry;
+	FileEntry **entries, **sorted_entries;
+	NemoFile **sort_files;
+	GSequenceIter *ptr, *parent_ptr;
+	GSequence *sequence;
+	GHashTable *parent_hash;
+	GList *l;
+	guint *sort_order;
+	guint n_entries, n_rows, i;
+	gboolean replace_dummy, announce, merge;
+
+	parent_ptr = g_hash_table_lookup (model->details->directory_reverse_map,
+					  directory);
+	if (parent_ptr) {
+		parent_entry = g_sequence_get (parent_ptr);
+		parent_hash = parent_entry->reverse_map;
+		sequence = parent_entry->files;
 	} else {
-		gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+		parent_entry = NULL;
+		parent_hash = model->details->top_reverse_map;
+		sequence = model->details->files;
 	}
 
-    if (nemo_file_is_directory (file)) {
-        guint count;
-        gboolean got_count, unreadable;
+	entries = g_new (FileEntry *, g_list_length (files));
+	n_entries = 0;
 
-        file_entry->files = g_sequence_new ((GDestroyNotify)file_entry_free);
+	for (l = files; l != NULL; l = l->next) {
+		if (g_hash_table_contains (parent_hash, l->data)) {
+			g_warning ("file already in tree (parent_ptr: %p)!!!\n", parent_ptr);
+			continue;
+		}
 
-        got_count = nemo_file_get_directory_item_count (file, &count, &unreadable);
+		file_entry = file_entry_new (l->data, parent_entry);
 
-        if ((!got_count && !unreadable) || count > 0) {
-            add_dummy_row (model, file_entry);
-            gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
-                                                  path, &iter);
-        }
-    }
+		if (parent_entry == NULL &&
+		    (file_entry->filter_score = file_filter_score (model, file_entry->file)) == NEMO_LIST_MODEL_FILTERED_OUT) {
+			park_filtered_file_entry (model, file_entry);
+			continue;
+		}
 
-    gtk_tree_path_free (path);
+		/* Claim the slot now, so duplicates within the batch are caught */
+		g_hash_table_insert (parent_hash, file_entry->file, NULL);
+		entries[n_entries++] = file_entry;
+	}
 
-	return TRUE;
+	if (n_entries == 0) {
+		g_free (entries);
+		return;
+	}
+
+	replace_dummy = parent_entry != NULL && remove_loading_dummy (model, parent_entry);
+
+	n_rows = g_sequence_get_length (sequence);
+	sorted_entries = entries;
+
+	if (!model->details->temp_unsorted && n_entries > 1) {
+		sort_files = g_new (NemoFile *, n_entries);
+		sort_order = g_new (guint, n_entries);
+
+		for (i = 0; i < n_entries; i++) {
+			sort_files[i] = entries[i]->file;
+		}
+
+		nemo_list_model_sort_files (model, sort_files, n_entries, sort_order);
+
+		if (model->details->sort_by_filter_score && parent_entry == NULL) {
+			g_qsort_with_data (sort_order, n_entries, sizeof (guint),
+					   compare_entries_by_filter_score, entries);
+		}
+
+		sorted_entries = g_new (FileEntry *, n_entries);
+		for (i = 0; i < n_entries; i++) {
+			sorted_entries[i] = entries[sort_order[i]];
+		}
+
+		g_free (sort_files);
+		g_free (sort_order);
+	}
+
+	/* A few files going into a big directory are cheaper to place with
+	 * a binary search each than by walking all the rows. */
+	merge = !model->details->temp_unsorted && n_rows > 0 &&
+		n_entries * g_bit_storage (n_rows) >= n_rows;
+
+	announce = g_signal_has_handler_pending (model,
+						 g_signal_lookup ("row-inserted", GTK_TYPE_TREE_MODEL),
+						 0, TRUE);
+
+	ptr = g_sequence_get_begin_iter (sequence);
+
+	for (i = 0; i < n_entries; i++) {
+		file_entry = sorted_entries[i];
+
+		if (model->details->temp_unsorted || n_rows == 0) {
+			file_entry->ptr = g_sequence_append (sequence, file_entry);
+		} else if (merge) {
+			/* Both are sorted, so the next row goes after this one */
+			while (!g_sequence_iter_is_end (ptr) &&
+			       nemo_list_model_file_entry_compare_func (g_sequence_get (ptr),
+									file_entry, model) <= 0) {
+				ptr = g_sequence_iter_next (ptr);
+			}
+
+			file_entry->ptr = g_sequence_insert_before (ptr, file_entry);
+		} else {
+			file_entry->ptr = g_sequence_insert_sorted (sequence, file_entry,
+								    nemo_list_model_file_entry_compare_func, model);
+		}
+
+		g_hash_table_insert (parent_hash, file_entry->file, file_entry->ptr);
+
+		/* Each row is announced right after it goes in */
+		file_entry_inserted (model, file_entry, replace_dummy && i == 0, announce);
+	}
+
+	if (sorted_entries != entries) {
+		g_free (sorted_entries);
+	}
+	g_free (entries);
 }
 
 static gboolean
@@ -1135,6 +1603,66 @@ update_dummy_row (NemoListModel *model,
     return changed;
 }
 
+static void
+filter_hide_entry (NemoListModel *model, FileEntry *file_entry, int position)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	if (file_entry->subdirectory != NULL) {
+		/* Expanded children can't follow the row out of the tree */
+		nemo_list_model_ptr_to_iter (model, file_entry->ptr, &iter);
+		nemo_list_model_unload_subdirectory (model, &iter);
+
+		if (g_sequence_get_length (file_entry->files) == 0) {
+			guint count;
+			gboolean got_count, unreadable;
+
+			/* keep the expander for when the row comes back */
+			got_count = nemo_file_get_directory_item_count (file_entry->file, &count, &unreadable);
+
+			if ((!got_count && !unreadable) || count > 0) {
+				add_dummy_row (model, file_entry);
+			}
+		}
+	}
+
+	g_sequence_move (file_entry->ptr,
+			 g_sequence_get_end_iter (model->details->filtered_files));
+	model->details->stamp++;
+
+	path = gtk_tree_path_new_from_indices (position, -1);
+	gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+	gtk_tree_path_free (path);
+}
+
+static void
+filter_show_entry (NemoListModel *model, FileEntry *file_entry)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	GSequenceIter *dest;
+
+	if (model->details->temp_unsorted) {
+		dest = g_sequence_get_end_iter (model->details->files);
+	} else {
+		dest = g_sequence_search (model->details->files, file_entry,
+					  nemo_list_model_file_entry_compare_func, model);
+	}
+
+	g_sequence_move (file_entry->ptr, dest);
+
+	nemo_list_model_ptr_to_iter (model, file_entry->ptr, &iter);
+	path = gtk_tree_path_new_from_indices (g_sequence_iter_get_position (file_entry->ptr), -1);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+
+	if (file_entry->files != NULL && g_sequence_get_length (file_entry->files) > 0) {
+		gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model), path, &iter);
+	}
+
+	gtk_tree_path_free (path);
+}
+
 void
 nemo_list_model_file_changed (NemoListModel *model, NemoFile *file,
 				  NemoDirectory *directory)
@@ -1148,11 +1676,35 @@ nemo_list_model_file_changed (NemoListModel *model, NemoFile *file,
 	gboolean has_iter;
 	GSequence *files;
 
+	rendered_icon_cache_invalidate_file (model, file);
+
 	ptr = lookup_file (model, file, directory);
 	if (!ptr) {
 		return;
 	}
 
+	if (model->details->filter_func != NULL &&
+	    ((FileEntry *)g_sequence_get (ptr))->parent == NULL) {
+		FileEntry *file_entry;
+		gboolean passes;
+
+		/* A rename can move a row across the filter either way */
+		file_entry = g_sequence_get (ptr);
+		file_entry->filter_score = file_filter_score (model, file);
+		passes = file_entry->filter_score != NEMO_LIST_MODEL_FILTERED_OUT;
+
+		if (file_entry_is_filtered (model, g_sequence_get (ptr))) {
+			if (passes) {
+				filter_show_entry (model, g_sequence_get (ptr));
+			}
+			return;
+		} else if (!passes) {
+			filter_hide_entry (model, g_sequence_get (ptr),
+					   g_sequence_iter_get_position (ptr));
+			return;
+		}
+	}
+
 	pos_before = g_sequence_iter_get_position (ptr);
 
         if (!model->details->temp_unsorted)
@@ -1234,6 +1786,10 @@ nemo_list_model_remove (NemoListModel *model, GtkTreeIter *iter)
 	ptr = iter->user_data;
 	file_entry = g_sequence_get (ptr);
 
+	if (file_entry->file != NULL) {
+		rendered_icon_cache_invalidate_file (model, file_entry->file);
+	}
+
 	if (file_entry->files != NULL) {
 		while (g_sequence_get_length (file_entry->files) > 0) {
 			child_ptr = g_sequence_get_begin_iter (file_entry->files);
@@ -1309,15 +1865,35 @@ nemo_list_model_remove (NemoListModel *model, GtkTreeIter *iter)
 	}
 }
 
+static void
+remove_filtered_entry (NemoListModel *model, GSequenceIter *ptr)
+{
+	FileEntry *file_entry;
+
+	file_entry = g_sequence_get (ptr);
+	g_hash_table_remove (model->details->top_reverse_map, file_entry->file);
+	g_sequence_remove (ptr);
+}
+
 void
 nemo_list_model_remove_file (NemoListModel *model, NemoFile *file,
 			   NemoDirectory *directory)
 {
 	GtkTreeIter iter;
+	GSequenceIter *ptr;
 
-	if (nemo_list_model_get_tree_iter_from_file (model, file, directory, &iter)) {
-		nemo_list_model_remove (model, &iter);
+	ptr = lookup_file (model, file, directory);
+	if (!ptr) {
+		return;
+	}
+
+	if (file_entry_is_filtered (model, g_sequence_get (ptr))) {
+		remove_filtered_entry (model, ptr);
+		return;
 	}
+
+	nemo_list_model_ptr_to_iter (model, ptr, &iter);
+	nemo_list_model_remove (model, &iter);
 }
 
 static void
@@ -1344,7 +1920,14 @@ nemo_list_model_clear (NemoListModel *model)
 {
 	g_return_if_fail (model != NULL);
 
+	rendered_icon_cache_clear (model);
+
 	nemo_list_model_clear_directory (model, model->details->files);
+
+	while (g_sequence_get_length (model->details->filtered_files) > 0) {
+		remove_filtered_entry (model,
+				       g_sequence_get_begin_iter (model->details->filtered_files));
+	}
 }
 
 NemoFile *
@@ -1656,6 +2239,18 @@ nemo_list_model_dispose (GObject *object)
 		model->details->files = NULL;
 	}
 
+	if (model->details->filtered_files) {
+		g_sequence_free (model->details->filtered_files);
+		model->details->filtered_files = NULL;
+	}
+
+	if (model->details->filter_data_destroy != NULL) {
+		(* model->details->filter_data_destroy) (model->details->filter_data);
+	}
+	model->details->filter_func = NULL;
+	model->details->filter_data = NULL;
+	model->details->filter_data_destroy = NULL;
+
 	if (model->details->top_reverse_map) {
 		g_hash_table_destroy (model->details->top_reverse_map);
 		model->details->top_reverse_map = NULL;
@@ -1665,6 +2260,12 @@ nemo_list_model_dispose (GObject *object)
 		model->details->directory_reverse_map = NULL;
 	}
 
+	if (model->details->rendered_icons) {
+		rendered_icon_cache_clear (model);
+		g_hash_table_destroy (model->details->rendered_icons);
+		model->details->rendered_icons = NULL;
+	}
+
 	G_OBJECT_CLASS (nemo_list_model_parent_class)->dispose (object);
 }
 
@@ -1690,8 +2291,14 @@ nemo_list_model_init (NemoListModel *model)
 {
 	model->details = g_new0 (NemoListModelDetails, 1);
 	model->details->files = g_sequence_new ((GDestroyNotify)file_entry_free);
+	model->details->filtered_files = g_sequence_new ((GDestroyNotify)file_entry_free);
 	model->details->top_reverse_map = g_hash_table_new (g_direct_hash, g_direct_equal);
 	model->details->directory_reverse_map = g_hash_table_new (g_direct_hash, g_direct_equal);
+	model->details->rendered_icons = g_hash_table_new_full ((GHashFunc) rendered_icon_key_hash,
+								(GEqualFunc) rendered_icon_key_equal,
+								NULL,
+								(GDestroyNotify) rendered_icon_free);
+	g_queue_init (&model->details->rendered_icon_lru);
 	model->details->stamp = g_random_int ();
 	model->details->sort_attribute = 0;
 	model->details->columns = g_ptr_array_new ();
@@ -1892,3 +2499,204 @@ nemo_list_model_set_view_directory (NemoListModel *model, NemoDirectory *dir)
     model->details->view_dir = dir;
 }
 
+void
+nemo_list_model_set_filter_func (NemoListModel           *model,
+				 NemoListModelFilterFunc  func,
+				 gpointer                 data,
+				 GDestroyNotify           destroy)
+{
+	g_return_if_fail (NEMO_IS_LIST_MODEL (model));
+
+	if (model->details->filter_data_destroy != NULL) {
+		(* model->details->filter_data_destroy) (model->details->filter_data);
+	}
+
+	model->details->filter_func = func;
+	model->details->filter_data = data;
+	model->details->filter_data_destroy = destroy;
+}
+
+/* Snapshot of the top level files a filter pass has to look at: the
+ * visible ones, and the hidden ones too unless @narrowing.  The files
+ * are referenced, so the array can outlive changes to the model. */
+GPtrArray *
+nemo_list_model_get_filter_candidates (NemoListModel *model,
+				       gboolean       narrowing)
+{
+	GSequenceIter *ptr;
+	GPtrArray *files;
+	guint n_files;
+
+	g_return_val_if_fail (NEMO_IS_LIST_MODEL (model), NULL);
+
+	n_files = g_sequence_get_length (model->details->files);
+	if (!narrowing) {
+		n_files += g_sequence_get_length (model->details->filtered_files);
+	}
+
+	files = g_ptr_array_new_full (n_files, (GDestroyNotify) nemo_file_unref);
+
+	for (ptr = g_sequence_get_begin_iter (model->details->files);
+	     !g_sequence_iter_is_end (ptr);
+	     ptr = g_sequence_iter_next (ptr)) {
+		g_ptr_array_add (files, nemo_file_ref (((FileEntry *) g_sequence_get (ptr))->file));
+	}
+
+	if (!narrowing) {
+		for (ptr = g_sequence_get_begin_iter (model->details->filtered_files);
+		     !g_sequence_iter_is_end (ptr);
+		     ptr = g_sequence_iter_next (ptr)) {
+			g_ptr_array_add (files, nemo_file_ref (((FileEntry *) g_sequence_get (ptr))->file));
+		}
+	}
+
+	return files;
+}
+
+static void
+count_visible_entry (FileEntry *file_entry, guint *folders, guint *files)
+{
+	if (nemo_file_is_directory (file_entry->file)) {
+		(*folders)++;
+	} else {
+		(*files)++;
+	}
+}
+
+/* Hide and show the top level rows according to @scores, which were
+ * worked out (possibly off the main thread) for @files.  Files that have
+ * left the model since are skipped, and rows the scores don't cover,
+ * such as files added in the meantime, are scored with the filter
+ * function.  When @narrowing is set the caller guarantees the new filter
+ * only rejects more than the previous one did, so rows that are already
+ * hidden are not looked at again.  With @rank_by_score the visible rows
+ * are ordered by their filter score before the sort column. */
+void
+nemo_list_model_apply_filter_scores (NemoListModel  *model,
+				     NemoFile      **files,
+				     const int      *scores,
+				     guint           n_files,
+				     gboolean        narrowing,
+				     gboolean        rank_by_score,
+				     guint          *out_visible_folders,
+				     guint          *out_visible_files)
+{
+	GSequenceIter *ptr, *next;
+	GPtrArray *stale;
+	FileEntry *file_entry;
+	guint stamp, folders, visible_files, i;
+	gboolean was_ranked;
+	int position;
+
+	g_return_if_fail (NEMO_IS_LIST_MODEL (model));
+
+	stamp = ++model->details->filter_stamp;
+
+	for (i = 0; i < n_files; i++) {
+		ptr = g_hash_table_lookup (model->details->top_reverse_map, files[i]);
+		if (ptr == NULL) {
+			continue;
+		}
+
+		file_entry = g_sequence_get (ptr);
+		file_entry->filter_score = scores[i];
+		file_entry->filter_stamp = stamp;
+	}
+
+	stale = g_ptr_array_new ();
+
+	for (ptr = g_sequence_get_begin_iter (model->details->files);
+	     !g_sequence_iter_is_end (ptr);
+	     ptr = g_sequence_iter_next (ptr)) {
+		file_entry = g_sequence_get (ptr);
+		if (file_entry->filter_stamp != stamp) {
+			g_ptr_array_add (stale, file_entry);
+		}
+	}
+
+	if (!narrowing) {
+		for (ptr = g_sequence_get_begin_iter (model->details->filtered_files);
+		     !g_sequence_iter_is_end (ptr);
+		     ptr = g_sequence_iter_next (ptr)) {
+			file_entry = g_sequence_get (ptr);
+			if (file_entry->filter_stamp != stamp) {
+				g_ptr_array_add (stale, file_entry);
+			}
+		}
+	}
+
+	if (stale->len > 0) {
+		NemoFile **stale_files;
+		int *stale_scores;
+
+		/* Score the leftovers in one go so the filter can batch the work */
+		stale_files = g_new (NemoFile *, stale->len);
+		stale_scores = g_new0 (int, stale->len);
+
+		for (i = 0; i < stale->len; i++) {
+			stale_files[i] = ((FileEntry *) g_ptr_array_index (stale, i))->file;
+		}
+
+		if (model->details->filter_func != NULL) {
+			(* model->details->filter_func) (stale_files, stale->len, stale_scores,
+							 model->details->filter_data);
+		}
+
+		for (i = 0; i < stale->len; i++) {
+			file_entry = g_ptr_array_index (stale, i);
+			file_entry->filter_score = stale_scores[i];
+			file_entry->filter_stamp = stamp;
+		}
+
+		g_free (stale_scores);
+		g_free (stale_files);
+	}
+
+	g_ptr_array_free (stale, TRUE);
+
+	folders = visible_files = 0;
+	position = 0;
+
+	for (ptr = g_sequence_get_begin_iter (model->details->files);
+	     !g_sequence_iter_is_end (ptr);
+	     ptr = next) {
+		next = g_sequence_iter_next (ptr);
+		file_entry = g_sequence_get (ptr);
+
+		if (file_entry->filter_score == NEMO_LIST_MODEL_FILTERED_OUT) {
+			filter_hide_entry (model, file_entry, position);
+		} else {
+			count_visible_entry (file_entry, &folders, &visible_files);
+			position++;
+		}
+	}
+
+	/* The survivors have new scores, put them in order before
+	 * anything gets inserted among them */
+	was_ranked = model->details->sort_by_filter_score;
+	model->details->sort_by_filter_score = rank_by_score;
+
+	if ((rank_by_score || was_ranked) && !model->details->temp_unsorted) {
+		nemo_list_model_sort (model);
+	}
+
+	/* Hidden rows that weren't rescored still carry FILTERED_OUT */
+	for (ptr = g_sequence_get_begin_iter (model->details->filtered_files);
+	     !g_sequence_iter_is_end (ptr);
+	     ptr = next) {
+		next = g_sequence_iter_next (ptr);
+		file_entry = g_sequence_get (ptr);
+
+		if (file_entry->filter_score != NEMO_LIST_MODEL_FILTERED_OUT) {
+			filter_show_entry (model, file_entry);
+			count_visible_entry (file_entry, &folders, &visible_files);
+		}
+	}
+
+	if (out_visible_folders) {
+		*out_visible_folders = folders;
+	}
+	if (out_visible_files) {
+		*out_visible_files = visible_files;
+	}
+}
@@ -61,6 +61,17 @@ enum {
 
 typedef struct NemoListModelDetails NemoListModelDetails;
 
+/* Score of a row the filter hides */
+#define NEMO_LIST_MODEL_FILTERED_OUT G_MININT
+
+/* Fill in a score for each of @files, NEMO_LIST_MODEL_FILTERED_OUT for
+ * the ones that should be hidden.  Higher scores rank first when the
+ * model is asked to rank by score. */
+typedef void (* NemoListModelFilterFunc) (NemoFile **files,
+					  guint      n_files,
+					  int       *scores,
+					  gpointer   user_data);
+
 typedef struct NemoListModel {
 	GObject parent_instance;
 	NemoListModelDetails *details;
@@ -77,6 +88,9 @@ GType    nemo_list_model_get_type                          (void);
 gboolean nemo_list_model_add_file                          (NemoListModel          *model,
 								NemoFile         *file,
 								NemoDirectory    *directory);
+void     nemo_list_model_add_files                         (NemoListModel          *model,
+								GList            *files,
+								NemoDirectory    *directory);
 void     nemo_list_model_file_changed                      (NemoListModel          *model,
 								NemoFile         *file,
 								NemoDirectory    *directory);
@@ -103,8 +117,6 @@ int      nemo_list_model_get_sort_column_id_from_attribute (NemoListModel *model
 								GQuark       attribute);
 GQuark   nemo_list_model_get_attribute_from_sort_column_id (NemoListModel *model,
 								int sort_column_id);
-void     nemo_list_model_sort_files                        (NemoListModel *model,
-								GList **files);
 
 NemoZoomLevel nemo_list_model_get_zoom_level_from_column_id (int               column);
 int               nemo_list_model_get_column_id_from_zoom_level (NemoZoomLevel zoom_level);
@@ -123,6 +135,10 @@ GtkTargetList *   nemo_list_model_get_drag_target_list (void);
 int               nemo_list_model_compare_func (NemoListModel *model,
 						    NemoFile *file1,
 						    NemoFile *file2);
+void              nemo_list_model_sort_files   (NemoListModel *model,
+						    NemoFile **files,
+						    guint n_files,
+						    guint *order);
 
 
 int               nemo_list_model_add_column (NemoListModel *model,
@@ -140,4 +156,19 @@ void              nemo_list_model_set_temporarily_disable_sort (NemoListModel *m
 gboolean          nemo_list_model_get_temporarily_disable_sort (NemoListModel *model);
 void              nemo_list_model_set_expanding                (NemoListModel *model, NemoDirectory *directory);
 void              nemo_list_model_set_view_directory           (NemoListModel *model, NemoDirectory *dir);
+
+void              nemo_list_model_set_filter_func (NemoListModel           *model,
+						   NemoListModelFilterFunc  func,
+						   gpointer                 data,
+						   GDestroyNotify           destroy);
+GPtrArray *       nemo_list_model_get_filter_candidates (NemoListModel *model,
+							 gboolean       narrowing);
+void              nemo_list_model_apply_filter_scores   (NemoListModel  *model,
+							 NemoFile      **files,
+							 const int      *scores,
+							 guint           n_files,
+							 gboolean        narrowing,
+							 gboolean        rank_by_score,
+							 guint          *out_visible_folders,
+							 guint          *out_visible_files);
 #endif /* NEMO_LIST_MODEL_H */
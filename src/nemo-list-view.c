@@ -127,6 +127,11 @@ struct NemoListViewDetails {
     gint current_selection_count;
 
     gboolean overlay_scrolling;
+
+	/* Files added between begin_file_changes and end_file_changes,
+	 * a GQueue for each directory */
+	GHashTable *pending_added_files;
+	gboolean in_file_changes;
 };
 
 struct SelectionForeachData {
@@ -150,6 +155,10 @@ struct SelectionForeachData {
 #define INITIAL_UPDATE_VISIBLE_DELAY 300
 #define NORMAL_UPDATE_VISIBLE_DELAY 50
 
+/* Fill an empty model with this many files or more while it is detached
+ * from the tree view, so the view builds its rows in one go */
+#define DETACHED_ADD_FILES_THRESHOLD 200
+
 static GdkCursor *              hand_cursor = NULL;
 
 static GtkTargetList *          source_target_list = NULL;
@@ -2274,7 +2283,7 @@ static void
 prioritize_visible_files (NemoListView *view)
 {
     NemoFile *last_file;
-    // GList *queue_list, *l;
+    GList *on_screen, *margin;
     GdkRectangle vrect;
     GtkTreeIter iter;
     GtkTreePath *path;
@@ -2295,6 +2304,7 @@ prioritize_visible_files (NemoListView *view)
     end_y = bin_y + vrect.height + (vrect.height / 2);
 
     last_file = NULL;
+    on_screen = margin = NULL;
     cy = end_y;
 
     // Images that start out un-thumbnailed end up resolving in reverse
@@ -2331,6 +2341,13 @@ prioritize_visible_files (NemoListView *view)
                 } else {
                     nemo_file_invalidate_attributes (file, NEMO_FILE_DEFERRED_ATTRIBUTES);
                 }
+
+                /* Walking bottom-up, so prepending leaves both lists top to bottom */
+                if (cy >= bin_y && cy <= bin_y + vrect.height) {
+                    on_screen = g_list_prepend (on_screen, nemo_file_ref (file));
+                } else {
+                    margin = g_list_prepend (margin, nemo_file_ref (file));
+                }
             }
 
             nemo_file_unref (file);
@@ -2338,6 +2355,10 @@ prioritize_visible_files (NemoListView *view)
 
         cy -= stepdown;
     }
+
+    on_screen = g_list_concat (on_screen, margin);
+    nemo_file_list_prioritize (on_screen);
+    nemo_file_list_free (on_screen);
 }
 
 static gboolean
@@ -2762,18 +2783,108 @@ create_and_set_up_tree_view (NemoListView *view)
 }
 
 static void
-nemo_list_view_add_file (NemoView *view, NemoFile *file, NemoDirectory *directory)
+free_file_queue (GQueue *files)
+{
+	g_queue_free_full (files, (GDestroyNotify) nemo_file_unref);
+}
+
+static void
+flush_pending_added_files (NemoListView *list_view)
 {
+	GHashTableIter hash_iter;
+	gpointer directory, files;
+	GtkTreeView *tree_view;
 	NemoListModel *model;
+	gboolean detach;
+	gint search_column;
+	guint n_files;
+
+	if (list_view->details->pending_added_files == NULL ||
+	    g_hash_table_size (list_view->details->pending_added_files) == 0) {
+		return;
+	}
+
+	tree_view = list_view->details->tree_view;
+	model = list_view->details->model;
+
+	n_files = 0;
+	g_hash_table_iter_init (&hash_iter, list_view->details->pending_added_files);
+	while (g_hash_table_iter_next (&hash_iter, NULL, &files)) {
+		n_files += g_queue_get_length (files);
+	}
+
+	/* Nothing to keep in the view (selection, expanded rows, scroll
+	 * position) while the model is empty, so hand it over filled
+	 * instead of signalling every row */
+	detach = n_files >= DETACHED_ADD_FILES_THRESHOLD &&
+		nemo_list_model_is_empty (model);
+
+	search_column = -1;
+	if (detach) {
+		search_column = gtk_tree_view_get_search_column (tree_view);
+		gtk_tree_view_set_model (tree_view, NULL);
+	}
+
+	g_hash_table_iter_init (&hash_iter, list_view->details->pending_added_files);
+	while (g_hash_table_iter_next (&hash_iter, &directory, &files)) {
+		nemo_list_model_add_files (model, ((GQueue *) files)->head, directory);
+	}
+	g_hash_table_remove_all (list_view->details->pending_added_files);
+
+	if (detach) {
+		gtk_tree_view_set_model (tree_view, GTK_TREE_MODEL (model));
+		if (search_column >= 0) {
+			gtk_tree_view_set_search_column (tree_view, search_column);
+		}
+	}
+
+	queue_update_visible_icons (list_view, INITIAL_UPDATE_VISIBLE_DELAY);
+}
+
+static void
+nemo_list_view_begin_file_changes (NemoView *view)
+{
+	NEMO_LIST_VIEW (view)->details->in_file_changes = TRUE;
+}
+
+static void
+nemo_list_view_add_file (NemoView *view, NemoFile *file, NemoDirectory *directory)
+{
+	NemoListView *list_view;
+	GQueue *files;
+
+	list_view = NEMO_LIST_VIEW (view);
 
     if (nemo_file_has_thumbnail_access_problem (file)) {
         nemo_application_set_cache_flag (nemo_application_get_singleton ());
         nemo_window_slot_check_bad_cache_bar (nemo_view_get_nemo_window_slot (view));
     }
 
-	model = NEMO_LIST_VIEW (view)->details->model;
-	nemo_list_model_add_file (model, file, directory);
-    queue_update_visible_icons (NEMO_LIST_VIEW (view), INITIAL_UPDATE_VISIBLE_DELAY);
+	/* Collect the files of a batch and add them all at the end, unless
+	 * someone connected after us expects to find this file in the model */
+	if (list_view->details->in_file_changes &&
+	    !g_signal_has_handler_pending (view, g_signal_lookup ("add_file", NEMO_TYPE_VIEW), 0, TRUE)) {
+		if (list_view->details->pending_added_files == NULL) {
+			list_view->details->pending_added_files =
+				g_hash_table_new_full (NULL, NULL,
+						       (GDestroyNotify) nemo_directory_unref,
+						       (GDestroyNotify) free_file_queue);
+		}
+
+		files = g_hash_table_lookup (list_view->details->pending_added_files, directory);
+		if (files == NULL) {
+			files = g_queue_new ();
+			g_hash_table_insert (list_view->details->pending_added_files,
+					     nemo_directory_ref (directory), files);
+		}
+		g_queue_push_tail (files, nemo_file_ref (file));
+		return;
+	}
+
+	flush_pending_added_files (list_view);
+
+	nemo_list_model_add_file (list_view->details->model, file, directory);
+    queue_update_visible_icons (list_view, INITIAL_UPDATE_VISIBLE_DELAY);
 }
 
 static char **
@@ -3094,6 +3205,10 @@ nemo_list_view_clear (NemoView *view)
 
     g_signal_handlers_block_by_func (tree_selection, list_selection_changed_callback, view);
 
+	if (list_view->details->pending_added_files != NULL) {
+		g_hash_table_remove_all (list_view->details->pending_added_files);
+	}
+
 	if (list_view->details->model != NULL) {
 		stop_cell_editing (list_view);
 		nemo_list_model_clear (list_view->details->model);
@@ -3138,6 +3253,8 @@ nemo_list_view_file_changed (NemoView *view, NemoFile *file, NemoDirectory *dire
 
 	listview = NEMO_LIST_VIEW (view);
 
+	flush_pending_added_files (listview);
+
 	nemo_list_model_file_changed (listview->details->model, file, directory);
 
 	if (listview->details->renaming_file != NULL &&
@@ -3457,6 +3574,9 @@ nemo_list_view_end_file_changes (NemoView *view)
 
 	list_view = NEMO_LIST_VIEW (view);
 
+	flush_pending_added_files (list_view);
+	list_view->details->in_file_changes = FALSE;
+
 	if (list_view->details->new_selection_path) {
 		gtk_tree_view_set_cursor (list_view->details->tree_view,
 					  list_view->details->new_selection_path,
@@ -3483,6 +3603,8 @@ nemo_list_view_remove_file (NemoView *view, NemoFile *file, NemoDirectory *direc
 	list_view = NEMO_LIST_VIEW (view);
 	tree_model = GTK_TREE_MODEL(list_view->details->model);
 
+	flush_pending_added_files (list_view);
+
 	if (nemo_list_model_get_tree_iter_from_file (list_view->details->model, file, directory, &iter)) {
 		selection = gtk_tree_view_get_selection (list_view->details->tree_view);
 		file_path = gtk_tree_model_get_path (tree_model, &iter);
@@ -3520,6 +3642,9 @@ nemo_list_view_remove_file (NemoView *view, NemoFile *file, NemoDirectory *direc
 		if (row_reference) {
 			gtk_tree_row_reference_free (row_reference);
 		}
+	} else {
+		/* Rows hidden by the filter have no iter but still need to go */
+		nemo_list_model_remove_file (list_view->details->model, file, directory);
 	}
 
 
@@ -4069,6 +4194,15 @@ nemo_list_view_compare_files (NemoView *view, NemoFile *file1, NemoFile *file2)
 	return nemo_list_model_compare_func (list_view->details->model, file1, file2);
 }
 
+static void
+nemo_list_view_sort_files (NemoView *view, NemoFile **files, guint n_files, guint *order)
+{
+	NemoListView *list_view;
+
+	list_view = NEMO_LIST_VIEW (view);
+	nemo_list_model_sort_files (list_view->details->model, files, n_files, order);
+}
+
 static gboolean
 nemo_list_view_using_manual_layout (NemoView *view)
 {
@@ -4087,6 +4221,8 @@ nemo_list_view_dispose (GObject *object)
     g_signal_handlers_disconnect_by_func (gtk_settings_get_default (), update_date_fonts, list_view);
     g_signal_handlers_disconnect_by_func (nemo_preferences, update_date_fonts, list_view);
 
+	g_clear_pointer (&list_view->details->pending_added_files, g_hash_table_destroy);
+
 	if (list_view->details->model) {
 		stop_cell_editing (list_view);
 		g_object_unref (list_view->details->model);
@@ -4294,6 +4430,7 @@ nemo_list_view_class_init (NemoListViewClass *class)
 	G_OBJECT_CLASS (class)->finalize = nemo_list_view_finalize;
 
 	nemo_view_class->add_file = nemo_list_view_add_file;
+	nemo_view_class->begin_file_changes = nemo_list_view_begin_file_changes;
 	nemo_view_class->begin_loading = nemo_list_view_begin_loading;
 	nemo_view_class->end_loading = nemo_list_view_end_loading;
 	nemo_view_class->bump_zoom_level = nemo_list_view_bump_zoom_level;
@@ -4321,6 +4458,7 @@ nemo_list_view_class_init (NemoListViewClass *class)
 	nemo_view_class->set_selection = nemo_list_view_set_selection;
 	nemo_view_class->invert_selection = nemo_list_view_invert_selection;
 	nemo_view_class->compare_files = nemo_list_view_compare_files;
+	nemo_view_class->sort_files = nemo_list_view_sort_files;
 	nemo_view_class->sort_directories_first_changed = nemo_list_view_sort_directories_first_changed;
 	nemo_view_class->sort_favorites_first_changed = nemo_list_view_sort_favorites_first_changed;
 	nemo_view_class->start_renaming_file = nemo_list_view_start_renaming_file;
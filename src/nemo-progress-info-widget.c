@@ -37,6 +37,7 @@ enum {
 
 #define START_ICON "media-playback-start-symbolic"
 #define STOP_ICON "media-playback-stop-symbolic"
+#define MOVE_UP_ICON "go-up-symbolic"
 
 static GParamSpec *properties[NUM_PROPERTIES] = { NULL };
 
@@ -104,6 +105,40 @@ start_clicked (GtkWidget *button,
     nemo_job_queue_start_job_by_info (queue, self->priv->info);
 }
 
+static void
+move_up_clicked (GtkWidget *button,
+                 NemoProgressInfoWidget *self)
+{
+    NemoJobQueue *queue = nemo_job_queue_get ();
+    GtkWidget *parent;
+    GList *children, *l;
+    gint position, previous;
+
+    if (!nemo_job_queue_move_job_up (queue, self->priv->info))
+        return;
+
+    parent = gtk_widget_get_parent (GTK_WIDGET (self));
+
+    if (!GTK_IS_BOX (parent))
+        return;
+
+    /* Follow the queue: go in front of the closest waiting job above */
+    children = gtk_container_get_children (GTK_CONTAINER (parent));
+    previous = -1;
+
+    for (l = children, position = 0; l != NULL && l->data != self; l = l->next, position++) {
+        if (NEMO_IS_PROGRESS_INFO_WIDGET (l->data) &&
+            !nemo_progress_info_get_is_started (NEMO_PROGRESS_INFO_WIDGET (l->data)->priv->info)) {
+            previous = position;
+        }
+    }
+
+    g_list_free (children);
+
+    if (previous >= 0)
+        gtk_box_reorder_child (GTK_BOX (parent), GTK_WIDGET (self), previous);
+}
+
 static void
 nemo_progress_info_widget_constructed (GObject *obj)
 {
@@ -169,6 +204,12 @@ nemo_progress_info_widget_constructed (GObject *obj)
     gtk_box_pack_start (GTK_BOX (bb), button, FALSE, FALSE, 2);
     g_signal_connect (button, "clicked", G_CALLBACK (cancel_clicked), self);
 
+    button = gtk_button_new_from_icon_name (MOVE_UP_ICON, GTK_ICON_SIZE_BUTTON);
+    gtk_button_set_relief (GTK_BUTTON (button), GTK_RELIEF_NONE);
+    gtk_widget_set_tooltip_text (button, _("Move up in the queue"));
+    gtk_box_pack_start (GTK_BOX (bb), button, FALSE, FALSE, 2);
+    g_signal_connect (button, "clicked", G_CALLBACK (move_up_clicked), self);
+
     gtk_widget_show_all (view);
 
     /* construct normal in-progress stack page */
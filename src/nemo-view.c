@@ -3632,11 +3632,73 @@ compare_files_cover (gconstpointer a, gconstpointer b, gpointer callback_data)
 		return NEMO_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->compare_files (view, fad1->file, fad2->file);
 	}
 }
+static int
+compare_files_by_directory (gconstpointer a, gconstpointer b, gpointer callback_data)
+{
+	const FileAndDirectory *fad1, *fad2;
+
+	fad1 = *(FileAndDirectory * const *) a;
+	fad2 = *(FileAndDirectory * const *) b;
+
+	if (fad1->directory < fad2->directory) {
+		return -1;
+	} else if (fad1->directory > fad2->directory) {
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Same order as compare_files_cover (), but lets the view sort each
+ * directory's files in bulk when it can.
+ */
 static void
 sort_files (NemoView *view, GList **list)
 {
-	*list = g_list_sort_with_data (*list, compare_files_cover, view);
+	FileAndDirectory **items, **sorted;
+	NemoFile **files;
+	guint *order;
+	guint n_items, i;
+	GList *node;
+
+	if (NEMO_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->sort_files == NULL) {
+		*list = g_list_sort_with_data (*list, compare_files_cover, view);
+		return;
+	}
+
+	n_items = g_list_length (*list);
+
+	if (n_items <= 1) {
+		return;
+	}
+
+	items = g_new (FileAndDirectory *, n_items);
+	files = g_new (NemoFile *, n_items);
+	for (node = *list, i = 0; node != NULL; node = node->next, i++) {
+		items[i] = node->data;
+		files[i] = items[i]->file;
+	}
+
+	order = g_new (guint, n_items);
+	NEMO_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->sort_files (view, files, n_items, order);
+
+	sorted = g_new (FileAndDirectory *, n_items);
+	for (i = 0; i < n_items; i++) {
+		sorted[i] = items[order[i]];
+	}
+
+	/* Stable, so the files of each directory stay in order */
+	g_qsort_with_data (sorted, n_items, sizeof (FileAndDirectory *),
+			   compare_files_by_directory, NULL);
+
+	for (node = *list, i = 0; node != NULL; node = node->next, i++) {
+		node->data = sorted[i];
+	}
 
+	g_free (items);
+	g_free (files);
+	g_free (order);
+	g_free (sorted);
 }
 
 /* Go through all the new added and changed files.
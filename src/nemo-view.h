@@ -255,6 +255,15 @@ struct NemoViewClass {
 						NemoFile    *a,
 						NemoFile    *b);
 
+	/* sort_files may be overridden to sort many files at once in
+	 * compare_files order, filling @order with indices into @files.
+	 * Views that don't fall back to compare_files.
+	 */
+	void    (* sort_files)                 (NemoView *view,
+						NemoFile   **files,
+						guint        n_files,
+						guint       *order);
+
 	/* using_manual_layout is a function pointer that subclasses may
 	 * override to control whether or not items can be freely positioned
 	 * on the user-visible area.
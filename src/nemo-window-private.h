@@ -35,6 +35,7 @@
 #include "nemo-bookmark-list.h"
 
 #include <libnemo-private/nemo-directory.h>
+#include <libnemo-private/nemo-filter-match.h>
 
 /* FIXME bugzilla.gnome.org 42575: Migrate more fields into here. */
 struct NemoWindowDetails
@@ -44,8 +45,13 @@ struct NemoWindowDetails
         GtkWidget *filter_entry;
         /* Label to display filter results count */
         GtkWidget *filter_results_label;
-        /* current lowercase filter text */
-        gchar     *filter_text;
+        /* whether the filter entry has any text in it */
+        gboolean   filter_active;
+        /* compiled form of the filter text the view currently shows */
+        NemoFilterQuery *filter_query;
+        /* pending keystroke timeout, and the filter pass in flight */
+        guint      filter_debounce_id;
+        GCancellable *filter_cancellable;
         /* Underlying and filter models for active list view */
         GtkTreeModel         *orig_model;
         GtkTreeModelFilter   *filter_model;
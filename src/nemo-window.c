@@ -80,6 +80,7 @@ extern NemoIcon *nemo_icon_container_lookup_icon_by_file(NemoIconContainer *cont
 #include <libnemo-private/nemo-debug.h>
 
 #include <math.h>
+#include <string.h>
 #include <sys/time.h>
 
 #define MAX_TITLE_LENGTH 180
@@ -92,9 +93,11 @@ static guint mouse_back_button = 8;
 
 /* --- BEGIN FILTER FORWARD DECLARATIONS & HELPERS --- */
 static void on_filter_entry_changed (GtkEntry *entry, gpointer user_data);
+static void on_filter_match_mode_changed (GSettings *settings, const gchar *key, gpointer user_data);
 static gboolean should_file_be_visible_in_filter (NemoWindow *window, NemoFile *file);
 static gboolean set_icon_filtered_state(NemoIconContainer *container, NemoIcon *icon, gboolean should_be_visible);
-static int apply_filter_to_icon_container(NemoIconContainer *container, NemoWindow *window, guint *out_visible_folders, guint *out_visible_files);
+static int apply_filter_to_icon_container(NemoIconContainer *container, NemoWindow *window, GHashTable *scores, gboolean narrowing, guint *out_visible_folders, guint *out_visible_files);
+static void cancel_filter_pass (NemoWindow *window);
 static void ensure_selection_visible_and_focused (NemoView *view);
 static void focus_first_visible_icon (NemoIconContainer *container);
 static gboolean is_navigation_key(GdkEventKey *event);
@@ -747,6 +750,19 @@ nemo_window_constructed (GObject *self)
 	gtk_box_pack_start(GTK_BOX(filter_box), window->details->filter_results_label, FALSE, FALSE, 0);
 	gtk_widget_hide(window->details->filter_results_label); // Initially hide
 
+	GtkWidget *filter_mode_combo = gtk_combo_box_text_new();
+	gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(filter_mode_combo), "substring", _("Contains"));
+	gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(filter_mode_combo), "fuzzy", _("Fuzzy"));
+	gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(filter_mode_combo), "glob", _("Wildcard"));
+	gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(filter_mode_combo), "regex", _("Regular expression"));
+	g_settings_bind(nemo_preferences, NEMO_PREFERENCES_FILTER_MATCH_MODE,
+	                filter_mode_combo, "active-id", G_SETTINGS_BIND_DEFAULT);
+	gtk_box_pack_start(GTK_BOX(filter_box), filter_mode_combo, FALSE, FALSE, 0);
+	gtk_widget_show(filter_mode_combo);
+
+	g_signal_connect_object(nemo_preferences, "changed::" NEMO_PREFERENCES_FILTER_MATCH_MODE,
+	                        G_CALLBACK(on_filter_match_mode_changed), window, 0);
+
 	gtk_widget_show(filter_box);
 	/* --- END FILTER UI --- */
 
@@ -879,6 +895,8 @@ nemo_window_destroy (GtkWidget *object)
 
 	DEBUG ("Destroying window");
 
+	cancel_filter_pass (window);
+
 	/* close the sidebar first */
 	nemo_window_tear_down_sidebar (window);
 
@@ -919,6 +937,7 @@ nemo_window_finalize (GObject *object)
 	g_clear_object (&window->details->ui_manager);
 
 	g_free (window->details->sidebar_id);
+	nemo_filter_query_free (window->details->filter_query);
 
 	/* nemo_window_close() should have run */
 	g_assert (window->details->panes == NULL);
@@ -1309,8 +1328,7 @@ nemo_window_key_press_event (GtkWidget *widget, GdkEventKey *event)
 
 	/* Backspace handling unificado */
 	if (window->details->filter_entry &&
-		window->details->filter_text != NULL && 
-		window->details->filter_text[0] != '\0' &&
+		window->details->filter_active &&
 		event->keyval == GDK_KEY_BackSpace &&
 		!(event->state & (GDK_CONTROL_MASK | GDK_MOD1_MASK | GDK_SHIFT_MASK)) &&
 		(focus_widget == GTK_WIDGET(view) || focus_widget == window->details->filter_entry))
@@ -1323,8 +1341,7 @@ nemo_window_key_press_event (GtkWidget *widget, GdkEventKey *event)
 	}
 
 	// Handle Enter key when filter is active to open the selected file
-	if (window->details->filter_text != NULL && 
-		window->details->filter_text[0] != '\0' &&
+	if (window->details->filter_active &&
 		event->keyval == GDK_KEY_BackSpace && // This was likely a copy-paste error, should be GDK_KEY_Return or GDK_KEY_KP_Enter
 		!(event->state & (GDK_CONTROL_MASK | GDK_MOD1_MASK | GDK_SHIFT_MASK)) &&
 		(focus_widget == GTK_WIDGET(view) || focus_widget == window->details->filter_entry))
@@ -1344,8 +1361,7 @@ nemo_window_key_press_event (GtkWidget *widget, GdkEventKey *event)
 	}
 	
 	// Handle Up/Down arrow navigation when filter is active
-	if (window->details->filter_text != NULL && 
-		window->details->filter_text[0] != '\0' &&
+	if (window->details->filter_active &&
 		(event->keyval == GDK_KEY_Up || event->keyval == GDK_KEY_Down ||
 		 event->keyval == GDK_KEY_KP_Up || event->keyval == GDK_KEY_KP_Down) &&
 		focus_widget == window->details->filter_entry) {
@@ -1380,8 +1396,7 @@ nemo_window_key_press_event (GtkWidget *widget, GdkEventKey *event)
 	}
 	
 	// Handle F2 for renaming the selected file
-	if (window->details->filter_text != NULL && 
-		window->details->filter_text[0] != '\0' &&
+	if (window->details->filter_active &&
 		event->keyval == GDK_KEY_F2 &&
 		view != NULL) {
 		
@@ -2643,26 +2658,62 @@ nemo_event_get_window_open_flags (void)
 static gboolean
 should_file_be_visible_in_filter (NemoWindow *window, NemoFile *file)
 {
-	const gchar *filter = window->details->filter_text;
+	NemoFilterQuery *query = window->details->filter_query;
+	const gchar *key;
+	gsize key_length;
 
-	if (!filter || filter[0] == '\0') {
+	if (query == NULL) {
 		return TRUE; // No filter, always visible
 	}
 
-	gboolean visible = FALSE;
-	if (file) {
-		gchar *display_name = nemo_file_get_display_name (file);
-		if (display_name) {
-			// Note: filter_text is already lowercase
-			gchar *name_lower = g_utf8_strdown (display_name, -1);
-			if (g_strstr_len (name_lower, -1, filter) != NULL) {
-				visible = TRUE;
-			}
-			g_free (name_lower);
-			g_free (display_name);
-		}
+	if (!file) {
+		return FALSE;
 	}
-	return visible;
+
+	key = nemo_file_peek_display_name_match_key (file, &key_length);
+
+	return nemo_filter_query_match (query, key, key_length) != NEMO_FILTER_NO_MATCH;
+}
+
+/* NEMO_FILTER_NO_MATCH and NEMO_LIST_MODEL_FILTERED_OUT are both G_MININT,
+ * so the query scores can be handed to the model as they are. */
+static void
+list_model_filter_func (NemoFile **files, guint n_files, int *scores, gpointer user_data)
+{
+	NemoWindow *window = user_data;
+	NemoFilterQuery *query = window->details->filter_query;
+	const gchar **keys;
+	gsize *key_lengths;
+	guint i;
+
+	if (query == NULL) {
+		memset (scores, 0, n_files * sizeof (int));
+		return;
+	}
+
+	if (n_files == 1) {
+		// Files trickling in one at a time while the directory loads
+		const gchar *key;
+		gsize key_length;
+
+		key = nemo_file_peek_display_name_match_key (files[0], &key_length);
+		scores[0] = nemo_filter_query_match (query, key, key_length);
+		return;
+	}
+
+	// The keys are cached on the files, so collecting them here on the
+	// main thread leaves the matcher nothing but read-only work.
+	keys = g_new (const gchar *, n_files);
+	key_lengths = g_new (gsize, n_files);
+
+	for (i = 0; i < n_files; i++) {
+		keys[i] = nemo_file_peek_display_name_match_key (files[i], &key_lengths[i]);
+	}
+
+	nemo_filter_query_match_batch (query, keys, key_lengths, n_files, scores);
+
+	g_free (keys);
+	g_free (key_lengths);
 }
 
 static gboolean
@@ -2670,9 +2721,6 @@ set_icon_filtered_state(NemoIconContainer *container, // Added container argumen
                         NemoIcon *icon,
                         gboolean should_be_visible)
 {
-    gboolean state_changed = FALSE;
-    gboolean is_currently_filtered_out;
-
     g_return_val_if_fail(container != NULL, FALSE); // Add assertion
     g_return_val_if_fail(icon != NULL, FALSE);
 
@@ -2683,26 +2731,30 @@ set_icon_filtered_state(NemoIconContainer *container, // Added container argumen
     // Update NemoIcon's own visibility flag (used by other parts of Nemo potentially)
     icon->is_visible = should_be_visible;
 
-    // Check if the icon is currently marked as filtered out for canvas purposes
-    is_currently_filtered_out = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(icon->item), "filtered-out"));
+    if (icon->is_filtered_out == !should_be_visible) {
+        return FALSE;
+    }
 
-    if (is_currently_filtered_out == should_be_visible) { // Note: 'filtered-out' is inverse of 'should_be_visible'
-        state_changed = TRUE;
-        g_object_set_data(G_OBJECT(icon->item), "filtered-out", GINT_TO_POINTER(!should_be_visible));
+    // The layout skips filtered out icons, hiding the item keeps it off the canvas
+    icon->is_filtered_out = !should_be_visible;
 
-        if (should_be_visible) {
-            eel_canvas_item_show(EEL_CANVAS_ITEM(icon->item));
-        } else {
-            eel_canvas_item_hide(EEL_CANVAS_ITEM(icon->item));
-        }
+    if (should_be_visible) {
+        eel_canvas_item_show(EEL_CANVAS_ITEM(icon->item));
+    } else {
+        eel_canvas_item_hide(EEL_CANVAS_ITEM(icon->item));
     }
-    return state_changed;
+
+    return TRUE;
 }
 
+/* With @scores (file -> score, from a filter pass) the icons it covers
+ * take their score from there, and the rest, unless @narrowing says
+ * hidden ones stay hidden, are matched here against the current query. */
 static int
 apply_filter_to_icon_container(NemoIconContainer *container,
                               NemoWindow *window,
-                              // GList *all_files_in_dir, // REMOVED
+                              GHashTable *scores,
+                              gboolean narrowing,
                               guint *out_visible_folders,
                               guint *out_visible_files)
 {
@@ -2719,6 +2771,8 @@ apply_filter_to_icon_container(NemoIconContainer *container,
 
     // Iterate through the icons already in the container
     for (l = container->details->icons; l != NULL; l = l->next) {
+        gpointer score;
+
         icon_obj = l->data;
         if (!icon_obj || !icon_obj->item) { // Ensure icon and its canvas item exist
             continue;
@@ -2727,7 +2781,15 @@ apply_filter_to_icon_container(NemoIconContainer *container,
         NemoFile *file = NEMO_FILE(icon_obj->data); // Get the NemoFile from the NemoIcon
         if (!file) continue;
 
-        gboolean should_be_visible = should_file_be_visible_in_filter(window, file);
+        gboolean should_be_visible;
+
+        if (scores != NULL && g_hash_table_lookup_extended (scores, file, NULL, &score)) {
+            should_be_visible = GPOINTER_TO_INT (score) != NEMO_FILTER_NO_MATCH;
+        } else if (scores != NULL && narrowing && icon_obj->is_filtered_out) {
+            continue;
+        } else {
+            should_be_visible = should_file_be_visible_in_filter(window, file);
+        }
 
         // Pass container to set_icon_filtered_state
         if (set_icon_filtered_state(container, icon_obj, should_be_visible)) {
@@ -2752,85 +2814,259 @@ apply_filter_to_icon_container(NemoIconContainer *container,
     return visible_item_count;
 }
 
+/* Typing into the filter entry restarts this timeout; only when it runs
+ * out does a filter pass start. */
+#define FILTER_DEBOUNCE_MSEC 60
+
+/* Names matched between two checks for cancellation and two updates of
+ * the results label.  Large enough that nemo_filter_query_match_batch()
+ * still spreads each chunk over several threads. */
+#define FILTER_CHUNK_SIZE 32768
+
+/* A filter pass: everything the worker thread needs is copied out of the
+ * view up front, so the directory can keep changing while it runs. */
+typedef struct {
+    NemoView *view;
+    NemoFilterQuery *query;
+    gboolean narrowing;
+
+    GPtrArray *files;           /* NemoFile refs, in snapshot order */
+    gchar *key_data;            /* all match keys, nul separated */
+    const gchar **keys;
+    gsize *key_lengths;
+    guint8 *is_directory;
+    int *scores;
+} FilterPass;
+
+typedef struct {
+    GTask *task;
+    guint folders;
+    guint files;
+} FilterPassProgress;
+
+static FilterPass *
+filter_pass_new (NemoView *view,
+                 NemoFilterQuery *query,
+                 gboolean narrowing,
+                 GPtrArray *files)
+{
+    FilterPass *pass;
+    GString *key_data;
+    gsize offset;
+    guint i;
+
+    pass = g_new0 (FilterPass, 1);
+    pass->view = g_object_ref (view);
+    pass->query = query;
+    pass->narrowing = narrowing;
+    pass->files = files;
+    pass->keys = g_new (const gchar *, files->len);
+    pass->key_lengths = g_new (gsize, files->len);
+    pass->is_directory = g_new (guint8, files->len);
+    pass->scores = g_new (int, files->len);
+
+    // The cached keys belong to the files and go away on rename, so the
+    // worker gets copies, packed into one block.
+    key_data = g_string_new (NULL);
+
+    for (i = 0; i < files->len; i++) {
+        NemoFile *file = g_ptr_array_index (files, i);
+        const gchar *key;
+
+        key = nemo_file_peek_display_name_match_key (file, &pass->key_lengths[i]);
+        g_string_append_len (key_data, key, pass->key_lengths[i]);
+        g_string_append_c (key_data, '\0');
+        pass->is_directory[i] = nemo_file_is_directory (file);
+    }
+
+    pass->key_data = g_string_free (key_data, FALSE);
+
+    for (i = 0, offset = 0; i < files->len; i++) {
+        pass->keys[i] = pass->key_data + offset;
+        offset += pass->key_lengths[i] + 1;
+    }
+
+    return pass;
+}
 
 static void
-on_filter_entry_changed (GtkEntry *entry, gpointer user_data)
+filter_pass_free (FilterPass *pass)
 {
-    NemoWindow *window = NEMO_WINDOW (user_data);
-    const gchar *text = gtk_entry_get_text (entry);
-    NemoWindowSlot *slot;
-    NemoView *active_view;
-    guint visible_files_count = 0;
-    guint visible_folders_count = 0;
+    g_object_unref (pass->view);
+    nemo_filter_query_free (pass->query);
+    g_ptr_array_free (pass->files, TRUE);
+    g_free (pass->key_data);
+    g_free (pass->keys);
+    g_free (pass->key_lengths);
+    g_free (pass->is_directory);
+    g_free (pass->scores);
+    g_free (pass);
+}
 
-    DEBUG ("Filter: Text changed to: '%s'", text ? text : "(null)");
+static void
+update_filter_results_label (NemoWindow *window,
+                             guint visible_folders_count,
+                             guint visible_files_count,
+                             gboolean finished)
+{
+    char *results_text;
 
-    g_clear_pointer (&window->details->filter_text, g_free);
-    if (text && text[0] != '\0') {
-        window->details->filter_text = g_utf8_strdown (text, -1);
+    if (!window->details->filter_results_label) {
+        return;
+    }
+
+    if (finished) {
+        results_text = g_strdup_printf(_("%u folders, %u files match"),
+                                       visible_folders_count, visible_files_count);
     } else {
-        window->details->filter_text = NULL; // Cleared
+        results_text = g_strdup_printf(_("%u folders, %u files match so far"),
+                                       visible_folders_count, visible_files_count);
     }
 
-    slot = nemo_window_get_active_slot (window);
-    if (!slot) {
-        DEBUG("Filter: No active slot!");
-        return;
+    gtk_label_set_text(GTK_LABEL(window->details->filter_results_label), results_text);
+    gtk_widget_show(window->details->filter_results_label);
+    g_free(results_text);
+}
+
+static gboolean
+filter_pass_is_current (NemoWindow *window, GTask *task)
+{
+    GCancellable *cancellable = g_task_get_cancellable (task);
+
+    return cancellable == window->details->filter_cancellable &&
+           !g_cancellable_is_cancelled (cancellable);
+}
+
+static gboolean
+filter_pass_progress_cb (gpointer user_data)
+{
+    FilterPassProgress *progress = user_data;
+    NemoWindow *window = g_task_get_source_object (progress->task);
+
+    if (filter_pass_is_current (window, progress->task)) {
+        update_filter_results_label (window, progress->folders, progress->files, FALSE);
     }
-    active_view = nemo_window_slot_get_current_view (slot);
-    if (!active_view) {
-        DEBUG("Filter: No current view in active slot!");
-        return;
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+filter_pass_progress_free (gpointer user_data)
+{
+    FilterPassProgress *progress = user_data;
+
+    g_object_unref (progress->task);
+    g_free (progress);
+}
+
+static void
+filter_pass_thread (GTask        *task,
+                    gpointer      source_object,
+                    gpointer      task_data,
+                    GCancellable *cancellable)
+{
+    FilterPass *pass = task_data;
+    guint start, count, i;
+    guint folders = 0, files = 0;
+
+    for (start = 0; start < pass->files->len; start += count) {
+        if (g_task_return_error_if_cancelled (task)) {
+            return;
+        }
+
+        count = MIN (FILTER_CHUNK_SIZE, pass->files->len - start);
+        nemo_filter_query_match_batch (pass->query,
+                                       pass->keys + start,
+                                       pass->key_lengths + start,
+                                       count,
+                                       pass->scores + start);
+
+        for (i = start; i < start + count; i++) {
+            if (pass->scores[i] != NEMO_FILTER_NO_MATCH) {
+                if (pass->is_directory[i]) {
+                    folders++;
+                } else {
+                    files++;
+                }
+            }
+        }
+
+        if (start + count < pass->files->len) {
+            FilterPassProgress *progress;
+
+            progress = g_new (FilterPassProgress, 1);
+            progress->task = g_object_ref (task);
+            progress->folders = folders;
+            progress->files = files;
+
+            g_main_context_invoke_full (g_task_get_context (task), G_PRIORITY_DEFAULT,
+                                        filter_pass_progress_cb, progress,
+                                        filter_pass_progress_free);
+        }
     }
 
+    g_task_return_boolean (task, TRUE);
+}
+
+/* Show the current query in the active view.  Scores come from @pass
+ * when there is one, otherwise the view is matched right here. */
+static void
+apply_filter_to_view (NemoWindow *window, NemoView *active_view, FilterPass *pass)
+{
+    guint visible_files_count = 0;
+    guint visible_folders_count = 0;
+    gboolean narrowing = pass != NULL && pass->narrowing;
+    gboolean rank_by_score;
+
+    rank_by_score = window->details->filter_query != NULL &&
+                    nemo_filter_query_get_mode (window->details->filter_query) == NEMO_FILTER_MATCH_FUZZY;
+
     if (NEMO_IS_LIST_VIEW (active_view)) {
         DEBUG("Filter: Handling List View.");
         NemoListView *list_view = NEMO_LIST_VIEW(active_view);
         GtkTreeView *tree_view = nemo_list_view_get_tree_view(list_view);
         NemoListModel *list_model = NEMO_LIST_MODEL(gtk_tree_view_get_model(tree_view));
-        NemoDirectory *directory = nemo_view_get_model(active_view); // Still need this for List View
-        GList *all_files_in_dir = NULL;
-
-        if (directory) {
-             all_files_in_dir = nemo_directory_get_file_list(directory);
-        }
-
 
         if (!NEMO_IS_LIST_MODEL(list_model)) {
             DEBUG("Filter: List View model is not NemoListModel.");
-            if (all_files_in_dir) nemo_file_list_free(all_files_in_dir);
             return;
         }
 
-        nemo_list_model_clear(list_model); // Clear current items
-
-        if (all_files_in_dir) {
-            GList *iter_files;
-            for (iter_files = all_files_in_dir; iter_files != NULL; iter_files = iter_files->next) {
-                NemoFile *file = NEMO_FILE(iter_files->data);
-                if (should_file_be_visible_in_filter(window, file)) {
-                    // For list model, we need to pass the directory context
-                    nemo_list_model_add_file(list_model, file, directory);
-                    if (nemo_file_is_directory(file)) {
-                        visible_folders_count++;
-                    } else {
-                        visible_files_count++;
-                    }
-                }
-            }
-            nemo_file_list_free(all_files_in_dir);
-        }
+        // Hide and show rows in place rather than rebuilding the model
+        nemo_list_model_set_filter_func(list_model,
+                                        window->details->filter_query != NULL ? list_model_filter_func : NULL,
+                                        window, NULL);
+        nemo_list_model_apply_filter_scores(list_model,
+                                            pass ? (NemoFile **) pass->files->pdata : NULL,
+                                            pass ? pass->scores : NULL,
+                                            pass ? pass->files->len : 0,
+                                            narrowing, rank_by_score,
+                                            &visible_folders_count, &visible_files_count);
     } else if (NEMO_IS_ICON_VIEW (active_view)) {
         DEBUG("Filter: Handling Icon View.");
         NemoIconView *icon_view_instance = NEMO_ICON_VIEW(active_view);
         NemoIconContainer *icon_container = nemo_icon_view_get_icon_container(icon_view_instance);
+        GHashTable *scores = NULL;
+        guint i;
 
-        if (NEMO_IS_ICON_CONTAINER(icon_container)) {
-            // Pass only the container and window now
-            apply_filter_to_icon_container(icon_container, window,
-                                           &visible_folders_count, &visible_files_count);
-        } else {
+        if (!NEMO_IS_ICON_CONTAINER(icon_container)) {
             DEBUG("Filter: IconContainer is NULL for IconView.");
+            return;
+        }
+
+        if (pass != NULL) {
+            scores = g_hash_table_new (g_direct_hash, g_direct_equal);
+            for (i = 0; i < pass->files->len; i++) {
+                g_hash_table_insert (scores, g_ptr_array_index (pass->files, i),
+                                     GINT_TO_POINTER (pass->scores[i]));
+            }
+        }
+
+        apply_filter_to_icon_container(icon_container, window, scores, narrowing,
+                                       &visible_folders_count, &visible_files_count);
+
+        if (scores != NULL) {
+            g_hash_table_destroy (scores);
         }
     } else {
         DEBUG("Filter: Active view type %s is not handled.", G_OBJECT_TYPE_NAME(active_view));
@@ -2838,12 +3074,8 @@ on_filter_entry_changed (GtkEntry *entry, gpointer user_data)
 
     // Update results label
     if (window->details->filter_results_label) {
-        if (window->details->filter_text && window->details->filter_text[0] != '\0') {
-            char *results_text = g_strdup_printf(_("%u folders, %u files match"),
-                                               visible_folders_count, visible_files_count);
-            gtk_label_set_text(GTK_LABEL(window->details->filter_results_label), results_text);
-            g_free(results_text);
-            gtk_widget_show(window->details->filter_results_label);
+        if (window->details->filter_query != NULL) {
+            update_filter_results_label (window, visible_folders_count, visible_files_count, TRUE);
         } else {
             gtk_label_set_text(GTK_LABEL(window->details->filter_results_label), "");
             gtk_widget_hide(window->details->filter_results_label);
@@ -2853,6 +3085,210 @@ on_filter_entry_changed (GtkEntry *entry, gpointer user_data)
     ensure_selection_visible_and_focused(active_view);
 }
 
+static NemoView *
+get_filter_view (NemoWindow *window)
+{
+    NemoWindowSlot *slot;
+    NemoView *active_view;
+
+    slot = nemo_window_get_active_slot (window);
+    if (!slot) {
+        DEBUG("Filter: No active slot!");
+        return NULL;
+    }
+    active_view = nemo_window_slot_get_current_view (slot);
+    if (!active_view) {
+        DEBUG("Filter: No current view in active slot!");
+        return NULL;
+    }
+
+    return active_view;
+}
+
+static void start_filter_pass (NemoWindow *window);
+
+static void
+filter_pass_done (GObject      *source_object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+    NemoWindow *window = NEMO_WINDOW (source_object);
+    GTask *task = G_TASK (result);
+    FilterPass *pass = g_task_get_task_data (task);
+    NemoView *active_view;
+    GError *error = NULL;
+
+    if (!g_task_propagate_boolean (task, &error)) {
+        // Superseded by a newer pass, or the window went away
+        g_error_free (error);
+        return;
+    }
+
+    if (!filter_pass_is_current (window, task)) {
+        return;
+    }
+
+    g_clear_object (&window->details->filter_cancellable);
+
+    active_view = get_filter_view (window);
+    if (active_view == NULL) {
+        return;
+    }
+
+    if (active_view != pass->view) {
+        // The view was switched while we worked, start over on the new one
+        start_filter_pass (window);
+        return;
+    }
+
+    nemo_filter_query_free (window->details->filter_query);
+    window->details->filter_query = pass->query;
+    pass->query = NULL;
+
+    apply_filter_to_view (window, active_view, pass);
+}
+
+static void
+cancel_filter_pass (NemoWindow *window)
+{
+    if (window->details->filter_debounce_id != 0) {
+        g_source_remove (window->details->filter_debounce_id);
+        window->details->filter_debounce_id = 0;
+    }
+
+    if (window->details->filter_cancellable != NULL) {
+        g_cancellable_cancel (window->details->filter_cancellable);
+        g_clear_object (&window->details->filter_cancellable);
+    }
+}
+
+static void
+start_filter_pass (NemoWindow *window)
+{
+    const gchar *text = gtk_entry_get_text (GTK_ENTRY (window->details->filter_entry));
+    NemoView *active_view;
+    NemoFilterMatchMode mode;
+    NemoFilterQuery *query;
+    GPtrArray *files;
+    FilterPass *pass;
+    GTask *task;
+    GError *error = NULL;
+    gboolean narrowing;
+
+    mode = g_settings_get_enum (nemo_preferences, NEMO_PREFERENCES_FILTER_MATCH_MODE);
+    query = nemo_filter_query_new (text, mode, &error);
+
+    if (query == NULL) {
+        // Half-typed expression: say so and leave the view as it is
+        DEBUG ("Filter: Invalid pattern: %s", error->message);
+        gtk_label_set_text (GTK_LABEL (window->details->filter_results_label),
+                            _("Invalid pattern"));
+        gtk_widget_show (window->details->filter_results_label);
+        g_error_free (error);
+        return;
+    }
+
+    active_view = get_filter_view (window);
+    if (active_view == NULL) {
+        nemo_filter_query_free (query);
+        return;
+    }
+
+    // If the new query can only reject more than the one on screen did,
+    // only what is visible now can change state.
+    narrowing = nemo_filter_query_narrows (query, window->details->filter_query);
+
+    if (NEMO_IS_LIST_VIEW (active_view)) {
+        GtkTreeView *tree_view = nemo_list_view_get_tree_view (NEMO_LIST_VIEW (active_view));
+        GtkTreeModel *model = gtk_tree_view_get_model (tree_view);
+
+        if (!NEMO_IS_LIST_MODEL (model)) {
+            nemo_filter_query_free (query);
+            return;
+        }
+        files = nemo_list_model_get_filter_candidates (NEMO_LIST_MODEL (model), narrowing);
+    } else if (NEMO_IS_ICON_VIEW (active_view)) {
+        NemoIconContainer *icon_container = nemo_icon_view_get_icon_container (NEMO_ICON_VIEW (active_view));
+        GList *l;
+
+        files = g_ptr_array_new_with_free_func ((GDestroyNotify) nemo_file_unref);
+        for (l = icon_container->details->icons; l != NULL; l = l->next) {
+            NemoIcon *icon = l->data;
+
+            if (icon->data != NULL && (!narrowing || !icon->is_filtered_out)) {
+                g_ptr_array_add (files, nemo_file_ref (NEMO_FILE (icon->data)));
+            }
+        }
+    } else {
+        DEBUG("Filter: Active view type %s is not handled.", G_OBJECT_TYPE_NAME(active_view));
+        nemo_filter_query_free (window->details->filter_query);
+        window->details->filter_query = query;
+        return;
+    }
+
+    pass = filter_pass_new (active_view, query, narrowing, files);
+
+    window->details->filter_cancellable = g_cancellable_new ();
+
+    task = g_task_new (window, window->details->filter_cancellable, filter_pass_done, NULL);
+    g_task_set_task_data (task, pass, (GDestroyNotify) filter_pass_free);
+    g_task_run_in_thread (task, filter_pass_thread);
+    g_object_unref (task);
+}
+
+static gboolean
+filter_debounce_timeout_cb (gpointer user_data)
+{
+    NemoWindow *window = NEMO_WINDOW (user_data);
+
+    window->details->filter_debounce_id = 0;
+    start_filter_pass (window);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Matching runs as a cancellable pass on a worker thread once typing
+ * pauses; a newer keystroke drops whatever pass is still running, and
+ * the view only changes when a pass finishes, all in one go. */
+static void
+on_filter_entry_changed (GtkEntry *entry, gpointer user_data)
+{
+    NemoWindow *window = NEMO_WINDOW (user_data);
+    const gchar *text = gtk_entry_get_text (entry);
+    NemoView *active_view;
+
+    DEBUG ("Filter: Text changed to: '%s'", text ? text : "(null)");
+
+    cancel_filter_pass (window);
+
+    window->details->filter_active = text && text[0] != '\0';
+    if (window->details->filter_active) {
+        window->details->filter_debounce_id = g_timeout_add (FILTER_DEBOUNCE_MSEC,
+                                                             filter_debounce_timeout_cb,
+                                                             window);
+        return;
+    }
+
+    // Clearing the filter needs no matching, so it happens right away
+    g_clear_pointer (&window->details->filter_query, nemo_filter_query_free);
+
+    active_view = get_filter_view (window);
+    if (active_view != NULL) {
+        apply_filter_to_view (window, active_view, NULL);
+    }
+}
+
+
+static void
+on_filter_match_mode_changed (GSettings *settings, const gchar *key, gpointer user_data)
+{
+    NemoWindow *window = NEMO_WINDOW (user_data);
+
+    // A query in another mode never narrows, so this is a full pass
+    if (window->details->filter_entry && window->details->filter_active) {
+        on_filter_entry_changed (GTK_ENTRY (window->details->filter_entry), window);
+    }
+}
 
 static void
 ensure_selection_visible_and_focused(NemoView *view)
@@ -2923,30 +3359,22 @@ focus_first_visible_icon (NemoIconContainer *container)
 {
 	g_return_if_fail(NEMO_IS_ICON_CONTAINER(container));
 
-	NemoWindow *window = nemo_view_get_nemo_window(NEMO_VIEW(NEMO_ICON_VIEW_CONTAINER(container)->view));
-	NemoDirectory *directory = nemo_view_get_model(NEMO_VIEW(NEMO_ICON_VIEW_CONTAINER(container)->view));
-	g_return_if_fail(window && directory);
-
-	GList *all_files = nemo_directory_get_file_list(directory);
 	NemoIcon *first_visible_icon = NULL;
-	NemoFile *first_visible_file = NULL;
-
-	if (all_files) {
-		GList *l;
-		for (l = all_files; l != NULL; l = l->next) {
-			NemoFile *file = NEMO_FILE(l->data);
-			if (should_file_be_visible_in_filter(window, file)) {
-				first_visible_icon = nemo_icon_container_lookup_icon_by_file(container, file);
-				if (first_visible_icon && first_visible_icon->item) { // Ensure icon and item exist
-					first_visible_file = file;
-					break;
-				}
-			}
+	GList *l;
+
+	// Icons are kept in display order, so the first one the filter
+	// leaves alone is the one at the top
+	for (l = container->details->icons; l != NULL; l = l->next) {
+		NemoIcon *icon = l->data;
+
+		if (!icon->is_filtered_out && icon->data != NULL && icon->item != NULL) {
+			first_visible_icon = icon;
+			break;
 		}
 	}
 
-
-	if (first_visible_icon && first_visible_file) {
+	if (first_visible_icon) {
+		NemoFile *first_visible_file = NEMO_FILE(first_visible_icon->data);
 		GList *sel_list = g_list_append(NULL, nemo_file_ref(first_visible_file));
 		nemo_view_set_selection(NEMO_VIEW(NEMO_ICON_VIEW_CONTAINER(container)->view), sel_list);
 		nemo_file_list_free(sel_list); // set_selection refs it
@@ -2954,8 +3382,4 @@ focus_first_visible_icon (NemoIconContainer *container)
 		nemo_icon_container_scroll_to_icon(container, first_visible_icon->data);
 		eel_canvas_item_grab_focus(EEL_CANVAS_ITEM(first_visible_icon->item));
 	}
-
-	if (all_files) {
-		nemo_file_list_free(all_files);
-	}
 }
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include <libnemo-private/nemo-filter-match.h>
+#include <glib.h>
+#include <string.h>
+
+/* Byte for byte, the way nemo_filter_match_key_contains() must answer */
+static gboolean
+contains_reference (const char *haystack,
+		    gsize       haystack_length,
+		    const char *needle,
+		    gsize       needle_length)
+{
+	gsize i;
+
+	if (needle_length > haystack_length) {
+		return FALSE;
+	}
+
+	for (i = 0; i + needle_length <= haystack_length; i++) {
+		if (memcmp (haystack + i, needle, needle_length) == 0) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+name_matches (const char          *text,
+	      NemoFilterMatchMode  mode,
+	      const char          *name)
+{
+	NemoFilterQuery *query;
+	char *key;
+	gint score;
+
+	query = nemo_filter_query_new (text, mode, NULL);
+	g_assert (query != NULL);
+
+	key = nemo_filter_match_key_new (name, -1);
+	score = nemo_filter_query_match (query, key, strlen (key));
+
+	g_free (key);
+	nemo_filter_query_free (query);
+
+	return score != NEMO_FILTER_NO_MATCH;
+}
+
+static gint
+fuzzy_score (const char *text,
+	     const char *name)
+{
+	NemoFilterQuery *query;
+	char *key;
+	gint score;
+
+	query = nemo_filter_query_new (text, NEMO_FILTER_MATCH_FUZZY, NULL);
+	key = nemo_filter_match_key_new (name, -1);
+	score = nemo_filter_query_match (query, key, strlen (key));
+
+	g_free (key);
+	nemo_filter_query_free (query);
+
+	return score;
+}
+
+static gboolean
+query_narrows (const char          *text,
+	       NemoFilterMatchMode  mode,
+	       const char          *previous_text,
+	       NemoFilterMatchMode  previous_mode)
+{
+	NemoFilterQuery *query, *previous;
+	gboolean narrows;
+
+	query = nemo_filter_query_new (text, mode, NULL);
+	previous = nemo_filter_query_new (previous_text, previous_mode, NULL);
+
+	narrows = nemo_filter_query_narrows (query, previous);
+
+	nemo_filter_query_free (query);
+	nemo_filter_query_free (previous);
+
+	return narrows;
+}
+
+/* Needles placed on every offset around the 16 byte blocks the vector
+ * search works in, up to the very last byte of the name */
+static void
+test_contains_block_boundaries (void)
+{
+	char haystack[64];
+	const char *needle = "nemo";
+	gsize needle_length, length, offset;
+
+	needle_length = strlen (needle);
+
+	for (length = needle_length; length <= sizeof (haystack); length++) {
+		for (offset = 0; offset + needle_length <= length; offset++) {
+			memset (haystack, 'x', length);
+			memcpy (haystack + offset, needle, needle_length);
+
+			g_assert (nemo_filter_match_key_contains (haystack, length,
+								  needle, needle_length));
+		}
+
+		/* Only the first or the last byte of the needle at the end */
+		memset (haystack, 'x', length);
+		memcpy (haystack + length - (needle_length - 1), needle, needle_length - 1);
+		g_assert (!nemo_filter_match_key_contains (haystack, length, needle, needle_length));
+
+		memset (haystack, 'x', length);
+		memcpy (haystack + length - (needle_length - 1), needle + 1, needle_length - 1);
+		g_assert (!nemo_filter_match_key_contains (haystack, length, needle, needle_length));
+	}
+}
+
+/* A small alphabet makes near misses common, which is where a vector
+ * search and its scalar tail can disagree */
+static void
+test_contains_random (void)
+{
+	GRand *rand;
+	char haystack[80], needle[20];
+	gsize haystack_length, needle_length, i;
+	gint round;
+
+	rand = g_rand_new_with_seed (42);
+
+	for (round = 0; round < 200000; round++) {
+		haystack_length = g_rand_int_range (rand, 0, sizeof (haystack) + 1);
+		needle_length = g_rand_int_range (rand, 0, sizeof (needle) + 1);
+
+		for (i = 0; i < haystack_length; i++) {
+			haystack[i] = "abc"[g_rand_int_range (rand, 0, 3)];
+		}
+		for (i = 0; i < needle_length; i++) {
+			needle[i] = "abc"[g_rand_int_range (rand, 0, 3)];
+		}
+
+		g_assert_cmpint (nemo_filter_match_key_contains (haystack, haystack_length,
+								 needle, needle_length),
+				 ==,
+				 contains_reference (haystack, haystack_length,
+						     needle, needle_length));
+	}
+
+	g_rand_free (rand);
+}
+
+static void
+test_folding (void)
+{
+	NemoFilterMatchMode mode;
+
+	for (mode = NEMO_FILTER_MATCH_SUBSTRING; mode <= NEMO_FILTER_MATCH_FUZZY; mode++) {
+		g_assert (name_matches ("readme", mode, "README.md"));
+		g_assert (name_matches ("café", mode, "CAFÉ.txt"));
+		g_assert (name_matches ("CAFÉ", mode, "café.txt"));
+		g_assert (name_matches ("ärger", mode, "ÄRGER.odt"));
+
+		/* Composed and decomposed forms are the same name */
+		g_assert (name_matches ("cafe\xcc\x81", mode, "caf\xc3\xa9"));
+		g_assert (name_matches ("caf\xc3\xa9", mode, "cafe\xcc\x81"));
+
+		/* Compatibility forms fold to the plain ones */
+		g_assert (name_matches ("abc", mode, "\xef\xbc\xa1\xef\xbc\xa2\xef\xbc\xa3"));
+
+		/* An accent the name doesn't have still rules it out */
+		g_assert (!name_matches ("café", mode, "cafe.txt"));
+	}
+
+	/* but a name with an accent matches the bare letters */
+	g_assert (name_matches ("cafe", NEMO_FILTER_MATCH_SUBSTRING, "Café.txt"));
+
+	g_assert (name_matches ("CAFÉ*", NEMO_FILTER_MATCH_GLOB, "café.txt"));
+	g_assert (name_matches ("^ÄR", NEMO_FILTER_MATCH_REGEX, "ärger.odt"));
+}
+
+static void
+test_fuzzy_ranking (void)
+{
+	gint prefix, word_start, scattered;
+
+	prefix = fuzzy_score ("doc", "documents");
+	word_start = fuzzy_score ("doc", "my-docs");
+	scattered = fuzzy_score ("doc", "android-config");
+
+	g_assert_cmpint (scattered, !=, NEMO_FILTER_NO_MATCH);
+	g_assert_cmpint (prefix, >=, word_start);
+	g_assert_cmpint (word_start, >, scattered);
+
+	g_assert_cmpint (fuzzy_score ("doc", "cod"), ==, NEMO_FILTER_NO_MATCH);
+
+	/* Consecutive letters beat the same letters with gaps */
+	g_assert_cmpint (fuzzy_score ("doc", "xdocx"), >, fuzzy_score ("doc", "xdxoxcx"));
+}
+
+static void
+test_narrows (void)
+{
+	/* More text only ever rejects more */
+	g_assert (query_narrows ("docs", NEMO_FILTER_MATCH_SUBSTRING, "doc", NEMO_FILTER_MATCH_SUBSTRING));
+	g_assert (query_narrows ("dcs", NEMO_FILTER_MATCH_FUZZY, "ds", NEMO_FILTER_MATCH_FUZZY));
+	g_assert (!query_narrows ("doc", NEMO_FILTER_MATCH_SUBSTRING, "docs", NEMO_FILTER_MATCH_SUBSTRING));
+	g_assert (!query_narrows ("sd", NEMO_FILTER_MATCH_FUZZY, "ds", NEMO_FILTER_MATCH_FUZZY));
+
+	/* A metacharacter can widen a pattern, so patterns never narrow */
+	g_assert (!query_narrows ("doc*", NEMO_FILTER_MATCH_GLOB, "doc", NEMO_FILTER_MATCH_GLOB));
+	g_assert (!query_narrows ("doc.", NEMO_FILTER_MATCH_REGEX, "doc", NEMO_FILTER_MATCH_REGEX));
+
+	/* Nor does anything after a change of mode */
+	g_assert (!query_narrows ("docs", NEMO_FILTER_MATCH_FUZZY, "doc", NEMO_FILTER_MATCH_SUBSTRING));
+	g_assert (!query_narrows ("docs", NEMO_FILTER_MATCH_SUBSTRING, "doc", NEMO_FILTER_MATCH_FUZZY));
+
+	g_assert (!nemo_filter_query_narrows (NULL, NULL));
+}
+
+/* Big enough to be spread over threads */
+static void
+test_match_batch (void)
+{
+	NemoFilterQuery *query;
+	GPtrArray *keys;
+	gsize *key_lengths;
+	gint *scores;
+	guint n_keys, i;
+
+	n_keys = 50000;
+	keys = g_ptr_array_new_with_free_func (g_free);
+	key_lengths = g_new (gsize, n_keys);
+	scores = g_new (gint, n_keys);
+
+	for (i = 0; i < n_keys; i++) {
+		char *name;
+
+		name = g_strdup_printf ("Document %u - copy.txt", i);
+		g_ptr_array_add (keys, nemo_filter_match_key_new (name, -1));
+		key_lengths[i] = strlen (g_ptr_array_index (keys, i));
+		g_free (name);
+	}
+
+	query = nemo_filter_query_new ("d7c", NEMO_FILTER_MATCH_FUZZY, NULL);
+
+	nemo_filter_query_match_batch (query, (const char * const *) keys->pdata,
+				       key_lengths, n_keys, scores);
+
+	for (i = 0; i < n_keys; i++) {
+		g_assert_cmpint (scores[i], ==,
+				 nemo_filter_query_match (query, g_ptr_array_index (keys, i), key_lengths[i]));
+	}
+
+	nemo_filter_query_free (query);
+	g_ptr_array_free (keys, TRUE);
+	g_free (key_lengths);
+	g_free (scores);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/filter-match/contains/block-boundaries", test_contains_block_boundaries);
+	g_test_add_func ("/filter-match/contains/random", test_contains_random);
+	g_test_add_func ("/filter-match/folding", test_folding);
+	g_test_add_func ("/filter-match/fuzzy-ranking", test_fuzzy_ranking);
+	g_test_add_func ("/filter-match/narrows", test_narrows);
+	g_test_add_func ("/filter-match/match-batch", test_match_batch);
+
+	return g_test_run ();
+}
@@ -0,0 +1,138 @@
+#include <libnemo-private/nemo-inode-set.h>
+#include <glib.h>
+
+/* Compares the hard link bookkeeping of deep counts: the linear scan over
+ * an array of inodes it used to do against NemoInodeSet.  Every entry is
+ * looked up once and a quarter of them turn up a second time, like hard
+ * links found elsewhere in the tree.
+ */
+
+#define ROUNDS 3
+/* The array scan is quadratic, don't wait for it past this */
+#define MAX_LINEAR_ENTRIES 50000
+
+static guint
+count_linear (const guint64 *inodes, guint n_inodes)
+{
+	GArray *seen;
+	guint64 inode;
+	guint i, j, duplicates = 0;
+
+	seen = g_array_new (FALSE, TRUE, sizeof (guint64));
+
+	for (i = 0; i < n_inodes; i++) {
+		inode = inodes[i];
+
+		for (j = 0; j < seen->len; j++) {
+			if (g_array_index (seen, guint64, j) == inode) {
+				break;
+			}
+		}
+
+		if (j < seen->len) {
+			duplicates++;
+		} else {
+			g_array_append_val (seen, inode);
+		}
+	}
+
+	g_array_free (seen, TRUE);
+
+	return duplicates;
+}
+
+static guint
+count_set (const guint64 *inodes, guint n_inodes)
+{
+	NemoInodeSet *seen;
+	guint i, duplicates = 0;
+
+	seen = nemo_inode_set_new ();
+
+	for (i = 0; i < n_inodes; i++) {
+		if (!nemo_inode_set_add (seen, 2049, inodes[i])) {
+			duplicates++;
+		}
+	}
+
+	g_assert_cmpuint (nemo_inode_set_size (seen), ==, n_inodes - duplicates);
+	nemo_inode_set_free (seen);
+
+	return duplicates;
+}
+
+static guint64 *
+generate_inodes (guint n_inodes)
+{
+	guint64 *inodes;
+	GRand *rand;
+	guint i;
+
+	inodes = g_new (guint64, n_inodes);
+	rand = g_rand_new_with_seed (42);
+
+	for (i = 0; i < n_inodes; i++) {
+		if (i >= 4 && g_rand_int_range (rand, 0, 4) == 0) {
+			inodes[i] = inodes[g_rand_int_range (rand, 0, i)];
+		} else {
+			/* Inodes handed out by a filesystem are mostly ascending */
+			inodes[i] = 1000 + i * 3;
+		}
+	}
+
+	g_rand_free (rand);
+
+	return inodes;
+}
+
+static gdouble
+time_best (guint (* count) (const guint64 *, guint),
+	   const guint64 *inodes,
+	   guint n_inodes,
+	   guint *duplicates)
+{
+	GTimer *timer;
+	gdouble best = G_MAXDOUBLE;
+	gint round;
+
+	timer = g_timer_new ();
+
+	for (round = 0; round < ROUNDS; round++) {
+		g_timer_start (timer);
+		*duplicates = count (inodes, n_inodes);
+		best = MIN (best, g_timer_elapsed (timer, NULL));
+	}
+
+	g_timer_destroy (timer);
+
+	return best;
+}
+
+int
+main (int argc, char *argv[])
+{
+	guint sizes[] = { 1000, 10000, 50000, 1000000 };
+	guint i, set_duplicates, linear_duplicates;
+	gdouble set_time, linear_time;
+	guint64 *inodes;
+
+	for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+		inodes = generate_inodes (sizes[i]);
+
+		set_time = time_best (count_set, inodes, sizes[i], &set_duplicates);
+
+		if (sizes[i] <= MAX_LINEAR_ENTRIES) {
+			linear_time = time_best (count_linear, inodes, sizes[i], &linear_duplicates);
+			g_assert_cmpuint (set_duplicates, ==, linear_duplicates);
+
+			g_print ("%7u entries: set %.4f s, array %.4f s, %.1fx\n",
+				 sizes[i], set_time, linear_time, linear_time / set_time);
+		} else {
+			g_print ("%7u entries: set %.4f s\n", sizes[i], set_time);
+		}
+
+		g_free (inodes);
+	}
+
+	return 0;
+}
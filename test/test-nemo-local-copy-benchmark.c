@@ -0,0 +1,220 @@
+#include <libnemo-private/nemo-local-copy.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+/* Compares nemo_local_copy_file() with the g_file_copy() path file
+ * operations used before, on one large file and a lot of small ones.
+ * Pass a folder to run in to measure a particular filesystem (reflinks
+ * on btrfs or XFS, server side copies on NFS); a temporary folder is
+ * used otherwise.
+ */
+
+#define LARGE_FILE_SIZE (256 * 1024 * 1024)
+#define SMALL_FILE_SIZE (16 * 1024)
+#define N_SMALL_FILES 2000
+#define ROUNDS 3
+
+typedef gboolean (* CopyFunc) (GFile                  *source,
+			       GFile                  *destination,
+			       GFileCopyFlags          flags,
+			       GCancellable           *cancellable,
+			       GFileProgressCallback   progress_callback,
+			       gpointer                progress_callback_data,
+			       GError                **error);
+
+static void
+write_file (const char *path,
+	    gsize       size,
+	    GRand      *rand)
+{
+	GError *error = NULL;
+	guint32 *data;
+	gsize i;
+
+	data = g_malloc (size);
+	for (i = 0; i < size / sizeof (guint32); i++) {
+		data[i] = g_rand_int (rand);
+	}
+
+	g_file_set_contents (path, (const char *) data, size, &error);
+	g_assert_no_error (error);
+
+	g_free (data);
+}
+
+static char *
+file_checksum (const char *path)
+{
+	GChecksum *checksum;
+	GMappedFile *mapped;
+	GError *error = NULL;
+	char *result;
+
+	mapped = g_mapped_file_new (path, FALSE, &error);
+	g_assert_no_error (error);
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+	g_checksum_update (checksum,
+			   (const guchar *) g_mapped_file_get_contents (mapped),
+			   g_mapped_file_get_length (mapped));
+	result = g_strdup (g_checksum_get_string (checksum));
+
+	g_checksum_free (checksum);
+	g_mapped_file_unref (mapped);
+
+	return result;
+}
+
+static void
+progress_cb (goffset  current_num_bytes,
+	     goffset  total_num_bytes,
+	     gpointer user_data)
+{
+	goffset *last = user_data;
+
+	g_assert_cmpint (current_num_bytes, >=, *last);
+	*last = current_num_bytes;
+}
+
+static gdouble
+copy_files (CopyFunc    copy,
+	    char      **sources,
+	    const char *dest_dir)
+{
+	GFile *source, *dest;
+	GError *error = NULL;
+	GTimer *timer;
+	gdouble elapsed;
+	goffset last;
+	char *dest_path, *source_sum, *dest_sum;
+	int i;
+
+	timer = g_timer_new ();
+	g_timer_stop (timer);
+
+	for (i = 0; sources[i] != NULL; i++) {
+		dest_path = g_build_filename (dest_dir, "copy", NULL);
+		source = g_file_new_for_path (sources[i]);
+		dest = g_file_new_for_path (dest_path);
+		last = 0;
+
+		g_timer_continue (timer);
+		copy (source, dest, G_FILE_COPY_NOFOLLOW_SYMLINKS, NULL, progress_cb, &last, &error);
+		g_timer_stop (timer);
+
+		g_assert_no_error (error);
+
+		/* Only check the first file, hashing all the small ones
+		 * would take longer than copying them */
+		if (i == 0) {
+			source_sum = file_checksum (sources[i]);
+			dest_sum = file_checksum (dest_path);
+			g_assert_cmpstr (source_sum, ==, dest_sum);
+			g_free (source_sum);
+			g_free (dest_sum);
+		}
+
+		g_unlink (dest_path);
+
+		g_object_unref (source);
+		g_object_unref (dest);
+		g_free (dest_path);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	return elapsed;
+}
+
+static void
+run (const char  *name,
+     char       **sources,
+     gsize        total_size,
+     const char  *dest_dir)
+{
+	gdouble native_best = G_MAXDOUBLE, gio_best = G_MAXDOUBLE;
+	gint round;
+
+	for (round = 0; round < ROUNDS; round++) {
+		/* Alternate, so neither always runs with a warmer cache */
+		if (round % 2 == 0) {
+			native_best = MIN (native_best, copy_files (nemo_local_copy_file, sources, dest_dir));
+			gio_best = MIN (gio_best, copy_files (g_file_copy, sources, dest_dir));
+		} else {
+			gio_best = MIN (gio_best, copy_files (g_file_copy, sources, dest_dir));
+			native_best = MIN (native_best, copy_files (nemo_local_copy_file, sources, dest_dir));
+		}
+	}
+
+	g_print ("%s: native %.1f MB/s, g_file_copy %.1f MB/s, %.1fx\n",
+		 name,
+		 total_size / native_best / (1024 * 1024),
+		 total_size / gio_best / (1024 * 1024),
+		 gio_best / native_best);
+}
+
+int
+main (int argc, char *argv[])
+{
+	GError *error = NULL;
+	GRand *rand;
+	char *base, *source_dir, *dest_dir;
+	char **large, **small;
+	int i;
+
+	if (argc > 1) {
+		base = g_build_filename (argv[1], "nemo-local-copy-benchmark-XXXXXX", NULL);
+		if (g_mkdtemp (base) == NULL) {
+			g_printerr ("Could not create a folder in %s\n", argv[1]);
+			return 1;
+		}
+	} else {
+		base = g_dir_make_tmp ("nemo-local-copy-benchmark-XXXXXX", &error);
+		g_assert_no_error (error);
+	}
+
+	source_dir = g_build_filename (base, "source", NULL);
+	dest_dir = g_build_filename (base, "dest", NULL);
+	g_mkdir (source_dir, 0755);
+	g_mkdir (dest_dir, 0755);
+
+	rand = g_rand_new_with_seed (42);
+
+	large = g_new0 (char *, 2);
+	large[0] = g_build_filename (source_dir, "large", NULL);
+	write_file (large[0], LARGE_FILE_SIZE, rand);
+
+	small = g_new0 (char *, N_SMALL_FILES + 1);
+	for (i = 0; i < N_SMALL_FILES; i++) {
+		char *name;
+
+		name = g_strdup_printf ("small-%d", i);
+		small[i] = g_build_filename (source_dir, name, NULL);
+		write_file (small[i], SMALL_FILE_SIZE, rand);
+		g_free (name);
+	}
+
+	g_rand_free (rand);
+
+	run ("One large file", large, LARGE_FILE_SIZE, dest_dir);
+	run ("Many small files", small, (gsize) N_SMALL_FILES * SMALL_FILE_SIZE, dest_dir);
+
+	for (i = 0; large[i] != NULL; i++) {
+		g_unlink (large[i]);
+	}
+	for (i = 0; small[i] != NULL; i++) {
+		g_unlink (small[i]);
+	}
+	g_rmdir (source_dir);
+	g_rmdir (dest_dir);
+	g_rmdir (base);
+
+	g_strfreev (large);
+	g_strfreev (small);
+	g_free (source_dir);
+	g_free (dest_dir);
+	g_free (base);
+
+	return 0;
+}
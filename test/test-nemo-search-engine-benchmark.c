@@ -0,0 +1,182 @@
+#include <libnemo-private/nemo-search-engine-advanced.h>
+#include <libnemo-private/nemo-global-preferences.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+
+/* Times a recursive filename search with different worker counts.
+ *
+ * With no arguments a synthetic tree is created in a temporary folder and
+ * removed afterwards.  Pass a path to benchmark against an existing tree.
+ */
+
+#define TREE_DEPTH 3
+#define TREE_FANOUT 8
+#define TREE_FILES_PER_DIR 64
+#define ROUNDS 3
+
+static GMainLoop *loop;
+static guint n_hits;
+
+static void
+hits_added_cb (NemoSearchEngine *engine, GList *hits)
+{
+	n_hits += g_list_length (hits);
+	/* The engine frees the list itself, the results are ours */
+	g_list_foreach (hits, (GFunc) file_search_result_free, NULL);
+}
+
+static void
+finished_cb (NemoSearchEngine *engine)
+{
+	g_main_loop_quit (loop);
+}
+
+static void
+populate_tree (const char *path, int depth)
+{
+	char *child;
+	int i;
+
+	for (i = 0; i < TREE_FILES_PER_DIR; i++) {
+		child = g_strdup_printf ("%s/file-%d-%d.txt", path, depth, i);
+		g_file_set_contents (child, "", 0, NULL);
+		g_free (child);
+	}
+
+	if (depth == 0) {
+		return;
+	}
+
+	for (i = 0; i < TREE_FANOUT; i++) {
+		child = g_strdup_printf ("%s/dir-%d", path, i);
+		g_mkdir (child, 0700);
+		populate_tree (child, depth - 1);
+		g_free (child);
+	}
+}
+
+static void
+remove_tree (GFile *dir)
+{
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+
+	enumerator = g_file_enumerate_children (dir,
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_STANDARD_TYPE,
+						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+						NULL, NULL);
+
+	while (enumerator != NULL &&
+	       (info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL) {
+		GFile *child = g_file_get_child (dir, g_file_info_get_name (info));
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			remove_tree (child);
+		} else {
+			g_file_delete (child, NULL, NULL);
+		}
+
+		g_object_unref (child);
+		g_object_unref (info);
+	}
+
+	g_clear_object (&enumerator);
+	g_file_delete (dir, NULL, NULL);
+}
+
+static gdouble
+run_search (const char *uri, int n_workers)
+{
+	NemoSearchEngine *engine;
+	NemoQuery *query;
+	GTimer *timer;
+	gdouble elapsed;
+
+	g_settings_set_int (nemo_search_preferences,
+			    NEMO_PREFERENCES_SEARCH_WORKER_THREADS, n_workers);
+
+	engine = nemo_search_engine_advanced_new ();
+	g_signal_connect (engine, "hits-added",
+			  G_CALLBACK (hits_added_cb), NULL);
+	g_signal_connect (engine, "finished",
+			  G_CALLBACK (finished_cb), NULL);
+
+	query = nemo_query_new ();
+	nemo_query_set_file_pattern (query, "*.txt");
+	nemo_query_set_location (query, uri);
+	nemo_query_set_recurse (query, TRUE);
+	nemo_search_engine_set_query (engine, query);
+	g_object_unref (query);
+
+	n_hits = 0;
+	timer = g_timer_new ();
+
+	nemo_search_engine_start (engine);
+	g_main_loop_run (loop);
+
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_timer_destroy (timer);
+	g_object_unref (engine);
+
+	return elapsed;
+}
+
+int
+main (int argc, char *argv[])
+{
+	GFile *root;
+	char *tmp_dir = NULL;
+	char *uri;
+	int worker_counts[] = { 1, 2, 4, 0 };
+	guint i, round;
+
+	/* Don't clobber the user's worker setting */
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+
+	gtk_init (&argc, &argv);
+	nemo_global_preferences_init ();
+
+	if (argc > 1) {
+		root = g_file_new_for_commandline_arg (argv[1]);
+	} else {
+		tmp_dir = g_dir_make_tmp ("nemo-search-bench-XXXXXX", NULL);
+		g_assert (tmp_dir != NULL);
+		populate_tree (tmp_dir, TREE_DEPTH);
+		root = g_file_new_for_path (tmp_dir);
+	}
+
+	uri = g_file_get_uri (root);
+	loop = g_main_loop_new (NULL, FALSE);
+
+	/* Warm the dentry cache so the first configuration isn't penalized */
+	run_search (uri, 1);
+
+	for (i = 0; i < G_N_ELEMENTS (worker_counts); i++) {
+		gdouble best = G_MAXDOUBLE;
+
+		for (round = 0; round < ROUNDS; round++) {
+			best = MIN (best, run_search (uri, worker_counts[i]));
+		}
+
+		if (worker_counts[i] == 0) {
+			g_print ("workers: auto (%u)  hits: %u  best of %d: %.3f s\n",
+				 g_get_num_processors (), n_hits, ROUNDS, best);
+		} else {
+			g_print ("workers: %d  hits: %u  best of %d: %.3f s\n",
+				 worker_counts[i], n_hits, ROUNDS, best);
+		}
+	}
+
+	if (tmp_dir != NULL) {
+		remove_tree (root);
+		g_free (tmp_dir);
+	}
+
+	g_main_loop_unref (loop);
+	g_object_unref (root);
+	g_free (uri);
+
+	return 0;
+}
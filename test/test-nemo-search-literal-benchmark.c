@@ -0,0 +1,183 @@
+#include <libnemo-private/nemo-search-literal.h>
+#include <glib.h>
+#include <string.h>
+
+/* Compares the literal scanner used for plain-text content searches with
+ * the PCRE path on a generated corpus.  Pass a file name to use its
+ * contents as the corpus instead.
+ */
+
+#define CORPUS_SIZE (64 * 1024 * 1024)
+#define ROUNDS 5
+
+static const char *words[] = {
+	"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+	"lorem", "ipsum", "dolor", "amet", "folder", "window", "search",
+	"Nemo", "desktop", "thumbnail", "preferences", "bookmark"
+};
+
+static char *
+generate_corpus (gsize *length)
+{
+	GString *corpus;
+	GRand *rand;
+
+	corpus = g_string_sized_new (CORPUS_SIZE + 64);
+	rand = g_rand_new_with_seed (42);
+
+	while (corpus->len < CORPUS_SIZE) {
+		g_string_append (corpus, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+		g_string_append_c (corpus, g_rand_int_range (rand, 0, 12) == 0 ? '\n' : ' ');
+
+		/* A rare needle, in mixed case now and then */
+		if (g_rand_int_range (rand, 0, 100000) == 0) {
+			g_string_append (corpus, g_rand_boolean (rand) ? "needlepoint " : "NeedlePoint ");
+		}
+	}
+
+	g_rand_free (rand);
+
+	*length = corpus->len;
+	return g_string_free (corpus, FALSE);
+}
+
+static guint
+count_literal (const NemoSearchLiteral *literal,
+	       GRegex                  *regex,
+	       gsize                    literal_length,
+	       const char              *text,
+	       gsize                    length)
+{
+	GMatchInfo *match_info;
+	const char *p, *end;
+	gint match_end;
+	guint hits = 0;
+
+	end = text + length;
+
+	/* Non-overlapping, like successive regex matches */
+	for (p = text; (p = nemo_search_literal_find (literal, p, end - p)) != NULL; ) {
+		if (nemo_search_literal_is_exact (literal)) {
+			hits++;
+			p += literal_length;
+			continue;
+		}
+
+		/* Only a candidate, confirmed from there the way the search
+		 * engine does it */
+		if (!g_regex_match_full (regex, text, length, p - text, 0, &match_info, NULL)) {
+			g_match_info_unref (match_info);
+			break;
+		}
+
+		g_match_info_fetch_pos (match_info, 0, NULL, &match_end);
+		g_match_info_unref (match_info);
+
+		hits++;
+		p = text + match_end;
+	}
+
+	return hits;
+}
+
+static guint
+count_regex (GRegex     *regex,
+	     const char *text,
+	     gsize       length)
+{
+	GMatchInfo *match_info;
+	guint hits = 0;
+
+	g_regex_match_full (regex, text, length, 0, 0, &match_info, NULL);
+
+	while (g_match_info_matches (match_info)) {
+		hits++;
+		g_match_info_next (match_info, NULL);
+	}
+
+	g_match_info_unref (match_info);
+
+	return hits;
+}
+
+static void
+run (const char *pattern,
+     gboolean    case_sensitive,
+     const char *text,
+     gsize       length)
+{
+	NemoSearchLiteral *literal;
+	GRegex *regex;
+	GTimer *timer;
+	gdouble literal_best = G_MAXDOUBLE, regex_best = G_MAXDOUBLE;
+	guint literal_hits = 0, regex_hits = 0;
+	gchar *escaped;
+	gint round;
+
+	literal = nemo_search_literal_new (pattern, case_sensitive);
+	g_assert (literal != NULL);
+
+	/* Same flags the search engine uses for a non-regex content search */
+	escaped = g_regex_escape_string (pattern, -1);
+	regex = g_regex_new (escaped,
+			     G_REGEX_MULTILINE | G_REGEX_OPTIMIZE | (case_sensitive ? 0 : G_REGEX_CASELESS),
+			     0, NULL);
+	g_free (escaped);
+
+	timer = g_timer_new ();
+
+	for (round = 0; round < ROUNDS; round++) {
+		g_timer_start (timer);
+		literal_hits = count_literal (literal, regex, strlen (pattern), text, length);
+		literal_best = MIN (literal_best, g_timer_elapsed (timer, NULL));
+
+		g_timer_start (timer);
+		regex_hits = count_regex (regex, text, length);
+		regex_best = MIN (regex_best, g_timer_elapsed (timer, NULL));
+	}
+
+	g_print ("'%s' (%s): literal %u hits %.1f MB/s, regex %u hits %.1f MB/s, %.1fx\n",
+		 pattern, case_sensitive ? "case sensitive" : "ignoring case",
+		 literal_hits, length / literal_best / (1024 * 1024),
+		 regex_hits, length / regex_best / (1024 * 1024),
+		 regex_best / literal_best);
+
+	g_assert_cmpuint (literal_hits, ==, regex_hits);
+
+	g_timer_destroy (timer);
+	g_regex_unref (regex);
+	nemo_search_literal_free (literal);
+}
+
+int
+main (int argc, char *argv[])
+{
+	char *text;
+	gsize length;
+
+	if (argc > 1) {
+		if (!g_file_get_contents (argv[1], &text, &length, NULL)) {
+			g_printerr ("Could not read %s\n", argv[1]);
+			return 1;
+		}
+	} else {
+		text = generate_corpus (&length);
+	}
+
+	if (!g_utf8_validate (text, length, NULL)) {
+		g_printerr ("The corpus has to be valid UTF-8\n");
+		g_free (text);
+		return 1;
+	}
+
+	run ("needlepoint", TRUE, text, length);
+	run ("needlepoint", FALSE, text, length);
+	run ("bookmark", TRUE, text, length);
+	/* Only "top" can be scanned for when ignoring case */
+	run ("desktop", FALSE, text, length);
+	run ("a", TRUE, text, length);
+
+	g_free (text);
+
+	return 0;
+}